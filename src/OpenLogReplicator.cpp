@@ -20,12 +20,14 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 #include <algorithm>
 #include <cerrno>
 #include <fcntl.h>
+#include <map>
 #include <regex>
 #include <sys/file.h>
 #include <sys/stat.h>
 #include <thread>
 #include <unistd.h>
 
+#include "builder/BuilderAvro.h"
 #include "builder/BuilderJson.h"
 #include "common/Ctx.h"
 #include "common/types.h"
@@ -43,6 +45,7 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 #include "replicator/ReplicatorBatch.h"
 #include "state/StateDisk.h"
 #include "writer/WriterFile.h"
+#include "writer/WriterFileCompressor.h"
 #include "OpenLogReplicator.h"
 
 #ifdef LINK_LIBRARY_OCI
@@ -68,6 +71,10 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 #define HAS_ZEROMQ ""
 #endif /* LINK_LIBRARY_PROTOBUF */
 
+#ifdef LINK_LIBRARY_ARROW
+#include "builder/BuilderArrow.h"
+#endif /* LINK_LIBRARY_ARROW */
+
 #ifdef LINK_LIBRARY_RDKAFKA
 #include "writer/WriterKafka.h"
 #else
@@ -345,6 +352,27 @@ namespace OpenLogReplicator {
                 ctx->transactionSizeMax = transactionMaxMb * 1024 * 1024;
             }
 
+            if (sourceJson.HasMember("transaction-stream-mb")) {
+                uint64_t transactionStreamMb = Ctx::getJsonFieldU64(fileName, sourceJson, "transaction-stream-mb");
+                if (transactionStreamMb > memoryMaxMb)
+                    throw ConfigurationException("bad JSON, 'transaction-stream-mb' (" + std::to_string(transactionStreamMb) +
+                                                 ") is bigger than 'memory-max-mb' (" + std::to_string(memoryMaxMb) + ")");
+                if (ctx->transactionSizeMax > 0 && transactionStreamMb * 1024 * 1024 >= ctx->transactionSizeMax)
+                    throw ConfigurationException("bad JSON, 'transaction-stream-mb' (" + std::to_string(transactionStreamMb) +
+                                                 ") should be smaller than 'transaction-max-mb' (" + std::to_string(ctx->transactionSizeMax / 1024 / 1024) + ")");
+                ctx->transactionStreamSize = transactionStreamMb * 1024 * 1024;
+            }
+
+            if (sourceJson.HasMember("transaction-report-interval-s"))
+                ctx->transactionReportIntervalS = Ctx::getJsonFieldU64(fileName, sourceJson, "transaction-report-interval-s");
+
+            if (sourceJson.HasMember("transaction-report-top")) {
+                ctx->transactionReportTop = Ctx::getJsonFieldU64(fileName, sourceJson, "transaction-report-top");
+                if (ctx->transactionReportTop < 1 || ctx->transactionReportTop > 1000)
+                    throw ConfigurationException("bad JSON, invalid 'transaction-report-top' value: " + std::to_string(ctx->transactionReportTop) +
+                                                 ", expected one of: {1 .. 1000}");
+            }
+
             // MEMORY MANAGER
             ctx->initialize(memoryMinMb, memoryMaxMb, readBufferMax);
 
@@ -480,14 +508,71 @@ namespace OpenLogReplicator {
             if (formatJson.HasMember("flush-buffer"))
                 flushBuffer = Ctx::getJsonFieldU64(fileName, formatJson, "flush-buffer");
 
+            uint64_t netChange = 0;
+            if (formatJson.HasMember("net-change")) {
+                netChange = Ctx::getJsonFieldU64(fileName, formatJson, "net-change");
+                if (netChange > 1)
+                    throw ConfigurationException("bad JSON, invalid 'net-change' value: " + std::to_string(netChange) +
+                                                 ", expected one of: {0, 1}");
+                if (netChange == 1 && ctx->transactionStreamSize > 0)
+                    throw ConfigurationException("bad JSON, 'net-change' can't be used with 'transaction-stream-mb'");
+            }
+
+            uint64_t rawFormat = RAW_FORMAT_HEX;
+            if (formatJson.HasMember("raw")) {
+                rawFormat = Ctx::getJsonFieldU64(fileName, formatJson, "raw");
+                if (rawFormat > 1)
+                    throw ConfigurationException("bad JSON, invalid 'raw' value: " + std::to_string(rawFormat) +
+                                                 ", expected one of: {0, 1}");
+            }
+
             const char* formatType = Ctx::getJsonFieldS(fileName, JSON_PARAMETER_LENGTH, formatJson, "type");
 
             Builder* builder;
             if (strcmp("json", formatType) == 0) {
                 builder = new BuilderJson(ctx, locales, metadata, messageFormat, ridFormat, xidFormat, timestampFormat, charFormat, scnFormat, unknownFormat,
                                           schemaFormat, columnFormat, unknownType, flushBuffer);
+            } else if (strcmp("avro", formatType) == 0) {
+                if (FLAG(REDO_FLAGS_SCHEMALESS))
+                    throw ConfigurationException("bad JSON, schemaless mode is not supported for format 'avro'");
+                if ((messageFormat & MESSAGE_FORMAT_FULL) != 0)
+                    throw ConfigurationException("bad JSON, invalid 'message' value: " + std::to_string(messageFormat) +
+                                                 ", FULL mode (" + std::to_string(MESSAGE_FORMAT_FULL) + ") is not supported for format 'avro'");
+                builder = new BuilderAvro(ctx, locales, metadata, messageFormat, ridFormat, xidFormat, timestampFormat, charFormat, scnFormat, unknownFormat,
+                                          schemaFormat, columnFormat, unknownType, flushBuffer);
+            } else if (strcmp("arrow", formatType) == 0) {
+#ifdef LINK_LIBRARY_ARROW
+                if (ctx->transactionStreamSize > 0)
+                    throw ConfigurationException("bad JSON, 'transaction-stream-mb' is not supported for format 'arrow'");
+                if (FLAG(REDO_FLAGS_SCHEMALESS))
+                    throw ConfigurationException("bad JSON, schemaless mode is not supported for format 'arrow'");
+
+                uint64_t batchRows = 10000;
+                if (formatJson.HasMember("batch-rows")) {
+                    batchRows = Ctx::getJsonFieldU64(fileName, formatJson, "batch-rows");
+                    if (batchRows < 1 || batchRows > 1000000)
+                        throw ConfigurationException("bad JSON, invalid 'batch-rows' value: " + std::to_string(batchRows) +
+                                                     ", expected one of: {1 .. 1000000}");
+                }
+
+                uint64_t batchIntervalMs = 1000;
+                if (formatJson.HasMember("batch-interval-ms"))
+                    batchIntervalMs = Ctx::getJsonFieldU64(fileName, formatJson, "batch-interval-ms");
+
+                uint64_t dictionaryLength = 32;
+                if (formatJson.HasMember("dictionary-length"))
+                    dictionaryLength = Ctx::getJsonFieldU64(fileName, formatJson, "dictionary-length");
+
+                builder = new BuilderArrow(ctx, locales, metadata, messageFormat, ridFormat, xidFormat, timestampFormat, charFormat, scnFormat,
+                                           unknownFormat, schemaFormat, columnFormat, unknownType, flushBuffer, batchRows, batchIntervalMs,
+                                           dictionaryLength);
+#else
+                throw RuntimeException("format 'arrow' is not compiled, exiting");
+#endif /* LINK_LIBRARY_ARROW */
             } else if (strcmp("protobuf", formatType) == 0) {
 #ifdef LINK_LIBRARY_PROTOBUF
+                if (ctx->transactionStreamSize > 0)
+                    throw ConfigurationException("bad JSON, 'transaction-stream-mb' is not supported for format 'protobuf'");
                 builder = new BuilderProtobuf(ctx, locales, metadata, messageFormat, ridFormat, xidFormat, timestampFormat, charFormat, scnFormat,
                                               unknownFormat, schemaFormat, columnFormat, unknownType, flushBuffer);
 #else
@@ -497,6 +582,9 @@ namespace OpenLogReplicator {
                 throw ConfigurationException(std::string("bad JSON, invalid 'type' value: ") + formatType);
             builders.push_back(builder);
             builder->initialize();
+            if (netChange == 1)
+                builder->setNetChange(true);
+            builder->setRawFormat(rawFormat);
 
             // READER
             const char* readerType = Ctx::getJsonFieldS(fileName, JSON_PARAMETER_LENGTH, readerJson, "type");
@@ -636,9 +724,11 @@ namespace OpenLogReplicator {
 
         // Iterate through targets
         const rapidjson::Value& targetArrayJson = Ctx::getJsonFieldA(fileName, document, "target");
-        if (targetArrayJson.Size() > 1) {
-            throw ConfigurationException("bad JSON, only one 'target' element is allowed");
-        }
+
+        // Many targets may read the same source, each with own position and checkpoint
+        std::map<std::string, uint64_t> sourceTargets;
+        for (rapidjson::SizeType j = 0; j < targetArrayJson.Size(); ++j)
+            ++sourceTargets[Ctx::getJsonFieldS(fileName, JSON_PARAMETER_LENGTH, targetArrayJson[j], "source")];
 
         for (rapidjson::SizeType j = 0; j < targetArrayJson.Size(); ++j) {
             const rapidjson::Value& targetJson = targetArrayJson[j];
@@ -672,6 +762,36 @@ namespace OpenLogReplicator {
                                                  ", expected one of: {1 .. 1000000}");
             }
 
+            uint64_t maxLagMb = 0;
+            if (writerJson.HasMember("max-lag-mb"))
+                maxLagMb = Ctx::getJsonFieldU64(fileName, writerJson, "max-lag-mb");
+
+            uint64_t shards = 1;
+            if (writerJson.HasMember("shards")) {
+                shards = Ctx::getJsonFieldU64(fileName, writerJson, "shards");
+                if (shards < 1 || shards > 256)
+                    throw ConfigurationException("bad JSON, invalid 'shards' value: " + std::to_string(shards) + ", expected one of: {1 .. 256}");
+                if (shards > 1 && strcmp(writerType, "kafka") != 0)
+                    throw ConfigurationException(std::string("bad JSON, 'shards' is not supported for writer '") + writerType + "'");
+                if (shards > 1 && (replicator2->builder->getMessageFormat() & MESSAGE_FORMAT_FULL) != 0)
+                    throw ConfigurationException("bad JSON, 'shards' is not supported for message format FULL (" +
+                                                 std::to_string(MESSAGE_FORMAT_FULL) + ")");
+            }
+
+            uint64_t shardKey = WRITER_SHARD_KEY_TABLE;
+            if (writerJson.HasMember("shard-key")) {
+                shardKey = Ctx::getJsonFieldU64(fileName, writerJson, "shard-key");
+                if (shardKey > 1)
+                    throw ConfigurationException("bad JSON, invalid 'shard-key' value: " + std::to_string(shardKey) + ", expected one of: {0, 1}");
+            }
+            if (shards > 1 && shardKey == WRITER_SHARD_KEY_PRIMARY_KEY)
+                replicator2->builder->setRowKeys(true);
+            std::vector<Writer*> shardWriters;
+
+            if ((strcmp(writerType, "zeromq") == 0 || strcmp(writerType, "network") == 0) && sourceTargets[source] > 1)
+                throw ConfigurationException(std::string("bad JSON, writer '") + writerType + "' can't share 'source' value: " + source +
+                                             " with other targets");
+
             if (strcmp(writerType, "file") == 0) {
                 uint64_t maxSize = 0;
                 if (writerJson.HasMember("max-size"))
@@ -703,8 +823,67 @@ namespace OpenLogReplicator {
                                                      ", expected one of: {0, 1}");
                 }
 
+                uint64_t fsync = 0;
+                if (writerJson.HasMember("fsync")) {
+                    fsync = Ctx::getJsonFieldU64(fileName, writerJson, "fsync");
+                    if (fsync > 1)
+                        throw ConfigurationException("bad JSON, invalid 'fsync' value: " + std::to_string(fsync) +
+                                                     ", expected one of: {0, 1}");
+                    if (fsync == 1 && strcmp(output, "") == 0)
+                        throw ConfigurationException("parameter 'fsync' should be 0 when 'output' is not set (for: file writer)");
+                }
+
+                uint64_t fsyncIntervalMs = 0;
+                if (writerJson.HasMember("fsync-interval-ms")) {
+                    fsyncIntervalMs = Ctx::getJsonFieldU64(fileName, writerJson, "fsync-interval-ms");
+                    if (fsyncIntervalMs > 60000)
+                        throw ConfigurationException("bad JSON, invalid 'fsync-interval-ms' value: " + std::to_string(fsyncIntervalMs) +
+                                                     ", expected one of: {0 .. 60000}");
+                }
+
+                uint64_t compression = WRITER_FILE_COMPRESSION_NONE;
+                if (writerJson.HasMember("compression")) {
+                    compression = Ctx::getJsonFieldU64(fileName, writerJson, "compression");
+                    if (compression > 2)
+                        throw ConfigurationException("bad JSON, invalid 'compression' value: " + std::to_string(compression) +
+                                                     ", expected one of: {0, 1, 2}");
+#ifndef LINK_LIBRARY_ZLIB
+                    if (compression == WRITER_FILE_COMPRESSION_GZIP)
+                        throw ConfigurationException("bad JSON, 'compression' value: " + std::to_string(compression) +
+                                                     " requires gzip support (WITH_ZLIB)");
+#endif /* LINK_LIBRARY_ZLIB */
+#ifndef LINK_LIBRARY_ZSTD
+                    if (compression == WRITER_FILE_COMPRESSION_ZSTD)
+                        throw ConfigurationException("bad JSON, 'compression' value: " + std::to_string(compression) +
+                                                     " requires zstd support (WITH_ZSTD)");
+#endif /* LINK_LIBRARY_ZSTD */
+                }
+
+                uint64_t compressionLevel = 0;
+                if (writerJson.HasMember("compression-level")) {
+                    compressionLevel = Ctx::getJsonFieldU64(fileName, writerJson, "compression-level");
+                    if ((compression == WRITER_FILE_COMPRESSION_GZIP && compressionLevel > 9) ||
+                            (compression == WRITER_FILE_COMPRESSION_ZSTD && compressionLevel > 22))
+                        throw ConfigurationException("bad JSON, invalid 'compression-level' value: " + std::to_string(compressionLevel) +
+                                                     ", expected one of: {0 .. " + (compression == WRITER_FILE_COMPRESSION_GZIP ? "9" : "22") + "}");
+                }
+
+                uint64_t maxSizeCompressed = 0;
+                if (writerJson.HasMember("max-size-compressed")) {
+                    maxSizeCompressed = Ctx::getJsonFieldU64(fileName, writerJson, "max-size-compressed");
+                    if (maxSizeCompressed > 1)
+                        throw ConfigurationException("bad JSON, invalid 'max-size-compressed' value: " + std::to_string(maxSizeCompressed) +
+                                                     ", expected one of: {0, 1}");
+                }
+
+                // Sync statistics are logged only when there were syncs
+                uint64_t statsIntervalS = 60;
+                if (writerJson.HasMember("stats-interval-s"))
+                    statsIntervalS = Ctx::getJsonFieldU64(fileName, writerJson, "stats-interval-s");
+
                 writer = new WriterFile(ctx, std::string(alias) + "-writer", replicator2->database, replicator2->builder,
-                                        replicator2->metadata, output, format, maxSize, newLine, append);
+                                        replicator2->metadata, output, format, maxSize, newLine, append, fsync, fsyncIntervalMs,
+                                        compression, compressionLevel, maxSizeCompressed, statsIntervalS);
             } else if (strcmp(writerType, "kafka") == 0) {
 #ifdef LINK_LIBRARY_RDKAFKA
                 uint64_t maxMessageMb = 100;
@@ -714,7 +893,8 @@ namespace OpenLogReplicator {
                         throw ConfigurationException("bad JSON, invalid 'max-message-mb' value: " + std::to_string(maxMessageMb) +
                                                      ", expected one of: {1 .. " + std::to_string(MAX_KAFKA_MESSAGE_MB) + "}");
                 }
-                replicator2->builder->setMaxMessageMb(maxMessageMb);
+                if (replicator2->builder->getMaxMessageMb() == 0 || maxMessageMb < replicator2->builder->getMaxMessageMb())
+                    replicator2->builder->setMaxMessageMb(maxMessageMb);
 
                 uint64_t maxMessages = 100000;
                 if (writerJson.HasMember("max-messages")) {
@@ -727,8 +907,8 @@ namespace OpenLogReplicator {
                 bool enableIdempotence = true;
                 if (writerJson.HasMember("enable-idempotence")) {
                     uint64_t enableIdempotenceInt = Ctx::getJsonFieldU64(fileName, writerJson, "enable-idempotence");
-                    if (enableIdempotenceInt == 1)
-                        enableIdempotence = true;
+                    if (enableIdempotenceInt == 0)
+                        enableIdempotence = false;
                     else if (enableIdempotenceInt > 1)
                         throw ConfigurationException("bad JSON, invalid 'enable-idempotence' value: " + std::to_string(enableIdempotenceInt) +
                                                      ", expected one of: {0, 1}");
@@ -738,8 +918,55 @@ namespace OpenLogReplicator {
 
                 const char* topic = Ctx::getJsonFieldS(fileName, JSON_TOPIC_LENGTH, writerJson, "topic");
 
+                const char* tableTopic = "";
+                if (writerJson.HasMember("table-topic")) {
+                    tableTopic = Ctx::getJsonFieldS(fileName, JSON_TOPIC_LENGTH, writerJson, "table-topic");
+                    if ((replicator2->builder->getMessageFormat() & MESSAGE_FORMAT_FULL) != 0)
+                        throw ConfigurationException("bad JSON, 'table-topic' is not supported for message format FULL (" +
+                                                     std::to_string(MESSAGE_FORMAT_FULL) + ")");
+                    replicator2->builder->setTableTags(true);
+                }
+
+                if (writerJson.HasMember("key")) {
+                    uint64_t messageKey = Ctx::getJsonFieldU64(fileName, writerJson, "key");
+                    if (messageKey > 2)
+                        throw ConfigurationException("bad JSON, invalid 'key' value: " + std::to_string(messageKey) + ", expected one of: {0, 1, 2}");
+                    if (messageKey != MESSAGE_KEY_NONE) {
+                        if ((replicator2->builder->getMessageFormat() & MESSAGE_FORMAT_FULL) != 0)
+                            throw ConfigurationException("bad JSON, 'key' is not supported for message format FULL (" +
+                                                         std::to_string(MESSAGE_FORMAT_FULL) + ")");
+                        if (replicator2->builder->getMessageKey() != MESSAGE_KEY_NONE && replicator2->builder->getMessageKey() != messageKey)
+                            throw ConfigurationException("bad JSON, 'key' value: " + std::to_string(messageKey) +
+                                                         " is different than used by other target of source: " + source);
+                        replicator2->builder->setMessageKey(messageKey);
+                    }
+                }
+
+                // Producer properties passed to librdkafka as is
+                std::map<std::string, std::string> properties;
+                if (writerJson.HasMember("properties")) {
+                    const rapidjson::Value& propertiesJson = Ctx::getJsonFieldO(fileName, writerJson, "properties");
+                    for (auto it = propertiesJson.MemberBegin(); it != propertiesJson.MemberEnd(); ++it) {
+                        const char* name = it->name.GetString();
+                        properties[name] = Ctx::getJsonFieldS(fileName, JSON_PARAMETER_LENGTH, propertiesJson, name);
+                    }
+                }
+
+                uint64_t maxInflightMb = 0;
+                if (writerJson.HasMember("max-inflight-mb"))
+                    maxInflightMb = Ctx::getJsonFieldU64(fileName, writerJson, "max-inflight-mb");
+
+                uint64_t statsIntervalS = 0;
+                if (writerJson.HasMember("stats-interval-s"))
+                    statsIntervalS = Ctx::getJsonFieldU64(fileName, writerJson, "stats-interval-s");
+
                 writer = new WriterKafka(ctx, std::string(alias) + "-writer", replicator2->database, replicator2->builder,
-                                         replicator2->metadata, brokers, topic, maxMessages, enableIdempotence);
+                                         replicator2->metadata, brokers, topic, tableTopic, maxMessages, enableIdempotence, properties,
+                                         maxInflightMb, statsIntervalS);
+                for (uint64_t shard = 1; shard < shards; ++shard)
+                    shardWriters.push_back(new WriterKafka(ctx, std::string(alias) + "-writer-" + std::to_string(shard), replicator2->database,
+                                                           replicator2->builder, replicator2->metadata, brokers, topic, tableTopic, maxMessages,
+                                                           enableIdempotence, properties, maxInflightMb, statsIntervalS));
 #else
                 throw RuntimeException("writer Kafka is not compiled, exiting");
 #endif /* LINK_LIBRARY_RDKAFKA */
@@ -767,10 +994,24 @@ namespace OpenLogReplicator {
                 throw ConfigurationException(std::string("bad JSON: invalid 'type' value: ") + writerType);
 
             writers.push_back(writer);
+            writer->setMaxLagMb(maxLagMb);
+            writer->setShard(0, shards, shardKey);
             writer->initialize();
-            ctx->spawnThread(writer);
+
+            // Each shard reads the whole output and sends only own messages
+            for (uint64_t shard = 1; shard < shards; ++shard) {
+                Writer* shardWriter = shardWriters[shard - 1];
+                writers.push_back(shardWriter);
+                shardWriter->setMaxLagMb(maxLagMb);
+                shardWriter->setShard(shard, shards, shardKey);
+                shardWriter->initialize();
+            }
         }
 
+        // All writers of a source are registered before any of them reads its checkpoint
+        for (Writer* writer : writers)
+            ctx->spawnThread(writer);
+
         ctx->mainLoop();
 
         return 0;
@@ -17,6 +17,8 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <thread>
+
 #include "../common/OracleColumn.h"
 #include "../common/OracleObject.h"
 #include "../common/RedoLogRecord.h"
@@ -62,8 +64,22 @@ namespace OpenLogReplicator {
             num(0),
             maxMessageMb(0),
             newTran(false),
+            continuedTran(false),
             compressedBefore(false),
             compressedAfter(false),
+            netChange(false),
+            rawFormat(RAW_FORMAT_HEX),
+            rowKeys(false),
+            rowKey(0),
+            messageKey(MESSAGE_KEY_NONE),
+            tableTags(false),
+            netSize(0),
+            sentRows(nullptr),
+            sentSize(nullptr),
+            sentReplay(false),
+            rowOps(1),
+            flushSeq(0),
+            writersParked(0),
             systemTransaction(nullptr),
             buffersAllocated(0),
             firstBuffer(nullptr),
@@ -72,12 +88,41 @@ namespace OpenLogReplicator {
         memset((void*)valuesMerge, 0, sizeof(valuesMerge));
         memset((void*)values, 0, sizeof(values));
         memset((void*)valuesPart, 0, sizeof(valuesPart));
+
+        // Bytes out of range are never produced by the database
+        for (uint64_t i = 0; i < 256; ++i) {
+            uint64_t positive = i - 1;
+            uint64_t negative = 101 - i;
+            if (i >= 1 && i <= 100) {
+                numberPairsPositive[i * 2] = map10[positive / 10];
+                numberPairsPositive[i * 2 + 1] = map10[positive % 10];
+            } else {
+                numberPairsPositive[i * 2] = '?';
+                numberPairsPositive[i * 2 + 1] = '?';
+            }
+            if (i >= 2 && i <= 101) {
+                numberPairsNegative[i * 2] = map10[negative / 10];
+                numberPairsNegative[i * 2 + 1] = map10[negative % 10];
+            } else {
+                numberPairsNegative[i * 2] = '?';
+                numberPairsNegative[i * 2 + 1] = '?';
+            }
+        }
+
+        decimalPowers[0] = 1;
+        for (uint64_t i = 1; i < 39; ++i)
+            decimalPowers[i] = decimalPowers[i - 1] * 10;
     }
 
     Builder::~Builder() {
         valuesRelease();
         objects.clear();
 
+        for (BuilderNetRow* row : netRows)
+            delete row;
+        netRows.clear();
+        netRowMap.clear();
+
         while (firstBuffer != nullptr) {
             BuilderQueue* nextBuffer = firstBuffer->next;
             ctx->freeMemoryChunk("builder", (uint8_t*)firstBuffer, true);
@@ -85,6 +130,10 @@ namespace OpenLogReplicator {
             --buffersAllocated;
         }
 
+        for (BuilderReader* reader : readers)
+            delete reader;
+        readers.clear();
+
         if (systemTransaction != nullptr) {
             delete systemTransaction;
             systemTransaction = nullptr;
@@ -299,42 +348,230 @@ namespace OpenLogReplicator {
         }
     }
 
-    void Builder::builderRotate(bool copy) {
+    // Unscaled value of NUMBER, fails when out of range of decimal with given scale or when digits beyond the scale would be lost
+    bool Builder::decodeDecimal(const uint8_t* data, uint64_t length, int64_t scale, typeInt128& value) const {
+        if (data == nullptr || length == 0)
+            return false;
+
+        uint8_t digits = data[0];
+        if (digits == 0x80) {
+            value = 0;
+            return true;
+        }
+
+        uint64_t jMax = length - 1;
+        bool negative;
+        int64_t exponent;
+        if (digits > 0x80 && jMax >= 1) {
+            negative = false;
+            exponent = (int64_t)digits - 0xC1;
+        } else if (digits < 0x80 && jMax >= 1) {
+            negative = true;
+            if (data[jMax] == 0x66)
+                --jMax;
+            exponent = 0x3E - (int64_t)digits;
+        } else
+            return false;
+
+        typeUInt128 result = 0;
+        for (uint64_t j = 1; j <= jMax; ++j) {
+            uint64_t pair = negative ? 101 - (uint64_t)data[j] : (uint64_t)data[j] - 1;
+            if (pair > 99)
+                return false;
+
+            int64_t power = 2 * (exponent - (int64_t)(j - 1)) + scale;
+            if (power > 37 || (power == 37 && pair >= 10))
+                return false;
+            if (power >= 0)
+                result += pair * decimalPowers[power];
+            else if (power == -1 && (pair % 10) == 0)
+                result += pair / 10;
+            else if (pair != 0)
+                return false;
+        }
+
+        value = negative ? -(typeInt128)result : (typeInt128)result;
+        return true;
+    }
+
+    // Days since 1970-01-01 in proleptic Gregorian calendar, month 1..12
+    int64_t Builder::daysFromCivil(int64_t year, uint64_t month, uint64_t day) {
+        if (month <= 2)
+            --year;
+        int64_t era = (year >= 0 ? year : year - 399) / 400;
+        auto yearOfEra = (uint64_t)(year - era * 400);
+        uint64_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+        uint64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + (int64_t)dayOfEra - 719468;
+    }
+
+    // Microseconds since 1970-01-01, year 1 BC is year 0
+    int64_t Builder::epochMicros(struct tm& epochTime, uint64_t fraction) {
+        int64_t year = epochTime.tm_year;
+        if (year <= 0)
+            ++year;
+        int64_t epoch = ((daysFromCivil(year, epochTime.tm_mon, epochTime.tm_mday) * 24 + epochTime.tm_hour) * 60 +
+                epochTime.tm_min) * 60 + epochTime.tm_sec;
+        return epoch * 1000000 + (int64_t)(fraction / 1000);
+    }
+
+    // 2012-04-23T18:25:43.511000000 +02:00
+    void Builder::valueBufferTimestamp(struct tm& epochTime, uint64_t fraction, const char* tz) {
+        char* out = valueBuffer;
+        int64_t yearAstronomical = epochTime.tm_year;
+        if (yearAstronomical <= 0)
+            ++yearAstronomical;
+        uint64_t year;
+        if (yearAstronomical >= 0)
+            year = yearAstronomical;
+        else {
+            *out++ = '-';
+            year = -yearAstronomical;
+        }
+        for (uint64_t i = 4; i > 0; --i) {
+            out[i - 1] = map10[year % 10];
+            year /= 10;
+        }
+        out += 4;
+        out[0] = '-';
+        out[1] = map10[epochTime.tm_mon / 10];
+        out[2] = map10[epochTime.tm_mon % 10];
+        out[3] = '-';
+        out[4] = map10[epochTime.tm_mday / 10];
+        out[5] = map10[epochTime.tm_mday % 10];
+        out[6] = 'T';
+        out[7] = map10[epochTime.tm_hour / 10];
+        out[8] = map10[epochTime.tm_hour % 10];
+        out[9] = ':';
+        out[10] = map10[epochTime.tm_min / 10];
+        out[11] = map10[epochTime.tm_min % 10];
+        out[12] = ':';
+        out[13] = map10[epochTime.tm_sec / 10];
+        out[14] = map10[epochTime.tm_sec % 10];
+        out[15] = '.';
+        out += 16;
+        for (uint64_t i = 9; i > 0; --i) {
+            out[i - 1] = map10[fraction % 10];
+            fraction /= 10;
+        }
+        out += 9;
+        if (tz != nullptr) {
+            *out++ = ' ';
+            while (*tz != 0 && out < valueBuffer + 64)
+                *out++ = *tz++;
+        }
+        valueLength = out - valueBuffer;
+    }
+
+    void Builder::builderRotate() {
         auto* nextBuffer = (BuilderQueue*) ctx->getMemoryChunk("builder", true);
         nextBuffer->next = nullptr;
         nextBuffer->id = lastBuffer->id + 1;
         nextBuffer->data = ((uint8_t*)nextBuffer) + sizeof(struct BuilderQueue);
+        // Message in progress is not moved, it continues in the next buffer and the writer reads it as a list of segments
+        nextBuffer->length = 0;
 
-        // Message could potentially fit in one buffer
-        if (copy && msg != nullptr && sizeof(struct BuilderMsg) + messageLength < OUTPUT_BUFFER_DATA_SIZE) {
-            memcpy((void*)nextBuffer->data, (void*)msg, sizeof(struct BuilderMsg) + messageLength);
-            msg = (BuilderMsg*)nextBuffer->data;
-            msg->data = nextBuffer->data + sizeof(struct BuilderMsg);
-            nextBuffer->length = sizeof(struct BuilderMsg) + messageLength;
-            lastBuffer->length -= sizeof(struct BuilderMsg) + messageLength;
-        } else
-            nextBuffer->length = 0;
+        // Single producer: final length of the buffer is published before the link to the next one
+        ++buffersAllocated;
+        lastBuffer->next.store(nextBuffer, std::memory_order_release);
+        lastBuffer = nextBuffer;
 
-        {
-            std::unique_lock<std::mutex> lck(mtx);
-            lastBuffer->next = nextBuffer;
-            ++buffersAllocated;
-            lastBuffer = nextBuffer;
+        if (readers.size() > 1)
+            checkReadersLag();
+    }
+
+    void Builder::checkReadersLag() {
+        uint64_t active = 0;
+        for (BuilderReader* reader : readers)
+            if (reader->state == BUILDER_READER_ACTIVE)
+                ++active;
+
+        // The last active reader is never detached
+        for (BuilderReader* reader : readers) {
+            if (active <= 1)
+                return;
+            if (reader->state != BUILDER_READER_ACTIVE || reader->maxLag == 0 || lastBuffer->id - reader->releasedId <= reader->maxLag)
+                continue;
+
+            WARNING("writer " << std::dec << reader->num << " is lagging " << (lastBuffer->id - reader->releasedId) <<
+                    " buffers behind, detaching")
+            // Buffers are held until the writer drops the messages which still reference them
+            reader->state = BUILDER_READER_LAGGING;
+            --active;
+            wakeUp();
+        }
+    }
+
+    void Builder::builderAppendSpan(const char* str, uint64_t length) {
+        while (length > 0) {
+            uint64_t toCopy = OUTPUT_BUFFER_DATA_SIZE - lastBuffer->length;
+            if (toCopy > length)
+                toCopy = length;
+
+            memcpy((void*)(lastBuffer->data + lastBuffer->length), (const void*)str, toCopy);
+            messageLength += toCopy;
+            str += toCopy;
+            length -= toCopy;
+            builderShift(toCopy);
         }
     }
 
     uint64_t Builder::builderSize() const {
-        return ((messageLength + 7) & 0xFFFFFFFFFFFFFFF8) + sizeof(struct BuilderMsg);
+        // Row changes collected for net change are sent before the end of the transaction, tag is stored between header and data
+        uint64_t tagLength8 = (msg != nullptr) ? (uint64_t)(msg->data - msg->tag) : 0;
+        return ((messageLength + 7) & 0xFFFFFFFFFFFFFFF8) + sizeof(struct BuilderMsg) + tagLength8 + netSize;
     }
 
     uint64_t Builder::getMaxMessageMb() const {
         return maxMessageMb;
     }
 
+    uint64_t Builder::getNetSize() const {
+        return netSize;
+    }
+
+    uint64_t Builder::getMessageFormat() const {
+        return messageFormat;
+    }
+
+    uint64_t Builder::getMessageKey() const {
+        return messageKey;
+    }
+
     void Builder::setMaxMessageMb(uint64_t maxMessageMb_) {
         maxMessageMb = maxMessageMb_;
     }
 
+    void Builder::setNetChange(bool newNetChange) {
+        netChange = newNetChange;
+    }
+
+    void Builder::setRawFormat(uint64_t newRawFormat) {
+        rawFormat = newRawFormat;
+    }
+
+    void Builder::setRowKeys(bool newRowKeys) {
+        rowKeys = newRowKeys;
+    }
+
+    void Builder::setMessageKey(uint64_t newMessageKey) {
+        messageKey = newMessageKey;
+    }
+
+    void Builder::setTableTags(bool newTableTags) {
+        tableTags = newTableTags;
+    }
+
+    void Builder::setSentRows(std::vector<BuilderNetRow*>* newSentRows, uint64_t* newSentSize, bool newSentReplay) {
+        sentRows = newSentRows;
+        sentSize = newSentSize;
+        sentReplay = newSentReplay;
+    }
+
+    void Builder::resetObjects() {
+        objects.clear();
+    }
+
     void Builder::processBegin(typeScn scn, typeTime time_, typeSeq sequence, typeXid xid, bool system) {
         if (system && !FLAG(REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS))
             return;
@@ -343,6 +580,303 @@ namespace OpenLogReplicator {
         lastSequence = sequence;
         lastXid = xid;
         newTran = true;
+        continuedTran = false;
+    }
+
+    // Next part of transaction which was already partially sent
+    void Builder::processContinue(typeScn scn, typeTime time_, typeSeq sequence, typeXid xid) {
+        lastTime = time_;
+        lastScn = scn;
+        lastSequence = sequence;
+        lastXid = xid;
+        newTran = true;
+        continuedTran = true;
+    }
+
+    void Builder::processRow(uint64_t type, OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid) {
+        if (netChange) {
+            netChangeAdd(type, object, dataObj, bdba, slot, xid);
+            return;
+        }
+
+        // Rows of transaction sent in parts are kept for rollback, the ones sent before restart are not sent again
+        if (sentRows != nullptr) {
+            BuilderNetRow* row = netRowCreate(type, object, dataObj, bdba, slot, xid);
+            row->size = sizeof(BuilderNetRow) + netChangeMerge(row, true, true);
+            *sentSize += row->size;
+            sentRows->push_back(row);
+            if (sentReplay)
+                return;
+        }
+
+        if (rowKeys || messageKey != MESSAGE_KEY_NONE || tableTags)
+            processRowKey(object, type, dataObj, bdba, slot);
+
+        if (type == TRANSACTION_INSERT)
+            processInsert(object, dataObj, bdba, slot, xid);
+        else if (type == TRANSACTION_DELETE)
+            processDelete(object, dataObj, bdba, slot, xid);
+        else
+            processUpdate(object, dataObj, bdba, slot, xid);
+        rowKeyRelease();
+    }
+
+    // FNV-1a hash of primary key values or rowid, used by writers to route messages of one row to the same shard,
+    // message key is text of primary key values separated by comma or rowid
+    void Builder::processRowKey(OracleObject* object, uint64_t type, typeDataObj dataObj, typeDba bdba, typeSlot slot) {
+        rowKeyRelease();
+
+        if (messageKey == MESSAGE_KEY_ROWID) {
+            typeRowId rowId(dataObj, bdba, slot);
+            char str[19];
+            rowId.toString(str);
+            rowKeyData.assign(str, 18);
+        }
+
+        uint64_t hash = 0xCBF29CE484222325ULL;
+
+        // Rows of table without primary key are routed by rowid, so that they are spread over all shards
+        if (object == nullptr || object->pk.empty()) {
+            uint64_t rowIdValues[3] = {dataObj, bdba, slot};
+            for (uint64_t value : rowIdValues) {
+                for (uint64_t i = 0; i < 64; i += 8) {
+                    hash ^= (value >> i) & 0xFF;
+                    hash *= 0x100000001B3ULL;
+                }
+            }
+            rowKey = hash;
+            return;
+        }
+
+        for (typeCol column : object->pk) {
+            uint64_t image = (type == TRANSACTION_DELETE) ? VALUE_BEFORE : VALUE_AFTER;
+            if (values[column][image] == nullptr)
+                image = (image == VALUE_AFTER) ? VALUE_BEFORE : VALUE_AFTER;
+            const uint8_t* data = values[column][image];
+            uint64_t length = lengths[column][image];
+            if (data == nullptr)
+                length = 0;
+
+            for (uint64_t i = 0; i < length; ++i) {
+                hash ^= data[i];
+                hash *= 0x100000001B3ULL;
+            }
+            // Column separator
+            hash ^= 0xFF;
+            hash *= 0x100000001B3ULL;
+
+            if (messageKey != MESSAGE_KEY_PRIMARY_KEY)
+                continue;
+            if (column != object->pk.front())
+                rowKeyData.push_back(',');
+            if (length == 0)
+                continue;
+
+            OracleColumn* oracleColumn = object->columns[column];
+            if (oracleColumn->type == SYS_COL_TYPE_VARCHAR || oracleColumn->type == SYS_COL_TYPE_CHAR) {
+                parseString(data, length, oracleColumn->charsetId);
+                rowKeyData.append(valueBuffer, valueLength);
+            } else if (oracleColumn->type == SYS_COL_TYPE_NUMBER) {
+                parseNumber(data, length);
+                rowKeyData.append(valueBuffer, valueLength);
+            } else {
+                for (uint64_t i = 0; i < length; ++i) {
+                    rowKeyData.push_back(map16[data[i] >> 4]);
+                    rowKeyData.push_back(map16[data[i] & 0x0F]);
+                }
+            }
+        }
+        rowKey = hash;
+
+        // Too long key is replaced by its hash
+        if (rowKeyData.length() > MESSAGE_KEY_MAX_LENGTH) {
+            rowKeyData.clear();
+            for (int64_t i = 60; i >= 0; i -= 4)
+                rowKeyData.push_back(map16[(hash >> i) & 0x0F]);
+        }
+    }
+
+    void Builder::netChangeAdd(uint64_t type, OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid) {
+        typeRowId rowId(dataObj, bdba, slot);
+        bool compressed = compressedBefore || compressedAfter || (bdba == 0 && slot == 0);
+
+        auto netRowMapIt = netRowMap.find(rowId);
+        if (netRowMapIt != netRowMap.end() && !compressed) {
+            BuilderNetRow* row = netRowMapIt->second;
+
+            // Insert + update = insert
+            if (row->type == TRANSACTION_INSERT && type == TRANSACTION_UPDATE) {
+                netSize += netChangeMerge(row, false, true);
+                return;
+            }
+
+            // Insert + delete = nothing
+            if (row->type == TRANSACTION_INSERT && type == TRANSACTION_DELETE) {
+                row->type = 0;
+                row->columns.clear();
+                netRowMap.erase(netRowMapIt);
+                return;
+            }
+
+            // Update + update = update
+            if (row->type == TRANSACTION_UPDATE && type == TRANSACTION_UPDATE) {
+                netSize += netChangeMerge(row, true, true);
+                return;
+            }
+
+            // Update + delete = delete
+            if (row->type == TRANSACTION_UPDATE && type == TRANSACTION_DELETE) {
+                row->type = TRANSACTION_DELETE;
+                netSize += netChangeMerge(row, true, false);
+                for (auto& columnIt : row->columns) {
+                    columnIt.second.after = false;
+                    columnIt.second.afterData.clear();
+                }
+                return;
+            }
+        }
+
+        BuilderNetRow* row = netRowCreate(type, object, dataObj, bdba, slot, xid);
+        netSize += sizeof(BuilderNetRow) + netChangeMerge(row, true, true);
+        netRows.push_back(row);
+
+        // Other sequences of operations are not merged, the next operation starts a new row
+        if (compressed)
+            netRowMap.erase(rowId);
+        else
+            netRowMap[rowId] = row;
+
+        // Limit memory used for collected rows, the current row is already copied
+        if (netSize > NET_CHANGE_MAX_SIZE) {
+            valuesRelease();
+            netChangeFlush();
+        }
+    }
+
+    BuilderNetRow* Builder::netRowCreate(uint64_t type, OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid) {
+        auto row = new BuilderNetRow;
+        row->type = type;
+        row->object = object;
+        row->dataObj = dataObj;
+        row->bdba = bdba;
+        row->slot = slot;
+        row->xid = xid;
+        row->compressedBefore = compressedBefore;
+        row->compressedAfter = compressedAfter;
+        row->ops = rowOps;
+        row->size = 0;
+        return row;
+    }
+
+    // Returns number of bytes added to the row
+    uint64_t Builder::netChangeMerge(BuilderNetRow* row, bool before, bool after) {
+        uint64_t size = 0;
+        uint64_t baseMax = valuesMax >> 6;
+        for (uint64_t base = 0; base <= baseMax; ++base) {
+            auto column = (typeCol)(base << 6);
+            for (uint64_t mask = 1; mask != 0; mask <<= 1, ++column) {
+                if (valuesSet[base] < mask)
+                    break;
+                if ((valuesSet[base] & mask) == 0)
+                    continue;
+
+                auto columnIt = row->columns.find(column);
+                if (columnIt == row->columns.end()) {
+                    columnIt = row->columns.emplace(column, BuilderNetValue{false, false, "", ""}).first;
+                    size += sizeof(typeCol) + sizeof(BuilderNetValue);
+                }
+                BuilderNetValue& netValue = columnIt->second;
+                // Keep the oldest before image
+                if (before && !netValue.before && values[column][VALUE_BEFORE] != nullptr) {
+                    netValue.before = true;
+                    if (lengths[column][VALUE_BEFORE] > 0)
+                        netValue.beforeData.assign((const char*)values[column][VALUE_BEFORE], lengths[column][VALUE_BEFORE]);
+                    size += lengths[column][VALUE_BEFORE];
+                }
+
+                // Keep the newest after image
+                if (after && values[column][VALUE_AFTER] != nullptr) {
+                    netValue.after = true;
+                    size += lengths[column][VALUE_AFTER] - netValue.afterData.length();
+                    if (lengths[column][VALUE_AFTER] > 0)
+                        netValue.afterData.assign((const char*)values[column][VALUE_AFTER], lengths[column][VALUE_AFTER]);
+                    else
+                        netValue.afterData.clear();
+                }
+            }
+        }
+        return size;
+    }
+
+    void Builder::netChangeFlush() {
+        for (BuilderNetRow* row : netRows) {
+            if (row->type != 0)
+                processNetRow(row, false);
+            delete row;
+        }
+        netRows.clear();
+        netRowMap.clear();
+        netSize = 0;
+    }
+
+    // Null value is represented by not empty pointer and zero length
+    void Builder::netRowValue(typeCol column, uint64_t image, const std::string& data) {
+        uint64_t base = column >> 6;
+        uint64_t mask = ((uint64_t)1) << (column & 0x3F);
+        valuesSet[base] |= mask;
+        if ((uint64_t)column >= valuesMax)
+            valuesMax = column + 1;
+
+        lengths[column][image] = data.length();
+        values[column][image] = data.length() > 0 ? (uint8_t*)data.data() : (uint8_t*)1;
+    }
+
+    // Revert sends the opposite change: insert for delete, delete for insert and update back to the old values
+    void Builder::processNetRow(BuilderNetRow* row, bool revert) {
+        uint64_t type = row->type;
+        if (revert && type == TRANSACTION_INSERT)
+            type = TRANSACTION_DELETE;
+        else if (revert && type == TRANSACTION_DELETE)
+            type = TRANSACTION_INSERT;
+
+        for (auto& columnIt : row->columns) {
+            typeCol column = columnIt.first;
+            BuilderNetValue& netValue = columnIt.second;
+
+            if (!revert) {
+                if (netValue.before)
+                    netRowValue(column, VALUE_BEFORE, netValue.beforeData);
+                if (netValue.after)
+                    netRowValue(column, VALUE_AFTER, netValue.afterData);
+            } else if (row->type != TRANSACTION_UPDATE) {
+                if (netValue.after)
+                    netRowValue(column, VALUE_BEFORE, netValue.afterData);
+                if (netValue.before)
+                    netRowValue(column, VALUE_AFTER, netValue.beforeData);
+            } else if (netValue.after) {
+                // Changed column gets the old value back
+                netRowValue(column, VALUE_BEFORE, netValue.afterData);
+                if (netValue.before)
+                    netRowValue(column, VALUE_AFTER, netValue.beforeData);
+            } else if (netValue.before) {
+                // Not changed column, like supplementally logged key
+                netRowValue(column, VALUE_BEFORE, netValue.beforeData);
+            }
+        }
+        compressedBefore = revert ? row->compressedAfter : row->compressedBefore;
+        compressedAfter = revert ? row->compressedBefore : row->compressedAfter;
+        if (rowKeys || messageKey != MESSAGE_KEY_NONE || tableTags)
+            processRowKey(row->object, type, row->dataObj, row->bdba, row->slot);
+
+        if (type == TRANSACTION_INSERT)
+            processInsert(row->object, row->dataObj, row->bdba, row->slot, row->xid);
+        else if (type == TRANSACTION_DELETE)
+            processDelete(row->object, row->dataObj, row->bdba, row->slot, row->xid);
+        else
+            processUpdate(row->object, row->dataObj, row->bdba, row->slot, row->xid);
+        rowKeyRelease();
+
+        valuesRelease();
     }
 
     // 0x05010B0B
@@ -354,6 +888,7 @@ namespace OpenLogReplicator {
         uint16_t fieldLength = 0;
         uint16_t colLength = 0;
         OracleObject* object = metadata->schema->checkDict(redoLogRecord1->obj, redoLogRecord1->dataObj);
+        rowOps = 1;
 
         // Ignore DML statements during system transaction
         if (system && object != nullptr && object->systemTable == 0)
@@ -413,8 +948,8 @@ namespace OpenLogReplicator {
                                   ctx->read16(redoLogRecord2->data + redoLogRecord2->slotsDelta + r * 2), redoLogRecord1->xid);
             } else {
                 if (object == nullptr || (object->options & OPTIONS_DEBUG_TABLE) == 0)
-                    processInsert(object, redoLogRecord2->dataObj, redoLogRecord2->bdba,
-                                  ctx->read16(redoLogRecord2->data + redoLogRecord2->slotsDelta + r * 2), redoLogRecord1->xid);
+                    processRow(TRANSACTION_INSERT, object, redoLogRecord2->dataObj, redoLogRecord2->bdba,
+                               ctx->read16(redoLogRecord2->data + redoLogRecord2->slotsDelta + r * 2), redoLogRecord1->xid);
             }
 
             valuesRelease();
@@ -432,6 +967,7 @@ namespace OpenLogReplicator {
         uint16_t fieldLength = 0;
         uint16_t colLength = 0;
         OracleObject* object = metadata->schema->checkDict(redoLogRecord1->obj, redoLogRecord1->dataObj);
+        rowOps = 1;
 
         // Ignore DML statements during system transaction
         if (system && object != nullptr && object->systemTable == 0)
@@ -491,8 +1027,8 @@ namespace OpenLogReplicator {
                                   ctx->read16(redoLogRecord1->data + redoLogRecord1->slotsDelta + r * 2), redoLogRecord1->xid);
             } else {
                 if (object == nullptr || (object->options & OPTIONS_DEBUG_TABLE) == 0)
-                    processDelete(object, redoLogRecord2->dataObj, redoLogRecord2->bdba,
-                                  ctx->read16(redoLogRecord1->data + redoLogRecord1->slotsDelta + r * 2), redoLogRecord1->xid);
+                    processRow(TRANSACTION_DELETE, object, redoLogRecord2->dataObj, redoLogRecord2->bdba,
+                               ctx->read16(redoLogRecord1->data + redoLogRecord1->slotsDelta + r * 2), redoLogRecord1->xid);
             }
 
             valuesRelease();
@@ -510,6 +1046,14 @@ namespace OpenLogReplicator {
         RedoLogRecord* redoLogRecord2p = nullptr;
         OracleObject* object = metadata->schema->checkDict(redoLogRecord1->obj, redoLogRecord1->dataObj);
 
+        // Row pieces, each one is reverted by own rollback operation
+        rowOps = 0;
+        for (RedoLogRecord* redoLogRecord2r = redoLogRecord2; redoLogRecord2r != nullptr; redoLogRecord2r = redoLogRecord2r->next) {
+            if (redoLogRecord2r->opCode == 0x0B02 || redoLogRecord2r->opCode == 0x0B03 || redoLogRecord2r->opCode == 0x0B05 ||
+                    redoLogRecord2r->opCode == 0x0B06)
+                ++rowOps;
+        }
+
         // Ignore DML statements during system transaction
         if (system && object != nullptr && object->systemTable == 0)
             return;
@@ -1045,7 +1589,7 @@ namespace OpenLogReplicator {
                     processUpdate(object, dataObj, bdba, slot, redoLogRecord1->xid);
             } else {
                 if (object == nullptr || (object->options & OPTIONS_DEBUG_TABLE) == 0)
-                    processUpdate(object, dataObj, bdba, slot, redoLogRecord1->xid);
+                    processRow(TRANSACTION_UPDATE, object, dataObj, bdba, slot, redoLogRecord1->xid);
             }
 
         } else if (type == TRANSACTION_INSERT) {
@@ -1103,7 +1647,7 @@ namespace OpenLogReplicator {
                     processInsert(object, dataObj, bdba, slot, redoLogRecord1->xid);
             } else {
                 if (object == nullptr || (object->options & OPTIONS_DEBUG_TABLE) == 0)
-                    processInsert(object, dataObj, bdba, slot, redoLogRecord1->xid);
+                    processRow(TRANSACTION_INSERT, object, dataObj, bdba, slot, redoLogRecord1->xid);
             }
 
         } else if (type == TRANSACTION_DELETE) {
@@ -1161,7 +1705,7 @@ namespace OpenLogReplicator {
                     processDelete(object, dataObj, bdba, slot, redoLogRecord1->xid);
             } else {
                 if (object == nullptr || (object->options & OPTIONS_DEBUG_TABLE) == 0)
-                    processDelete(object, dataObj, bdba, slot, redoLogRecord1->xid);
+                    processRow(TRANSACTION_DELETE, object, dataObj, bdba, slot, redoLogRecord1->xid);
             }
         }
 
@@ -1170,6 +1714,10 @@ namespace OpenLogReplicator {
 
     // 0x18010000
     void Builder::processDdlHeader(RedoLogRecord* redoLogRecord1) {
+        // Part of the transaction already sent before restart is not sent again
+        if (sentRows != nullptr && sentReplay)
+            return;
+
         uint64_t fieldPos = 0;
         uint64_t sqlLength;
         typeField fieldNum = 0;
@@ -1216,6 +1764,10 @@ namespace OpenLogReplicator {
         sqlLength = fieldLength;
         sqlText = (char*)redoLogRecord1->data + fieldPos;
 
+        // Keep order of row changes and DDL
+        if (netChange)
+            netChangeFlush();
+
         if (type == 85)
             processDdl(object, redoLogRecord1->dataObj, type, seq, "truncate", sqlText, sqlLength - 1);
         else if (type == 12)
@@ -1226,17 +1778,50 @@ namespace OpenLogReplicator {
             processDdl(object, redoLogRecord1->dataObj, type, seq, "?", sqlText, sqlLength - 1);
     }
 
-    void Builder::releaseBuffers(uint64_t maxId) {
-        BuilderQueue* tmpFirstBuffer = nullptr;
-        {
-            std::unique_lock<std::mutex> lck(mtx);
-            tmpFirstBuffer = firstBuffer;
-            while (firstBuffer->id < maxId) {
-                firstBuffer = firstBuffer->next;
-                --buffersAllocated;
+    BuilderReader* Builder::addReader(uint64_t maxLagMb) {
+        auto* reader = new BuilderReader;
+        reader->num = readers.size();
+        // Rounded up, a limit below one buffer still detaches a lagging writer
+        reader->maxLag = (maxLagMb * 1024 * 1024 + MEMORY_CHUNK_SIZE - 1) / MEMORY_CHUNK_SIZE;
+        reader->releasedId = 0;
+        reader->state = BUILDER_READER_ACTIVE;
+        readers.push_back(reader);
+        return reader;
+    }
+
+    BuilderQueue* Builder::getFirstBuffer() {
+        std::unique_lock<std::mutex> lck(mtxRelease, std::defer_lock);
+        if (readers.size() > 1)
+            lck.lock();
+        return firstBuffer;
+    }
+
+    void Builder::releaseBuffers(BuilderReader* reader, uint64_t maxId) {
+        if (maxId > reader->releasedId)
+            reader->releasedId = maxId;
+
+        // Many readers: release only what the slowest attached reader has confirmed, detaching reader has dropped its unconfirmed messages
+        std::unique_lock<std::mutex> lck(mtxRelease, std::defer_lock);
+        if (readers.size() > 1) {
+            lck.lock();
+            maxId = 0;
+            bool found = false;
+            for (BuilderReader* otherReader : readers) {
+                if (otherReader->state == BUILDER_READER_DETACHING || otherReader->state == BUILDER_READER_DETACHED)
+                    continue;
+                if (!found || otherReader->releasedId < maxId)
+                    maxId = otherReader->releasedId;
+                found = true;
             }
         }
 
+        // Only readers move firstBuffer, the builder only appends after lastBuffer
+        BuilderQueue* tmpFirstBuffer = firstBuffer;
+        while (firstBuffer->id < maxId) {
+            firstBuffer = firstBuffer->next.load(std::memory_order_acquire);
+            --buffersAllocated;
+        }
+
         if (tmpFirstBuffer != nullptr) {
             while (tmpFirstBuffer->id < maxId) {
                 BuilderQueue* nextBuffer = tmpFirstBuffer->next;
@@ -1246,15 +1831,29 @@ namespace OpenLogReplicator {
         }
     }
 
-    void Builder::sleepForWriterWork(uint64_t queueSize, uint64_t nanoseconds) {
+    uint64_t Builder::getFlushSeq() const {
+        return flushSeq.load(std::memory_order_acquire);
+    }
+
+    void Builder::sleepForWriterWork(uint64_t seq, uint64_t queueSize, uint64_t nanoseconds) {
+        // Short spin before parking, the builder touches the mutex only when the writer is parked
+        for (uint64_t i = 0; i < BUILDER_SPIN_COUNT; ++i) {
+            if (flushSeq.load(std::memory_order_acquire) != seq)
+                return;
+            std::this_thread::yield();
+        }
+
         std::unique_lock<std::mutex> lck(mtx);
+        ++writersParked;
         if (queueSize > 0)
-            condNoWriterWork.wait_for(lck, std::chrono::nanoseconds(nanoseconds));
+            condNoWriterWork.wait_for(lck, std::chrono::nanoseconds(nanoseconds), [&] { return flushSeq != seq; });
         else
-            condNoWriterWork.wait_for(lck, std::chrono::seconds(5));
+            condNoWriterWork.wait_for(lck, std::chrono::seconds(5), [&] { return flushSeq != seq; });
+        --writersParked;
     }
 
     void Builder::wakeUp() {
+        ++flushSeq;
         std::unique_lock<std::mutex> lck(mtx);
         condNoWriterWork.notify_all();
     }
@@ -23,10 +23,13 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 #include <mutex>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "../common/Ctx.h"
+#include "../common/OracleObject.h"
 #include "../common/RuntimeException.h"
 #include "../common/types.h"
+#include "../common/typeRowId.h"
 #include "../common/typeTime.h"
 #include "../common/typeXid.h"
 #include "../locales/CharacterSet.h"
@@ -37,7 +40,17 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 
 #define OUTPUT_BUFFER_DATA_SIZE                 (MEMORY_CHUNK_SIZE - sizeof(struct BuilderQueue))
 #define OUTPUT_BUFFER_ALLOCATED                 0x0001
-#define OUTPUT_BUFFER_CONFIRMED                 0x0002
+#define OUTPUT_BUFFER_SEGMENTED                 0x0002
+#define BUILDER_SPIN_COUNT                      1000
+#define BUILDER_READER_ACTIVE                   0
+#define BUILDER_READER_LAGGING                  1
+#define BUILDER_READER_DETACHING                2
+#define BUILDER_READER_DETACHED                 3
+#define MESSAGE_KEY_NONE                        0
+#define MESSAGE_KEY_PRIMARY_KEY                 1
+#define MESSAGE_KEY_ROWID                       2
+#define MESSAGE_KEY_MAX_LENGTH                  4096
+#define NET_CHANGE_MAX_SIZE                     (64 * 1024 * 1024)
 
 namespace OpenLogReplicator {
     class Ctx;
@@ -56,6 +69,14 @@ namespace OpenLogReplicator {
         std::atomic<BuilderQueue*> next;
     };
 
+    // Progress of one writer reading the output buffers
+    struct BuilderReader {
+        uint64_t num;
+        uint64_t maxLag;
+        std::atomic<uint64_t> releasedId;
+        std::atomic<uint64_t> state;
+    };
+
     struct BuilderMsg {
         void* ptr;
         uint64_t id;
@@ -67,6 +88,35 @@ namespace OpenLogReplicator {
         typeObj obj;
         uint16_t pos;
         uint16_t flags;
+        uint64_t key;
+        // Owner, table and key stored between header and data
+        uint8_t* tag;
+        uint16_t ownerLength;
+        uint16_t tableLength;
+        uint32_t keyLength;
+    };
+
+    struct BuilderNetValue {
+        bool before;
+        bool after;
+        std::string beforeData;
+        std::string afterData;
+    };
+
+    // Net change of one row within a transaction
+    struct BuilderNetRow {
+        uint64_t type;
+        OracleObject* object;
+        typeDataObj dataObj;
+        typeDba bdba;
+        typeSlot slot;
+        typeXid xid;
+        bool compressedBefore;
+        bool compressedAfter;
+        // Redo operations (row pieces) of the row and memory used by the copy
+        uint64_t ops;
+        uint64_t size;
+        std::map<typeCol, BuilderNetValue> columns;
     };
 
     class Builder {
@@ -95,6 +145,10 @@ namespace OpenLogReplicator {
         uint64_t flushBuffer;
         char valueBuffer[MAX_FIELD_LENGTH];
         uint64_t valueLength;
+        // Two decimal digits for every byte of NUMBER mantissa
+        char numberPairsPositive[512];
+        char numberPairsNegative[512];
+        typeUInt128 decimalPowers[39];
         std::unordered_set<OracleObject*> objects;
         typeTime lastTime;
         typeScn lastScn;
@@ -113,14 +167,53 @@ namespace OpenLogReplicator {
         uint64_t num;
         uint64_t maxMessageMb;      // Maximum message size able to handle by writer
         bool newTran;
+        bool continuedTran;
         bool compressedBefore;
         bool compressedAfter;
+        bool netChange;
+        uint64_t rawFormat;
+        bool rowKeys;
+        uint64_t rowKey;
+        uint64_t messageKey;
+        bool tableTags;
+        std::string rowKeyData;
+        std::vector<BuilderNetRow*> netRows;
+        std::unordered_map<typeRowId, BuilderNetRow*> netRowMap;
+        uint64_t netSize;
+        // Rows of streamed transaction, kept for compensation of rollback
+        std::vector<BuilderNetRow*>* sentRows;
+        uint64_t* sentSize;
+        bool sentReplay;
+        uint64_t rowOps;
 
         std::mutex mtx;
         std::condition_variable condNoWriterWork;
-
-        void builderRotate(bool copy);
+        std::atomic<uint64_t> flushSeq;
+        std::atomic<uint64_t> writersParked;
+        // Buffers are released when confirmed by all attached readers
+        std::mutex mtxRelease;
+        std::vector<BuilderReader*> readers;
+
+        bool decodeDecimal(const uint8_t* data, uint64_t length, int64_t scale, typeInt128& value) const;
+        static int64_t daysFromCivil(int64_t year, uint64_t month, uint64_t day);
+        static int64_t epochMicros(struct tm& epochTime, uint64_t fraction);
+        void valueBufferTimestamp(struct tm& epochTime, uint64_t fraction, const char* tz);
+        void builderRotate();
+        void builderAppendSpan(const char* str, uint64_t length);
+        void checkReadersLag();
         void processValue(OracleObject* object, typeCol col, const uint8_t* data, uint64_t length, bool compressed);
+        void processRow(uint64_t type, OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid);
+        BuilderNetRow* netRowCreate(uint64_t type, OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid);
+        void netRowValue(typeCol column, uint64_t image, const std::string& data);
+        void netChangeAdd(uint64_t type, OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid);
+        uint64_t netChangeMerge(BuilderNetRow* row, bool before, bool after);
+        void netChangeFlush();
+        void processRowKey(OracleObject* object, uint64_t type, typeDataObj dataObj, typeDba bdba, typeSlot slot);
+
+        void rowKeyRelease() {
+            rowKey = 0;
+            rowKeyData.clear();
+        }
 
         void valuesRelease() {
             for (uint64_t i = 0; i < mergesMax; ++i)
@@ -148,6 +241,11 @@ namespace OpenLogReplicator {
             compressedAfter = false;
         };
 
+        // Column is present in redo, also with null value
+        [[nodiscard]] bool isValueSet(typeCol column) const {
+            return (valuesSet[column >> 6] & (((uint64_t)1) << (column & 0x3F))) != 0;
+        }
+
         void valueSet(uint64_t type, uint16_t column, uint8_t* data, uint16_t length, uint8_t fb) {
             if ((ctx->trace2 & TRACE2_DML) != 0) {
                 std::stringstream strStr;
@@ -197,25 +295,47 @@ namespace OpenLogReplicator {
             }
         };
 
-        void builderShift(uint64_t bytes, bool copy) {
-            lastBuffer->length += bytes;
+        // Only the builder thread modifies length, the writer reads it with acquire semantics
+        void builderShift(uint64_t bytes) {
+            uint64_t length = lastBuffer->length.load(std::memory_order_relaxed) + bytes;
+            lastBuffer->length.store(length, std::memory_order_release);
 
-            if (lastBuffer->length >= OUTPUT_BUFFER_DATA_SIZE)
-                builderRotate(copy);
+            if (length >= OUTPUT_BUFFER_DATA_SIZE)
+                builderRotate();
         };
 
         void builderShiftFast(uint64_t bytes) const {
-            lastBuffer->length += bytes;
+            lastBuffer->length.store(lastBuffer->length.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
         };
 
         void builderBegin(typeObj obj) {
+            builderBeginTagged(obj, nullptr, false);
+        };
+
+        // Message of one row carries owner and name of the table and key of the row, other messages of the transaction don't
+        void builderBeginRow(OracleObject* object) {
+            builderBeginTagged((object != nullptr) ? object->obj : 0, object, true);
+        };
+
+        void builderBeginTagged(typeObj obj, OracleObject* tagObject, bool tagKey) {
             messageLength = 0;
 
-            if (lastBuffer->length + sizeof(struct BuilderMsg) >= OUTPUT_BUFFER_DATA_SIZE)
-                builderRotate(true);
+            uint64_t ownerLength = 0;
+            uint64_t tableLength = 0;
+            uint64_t keyLength = 0;
+            if (tagObject != nullptr && tableTags) {
+                ownerLength = tagObject->owner.length();
+                tableLength = tagObject->name.length();
+            }
+            if (tagKey)
+                keyLength = rowKeyData.length();
+            uint64_t tagLength8 = (ownerLength + tableLength + keyLength + 7) & 0xFFFFFFFFFFFFFFF8;
+
+            if (lastBuffer->length + sizeof(struct BuilderMsg) + tagLength8 >= OUTPUT_BUFFER_DATA_SIZE)
+                builderRotate();
 
+            // Header must be complete before the buffer length makes it visible to the writer
             msg = (BuilderMsg*)(lastBuffer->data + lastBuffer->length);
-            builderShift(sizeof(struct BuilderMsg), true);
             msg->scn = lastScn;
             msg->sequence = lastSequence;
             msg->length = 0;
@@ -223,7 +343,19 @@ namespace OpenLogReplicator {
             msg->obj = obj;
             msg->pos = 0;
             msg->flags = 0;
-            msg->data = lastBuffer->data + lastBuffer->length;
+            msg->key = tagKey ? rowKey : 0;
+            msg->tag = lastBuffer->data + lastBuffer->length + sizeof(struct BuilderMsg);
+            msg->ownerLength = ownerLength;
+            msg->tableLength = tableLength;
+            msg->keyLength = keyLength;
+            if (ownerLength > 0) {
+                memcpy((void*)msg->tag, (const void*)tagObject->owner.c_str(), ownerLength);
+                memcpy((void*)(msg->tag + ownerLength), (const void*)tagObject->name.c_str(), tableLength);
+            }
+            if (msg->keyLength > 0)
+                memcpy((void*)(msg->tag + ownerLength + tableLength), (const void*)rowKeyData.c_str(), msg->keyLength);
+            msg->data = msg->tag + tagLength8;
+            builderShift(sizeof(struct BuilderMsg) + tagLength8);
         };
 
         void builderCommit(bool force) {
@@ -232,12 +364,14 @@ namespace OpenLogReplicator {
             }
 
             msg->queueId = lastBuffer->id;
-            builderShift((8 - (messageLength & 7)) & 7, false);
+            builderShift((8 - (messageLength & 7)) & 7);
             unconfirmedLength += messageLength;
-            msg->length = messageLength;
+            __atomic_store_n(&msg->length, messageLength, __ATOMIC_RELEASE);
 
             if (force || flushBuffer == 0 || unconfirmedLength > flushBuffer) {
-                {
+                // Mutex is only touched when the writer is parked
+                ++flushSeq;
+                if (writersParked > 0) {
                     std::unique_lock<std::mutex> lck(mtx);
                     condNoWriterWork.notify_all();
                 }
@@ -249,18 +383,16 @@ namespace OpenLogReplicator {
         void builderAppend(char character) {
             lastBuffer->data[lastBuffer->length] = character;
             ++messageLength;
-            builderShift(1, true);
+            builderShift(1);
         };
 
         void builderAppend(const char* str, uint64_t length) {
             if (lastBuffer->length + length < OUTPUT_BUFFER_DATA_SIZE) {
                 memcpy((void*)(lastBuffer->data + lastBuffer->length), (void*)str, length);
-                lastBuffer->length += length;
+                lastBuffer->length.store(lastBuffer->length.load(std::memory_order_relaxed) + length, std::memory_order_release);
                 messageLength += length;
-            } else {
-                for (uint64_t i = 0; i < length; ++i)
-                    builderAppend(*str++);
-            }
+            } else
+                builderAppendSpan(str, length);
         };
 
         void builderAppend(const char* str) {
@@ -275,13 +407,10 @@ namespace OpenLogReplicator {
             uint64_t length = str.length();
             if (lastBuffer->length + length < OUTPUT_BUFFER_DATA_SIZE) {
                 memcpy(lastBuffer->data + lastBuffer->length, str.c_str(), length);
-                lastBuffer->length += length;
+                lastBuffer->length.store(lastBuffer->length.load(std::memory_order_relaxed) + length, std::memory_order_release);
                 messageLength += length;
-            } else {
-                const char* charstr = str.c_str();
-                for (uint64_t i = 0; i < length; ++i)
-                    builderAppend(*charstr++);
-            }
+            } else
+                builderAppendSpan(str.c_str(), length);
         };
 
         void columnUnknown(std::string& columnName, const uint8_t* data, uint64_t length) {
@@ -312,142 +441,97 @@ namespace OpenLogReplicator {
         };
 
         void parseNumber(const uint8_t* data, uint64_t length) {
-            valueLength = 0;
             if (length * 2 + 2 >= MAX_FIELD_LENGTH)
                 throw RuntimeException("length of value exceeded " + std::to_string(MAX_FIELD_LENGTH) +
                                        ", increase MAX_FIELD_LENGTH and recompile code");
 
+            char* out = valueBuffer;
             uint8_t digits = data[0];
             // Just zero
             if (digits == 0x80) {
-                valueBufferAppend('0');
+                *out++ = '0';
             } else {
                 uint64_t j = 1;
                 uint64_t jMax = length - 1;
+                uint64_t zeros = 0;
+                const char* pairs;
 
                 // Positive number
                 if (digits > 0x80 && jMax >= 1) {
-                    uint64_t value;
-                    uint64_t zeros = 0;
+                    pairs = numberPairsPositive;
                     // Part of the total
                     if (digits <= 0xC0) {
-                        valueBufferAppend('0');
+                        *out++ = '0';
                         zeros = 0xC0 - digits;
-                    } else {
+                        digits = 0;
+                    } else
                         digits -= 0xC0;
-                        // Part of the total - omitting first zero for first digit
-                        value = data[j] - 1;
-                        if (value < 10)
-                            valueBufferAppend('0' + value);
-                        else {
-                            valueBufferAppend('0' + (value / 10));
-                            valueBufferAppend('0' + (value % 10));
-                        }
-
-                        ++j;
-                        --digits;
-
-                        while (digits > 0) {
-                            value = data[j] - 1;
-                            if (j <= jMax) {
-                                valueBufferAppend('0' + (value / 10));
-                                valueBufferAppend('0' + (value % 10));
-                                ++j;
-                            } else {
-                                valueBufferAppend('0');
-                                valueBufferAppend('0');
-                            }
-                            --digits;
-                        }
-                    }
-
-                    // Fraction part
-                    if (j <= jMax) {
-                        valueBufferAppend('.');
-
-                        while (zeros > 0) {
-                            valueBufferAppend('0');
-                            valueBufferAppend('0');
-                            --zeros;
-                        }
-
-                        while (j <= jMax - 1) {
-                            value = data[j] - 1;
-                            valueBufferAppend('0' + (value / 10));
-                            valueBufferAppend('0' + (value % 10));
-                            ++j;
-                        }
-
-                        // Last digit - omitting 0 at the end
-                        value = data[j] - 1;
-                        valueBufferAppend('0' + (value / 10));
-                        if ((value % 10) != 0)
-                            valueBufferAppend('0' + (value % 10));
-                    }
                 // Negative number
                 } else if (digits < 0x80 && jMax >= 1) {
-                    uint64_t value;
-                    uint64_t zeros = 0;
-                    valueBufferAppend('-');
+                    pairs = numberPairsNegative;
+                    *out++ = '-';
 
                     if (data[jMax] == 0x66)
                         --jMax;
 
                     // Part of the total
                     if (digits >= 0x3F) {
-                        valueBufferAppend('0');
+                        *out++ = '0';
                         zeros = digits - 0x3F;
-                    } else {
+                        digits = 0;
+                    } else
                         digits = 0x3F - digits;
+                } else
+                    throw RuntimeException("got unknown numeric value");
+
+                if (digits > 0) {
+                    // Omitting first zero for first digit
+                    const char* pair = pairs + data[j] * 2;
+                    if (pair[0] == '0')
+                        *out++ = pair[1];
+                    else {
+                        memcpy(out, pair, 2);
+                        out += 2;
+                    }
+                    ++j;
+                    --digits;
 
-                        value = 101 - data[j];
-                        if (value < 10)
-                            valueBufferAppend('0' + value);
-                        else {
-                            valueBufferAppend('0' + (value / 10));
-                            valueBufferAppend('0' + (value % 10));
-                        }
+                    while (digits > 0 && j <= jMax) {
+                        memcpy(out, pairs + data[j] * 2, 2);
+                        out += 2;
                         ++j;
                         --digits;
+                    }
 
-                        while (digits > 0) {
-                            if (j <= jMax) {
-                                value = 101 - data[j];
-                                valueBufferAppend('0' + (value / 10));
-                                valueBufferAppend('0' + (value % 10));
-                                ++j;
-                            } else {
-                                valueBufferAppend('0');
-                                valueBufferAppend('0');
-                            }
-                            --digits;
-                        }
+                    if (digits > 0) {
+                        memset(out, '0', digits * 2);
+                        out += digits * 2;
                     }
+                }
+
+                // Fraction part
+                if (j <= jMax) {
+                    *out++ = '.';
 
-                    if (j <= jMax) {
-                        valueBufferAppend('.');
-
-                        while (zeros > 0) {
-                            valueBufferAppend('0');
-                            valueBufferAppend('0');
-                            --zeros;
-                        }
-
-                        while (j <= jMax - 1) {
-                            value = 101 - data[j];
-                            valueBufferAppend('0' + (value / 10));
-                            valueBufferAppend('0' + (value % 10));
-                            ++j;
-                        }
-
-                        value = 101 - data[j];
-                        valueBufferAppend('0' + (value / 10));
-                        if ((value % 10) != 0)
-                            valueBufferAppend('0' + (value % 10));
+                    if (zeros > 0) {
+                        memset(out, '0', zeros * 2);
+                        out += zeros * 2;
                     }
-                } else
-                    throw RuntimeException("got unknown numeric value");
+
+                    while (j < jMax) {
+                        memcpy(out, pairs + data[j] * 2, 2);
+                        out += 2;
+                        ++j;
+                    }
+
+                    // Last digit - omitting 0 at the end
+                    const char* pair = pairs + data[j] * 2;
+                    *out++ = pair[0];
+                    if (pair[1] != '0')
+                        *out++ = pair[1];
+                }
             }
+            valueLength = out - valueBuffer;
         };
 
         void parseString(const uint8_t* data, uint64_t length, uint64_t charsetId) {
@@ -456,6 +540,11 @@ namespace OpenLogReplicator {
                 throw RuntimeException("can't find character set map for id = " + std::to_string(charsetId));
             valueLength = 0;
 
+            if ((charFormat & (CHAR_FORMAT_NOMAPPING | CHAR_FORMAT_HEX)) == 0) {
+                valueLength = characterSet->decodeToUtf8(data, length, valueBuffer);
+                return;
+            }
+
             while (length > 0) {
                 typeUnicode unicodeCharacter;
                 uint64_t unicodeCharacterLength;
@@ -515,7 +604,7 @@ namespace OpenLogReplicator {
 
     public:
         SystemTransaction* systemTransaction;
-        uint64_t buffersAllocated;
+        std::atomic<uint64_t> buffersAllocated;
         BuilderQueue* firstBuffer;
         BuilderQueue* lastBuffer;
 
@@ -526,17 +615,34 @@ namespace OpenLogReplicator {
 
         [[nodiscard]] uint64_t builderSize() const;
         [[nodiscard]] uint64_t getMaxMessageMb() const;
+        [[nodiscard]] uint64_t getNetSize() const;
+        [[nodiscard]] uint64_t getMessageFormat() const;
+        [[nodiscard]] uint64_t getMessageKey() const;
         void setMaxMessageMb(uint64_t maxMessageMb);
+        void setNetChange(bool newNetChange);
+        void setRawFormat(uint64_t newRawFormat);
+        void setRowKeys(bool newRowKeys);
+        void setMessageKey(uint64_t newMessageKey);
+        void setTableTags(bool newTableTags);
+        void setSentRows(std::vector<BuilderNetRow*>* newSentRows, uint64_t* newSentSize, bool newSentReplay);
+        virtual void resetObjects();
         void processBegin(typeScn scn, typeTime time_, typeSeq sequence, typeXid xid, bool system);
+        void processContinue(typeScn scn, typeTime time_, typeSeq sequence, typeXid xid);
         void processInsertMultiple(RedoLogRecord* redoLogRecord1, RedoLogRecord* redoLogRecord2, bool system);
         void processDeleteMultiple(RedoLogRecord* redoLogRecord1, RedoLogRecord* redoLogRecord2, bool system);
         void processDml(RedoLogRecord* redoLogRecord1, RedoLogRecord* redoLogRecord2, uint64_t type, bool system);
         void processDdlHeader(RedoLogRecord* redoLogRecord1);
+        void processNetRow(BuilderNetRow* row, bool revert);
         virtual void initialize();
         virtual void processCommit(bool system) = 0;
+        virtual void processPartial(bool system) = 0;
+        virtual void processRollback(bool system) = 0;
         virtual void processCheckpoint(typeScn scn, typeTime time_, typeSeq sequence, uint64_t offset, bool redo) = 0;
-        void releaseBuffers(uint64_t maxId);
-        void sleepForWriterWork(uint64_t queueSize, uint64_t nanoseconds);
+        BuilderReader* addReader(uint64_t maxLagMb);
+        BuilderQueue* getFirstBuffer();
+        void releaseBuffers(BuilderReader* reader, uint64_t maxId);
+        [[nodiscard]] uint64_t getFlushSeq() const;
+        void sleepForWriterWork(uint64_t seq, uint64_t queueSize, uint64_t nanoseconds);
         void wakeUp();
 
         friend class SystemTransaction;
@@ -0,0 +1,440 @@
+/* Memory buffer for handling output data in Arrow IPC format
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <arrow/api.h>
+#include <arrow/io/memory.h>
+#include <arrow/ipc/writer.h>
+
+#include "../common/OracleColumn.h"
+#include "../common/OracleObject.h"
+#include "../common/SysCol.h"
+#include "../common/Timer.h"
+#include "BuilderArrow.h"
+
+namespace OpenLogReplicator {
+    BuilderArrow::BuilderArrow(Ctx* newCtx, Locales* newLocales, Metadata* newMetadata, uint64_t newMessageFormat, uint64_t newRidFormat, uint64_t newXidFormat,
+                               uint64_t newTimestampFormat, uint64_t newCharFormat, uint64_t newScnFormat, uint64_t newUnknownFormat, uint64_t newSchemaFormat,
+                               uint64_t newColumnFormat, uint64_t newUnknownType, uint64_t newFlushBuffer, uint64_t newBatchRows, uint64_t newBatchIntervalMs,
+                               uint64_t newDictionaryLength) :
+            Builder(newCtx, newLocales, newMetadata, newMessageFormat, newRidFormat, newXidFormat, newTimestampFormat, newCharFormat, newScnFormat,
+                    newUnknownFormat, newSchemaFormat, newColumnFormat, newUnknownType, newFlushBuffer),
+            batchRows(newBatchRows),
+            batchIntervalMs(newBatchIntervalMs),
+            dictionaryLength(newDictionaryLength),
+            controlTable(nullptr),
+            pendingRows(0),
+            pendingTime(0),
+            batchFull(false),
+            fieldType(ARROW_TYPE_STRING),
+            fieldBuilder(nullptr),
+            fieldData(nullptr),
+            fieldLength(0),
+            fieldWritten(false) {
+
+        // Used for ddl and checkpoint messages
+        controlTable = new BuilderArrowTable;
+        controlTable->obj = 0;
+        controlTable->object = nullptr;
+        controlTable->rows = 0;
+        controlTable->schema = arrow::schema({arrow::field("op", arrow::utf8(), false),
+                                              arrow::field("scn", arrow::uint64(), false),
+                                              arrow::field("tm", arrow::timestamp(arrow::TimeUnit::MILLI), false),
+                                              arrow::field("seq", arrow::uint64(), false),
+                                              arrow::field("offset", arrow::uint64(), false),
+                                              arrow::field("sql", arrow::utf8())});
+        controlTable->builders.emplace_back(new arrow::StringBuilder());
+        controlTable->builders.emplace_back(new arrow::UInt64Builder());
+        controlTable->builders.emplace_back(new arrow::TimestampBuilder(arrow::timestamp(arrow::TimeUnit::MILLI), arrow::default_memory_pool()));
+        controlTable->builders.emplace_back(new arrow::UInt64Builder());
+        controlTable->builders.emplace_back(new arrow::UInt64Builder());
+        controlTable->builders.emplace_back(new arrow::StringBuilder());
+    }
+
+    BuilderArrow::~BuilderArrow() {
+        for (auto it : tables)
+            delete it.second;
+        tables.clear();
+
+        if (controlTable != nullptr) {
+            delete controlTable;
+            controlTable = nullptr;
+        }
+    }
+
+    void BuilderArrow::check(const arrow::Status& status) {
+        if (!status.ok())
+            throw RuntimeException("Arrow processing failed: " + status.ToString());
+    }
+
+    void BuilderArrow::columnFloat(std::string& columnName __attribute__((unused)), float value) {
+        if (fieldType != ARROW_TYPE_FLOAT)
+            return;
+
+        check(static_cast<arrow::FloatBuilder*>(fieldBuilder)->Append(value));
+        fieldWritten = true;
+    }
+
+    void BuilderArrow::columnDouble(std::string& columnName __attribute__((unused)), double value) {
+        if (fieldType != ARROW_TYPE_DOUBLE)
+            return;
+
+        check(static_cast<arrow::DoubleBuilder*>(fieldBuilder)->Append(value));
+        fieldWritten = true;
+    }
+
+    void BuilderArrow::columnString(std::string& columnName __attribute__((unused))) {
+        appendString(valueBuffer, valueLength);
+    }
+
+    void BuilderArrow::columnNumber(std::string& columnName, uint64_t precision, uint64_t scale) {
+        if (fieldType != ARROW_TYPE_DECIMAL) {
+            appendString(valueBuffer, valueLength);
+            return;
+        }
+
+        // Column definition doesn't match the data, writing null or a rounded value would silently lose data
+        typeInt128 value;
+        if (!decodeDecimal(fieldData, fieldLength, (int64_t)scale, value))
+            throw RuntimeException("Arrow processing failed, value " + std::string(valueBuffer, valueLength) + " of column " + columnName +
+                                   " doesn't fit decimal(" + std::to_string(precision) + ", " + std::to_string(scale) + ")");
+
+        auto bits = (typeUInt128)value;
+        arrow::Decimal128 decimal((int64_t)(bits >> 64), (uint64_t)bits);
+        check(static_cast<arrow::Decimal128Builder*>(fieldBuilder)->Append(decimal));
+        fieldWritten = true;
+    }
+
+    void BuilderArrow::columnRaw(std::string& columnName __attribute__((unused)), const uint8_t* data, uint64_t length) {
+        if (fieldType != ARROW_TYPE_BINARY)
+            return;
+
+        check(static_cast<arrow::BinaryBuilder*>(fieldBuilder)->Append(data, (int32_t)length));
+        fieldWritten = true;
+    }
+
+    void BuilderArrow::columnTimestamp(std::string& columnName __attribute__((unused)), struct tm& epochTime, uint64_t fraction, const char* tz) {
+        if (fieldType == ARROW_TYPE_TIMESTAMP) {
+            check(static_cast<arrow::TimestampBuilder*>(fieldBuilder)->Append(epochMicros(epochTime, fraction)));
+            fieldWritten = true;
+        } else {
+            valueBufferTimestamp(epochTime, fraction, tz);
+            appendString(valueBuffer, valueLength);
+        }
+    }
+
+    void BuilderArrow::appendString(const char* str, uint64_t length) {
+        if (fieldType == ARROW_TYPE_STRING)
+            check(static_cast<arrow::StringBuilder*>(fieldBuilder)->Append(str, (int32_t)length));
+        else if (fieldType == ARROW_TYPE_DICTIONARY)
+            check(static_cast<arrow::StringDictionary32Builder*>(fieldBuilder)->Append(str, (int32_t)length));
+        else
+            return;
+        fieldWritten = true;
+    }
+
+    BuilderArrowTable* BuilderArrow::getTable(OracleObject* object) {
+        auto it = tables.find(object);
+        if (it != tables.end())
+            return it->second;
+
+        auto* table = new BuilderArrowTable;
+        table->obj = object->obj;
+        table->object = object;
+        table->rows = 0;
+
+        std::vector<std::shared_ptr<arrow::Field>> fields;
+        fields.push_back(arrow::field("op", arrow::dictionary(arrow::int32(), arrow::utf8()), false));
+        fields.push_back(arrow::field("scn", arrow::uint64(), false));
+        fields.push_back(arrow::field("tm", arrow::timestamp(arrow::TimeUnit::MILLI), false));
+        fields.push_back(arrow::field("xid", arrow::utf8(), false));
+        fields.push_back(arrow::field("unset", arrow::list(arrow::int32()), false));
+        table->builders.emplace_back(new arrow::StringDictionary32Builder());
+        table->builders.emplace_back(new arrow::UInt64Builder());
+        table->builders.emplace_back(new arrow::TimestampBuilder(arrow::timestamp(arrow::TimeUnit::MILLI), arrow::default_memory_pool()));
+        table->builders.emplace_back(new arrow::StringBuilder());
+        table->builders.emplace_back(new arrow::ListBuilder(arrow::default_memory_pool(), std::make_shared<arrow::Int32Builder>()));
+
+        for (typeCol col = 0; col < (typeCol)object->columns.size(); ++col) {
+            OracleColumn* column = object->columns[col];
+            if (column == nullptr || column->storedAsLob)
+                continue;
+            if (column->constraint && !FLAG(REDO_FLAGS_SHOW_CONSTRAINT_COLUMNS))
+                continue;
+            if (column->nested && !FLAG(REDO_FLAGS_SHOW_NESTED_COLUMNS))
+                continue;
+            if (column->invisible && !FLAG(REDO_FLAGS_SHOW_INVISIBLE_COLUMNS))
+                continue;
+            if (column->unused && !FLAG(REDO_FLAGS_SHOW_UNUSED_COLUMNS))
+                continue;
+
+            uint64_t type;
+            std::shared_ptr<arrow::DataType> dataType;
+            switch (column->type) {
+            case SYS_COL_TYPE_VARCHAR:
+            case SYS_COL_TYPE_CHAR:
+                // Short strings are most likely codes and flags with few distinct values
+                if (column->length <= dictionaryLength) {
+                    type = ARROW_TYPE_DICTIONARY;
+                    dataType = arrow::dictionary(arrow::int32(), arrow::utf8());
+                    table->builders.emplace_back(new arrow::StringDictionary32Builder());
+                } else {
+                    type = ARROW_TYPE_STRING;
+                    dataType = arrow::utf8();
+                    table->builders.emplace_back(new arrow::StringBuilder());
+                }
+                break;
+
+            case SYS_COL_TYPE_NUMBER:
+                if (column->precision > 0 && column->precision <= 38 && column->scale >= 0 && column->scale <= column->precision) {
+                    type = ARROW_TYPE_DECIMAL;
+                    dataType = arrow::decimal128((int32_t)column->precision, (int32_t)column->scale);
+                    table->builders.emplace_back(new arrow::Decimal128Builder(dataType));
+                } else {
+                    type = ARROW_TYPE_STRING;
+                    dataType = arrow::utf8();
+                    table->builders.emplace_back(new arrow::StringBuilder());
+                }
+                break;
+
+            case SYS_COL_TYPE_FLOAT:
+                type = ARROW_TYPE_FLOAT;
+                dataType = arrow::float32();
+                table->builders.emplace_back(new arrow::FloatBuilder());
+                break;
+
+            case SYS_COL_TYPE_DOUBLE:
+                type = ARROW_TYPE_DOUBLE;
+                dataType = arrow::float64();
+                table->builders.emplace_back(new arrow::DoubleBuilder());
+                break;
+
+            case SYS_COL_TYPE_RAW:
+                type = ARROW_TYPE_BINARY;
+                dataType = arrow::binary();
+                table->builders.emplace_back(new arrow::BinaryBuilder());
+                break;
+
+            case SYS_COL_TYPE_DATE:
+            case SYS_COL_TYPE_TIMESTAMP:
+                type = ARROW_TYPE_TIMESTAMP;
+                dataType = arrow::timestamp(arrow::TimeUnit::MICRO);
+                table->builders.emplace_back(new arrow::TimestampBuilder(dataType, arrow::default_memory_pool()));
+                break;
+
+            case SYS_COL_TYPE_TIMESTAMP_WITH_TZ:
+                type = ARROW_TYPE_STRING;
+                dataType = arrow::utf8();
+                table->builders.emplace_back(new arrow::StringBuilder());
+                break;
+
+            default:
+                continue;
+            }
+
+            fields.push_back(arrow::field(column->name, dataType));
+            table->columns.push_back(col);
+            table->types.push_back(type);
+        }
+
+        table->schema = arrow::schema(fields, arrow::key_value_metadata({"owner", "table"}, {object->owner, object->name}));
+        tables.insert(std::pair<OracleObject*, BuilderArrowTable*>(object, table));
+        return table;
+    }
+
+    void BuilderArrow::appendRow(OracleObject* object, const char* op, uint64_t type, bool compressed) {
+        newTran = false;
+        if (object == nullptr) {
+            WARNING("Arrow output skips DML for unknown object")
+            return;
+        }
+
+        // Row image of compressed block is not decoded, a row of nulls would silently lose data
+        if (compressed)
+            throw RuntimeException("Arrow processing failed, compressed row of table " + object->owner + "." + object->name + " can't be decoded");
+
+        BuilderArrowTable* table = getTable(object);
+        std::string xid = lastXid.toString();
+        check(static_cast<arrow::StringDictionary32Builder*>(table->builders[0].get())->Append(op, 1));
+        check(static_cast<arrow::UInt64Builder*>(table->builders[1].get())->Append(lastScn));
+        check(static_cast<arrow::TimestampBuilder*>(table->builders[2].get())->Append((int64_t)lastTime.toTime() * 1000));
+        check(static_cast<arrow::StringBuilder*>(table->builders[3].get())->Append(xid.c_str(), (int32_t)xid.length()));
+
+        // Update redo contains only changed and supplementally logged columns, other values are null but not known to be null
+        auto* unsetBuilder = static_cast<arrow::ListBuilder*>(table->builders[4].get());
+        check(unsetBuilder->Append());
+        if (op[0] == 'u') {
+            auto* unsetValues = static_cast<arrow::Int32Builder*>(unsetBuilder->value_builder());
+            for (uint64_t i = 0; i < table->columns.size(); ++i)
+                if (!isValueSet(table->columns[i]))
+                    check(unsetValues->Append((int32_t)i));
+        }
+
+        // Null bitmap follows missing values
+        for (uint64_t i = 0; i < table->columns.size(); ++i) {
+            typeCol column = table->columns[i];
+            fieldBuilder = table->builders[ARROW_HEADER_FIELDS + i].get();
+            if (values[column][type] == nullptr || lengths[column][type] == 0) {
+                check(fieldBuilder->AppendNull());
+                continue;
+            }
+
+            fieldType = table->types[i];
+            fieldData = values[column][type];
+            fieldLength = lengths[column][type];
+            fieldWritten = false;
+            processValue(object, column, fieldData, fieldLength, false);
+            if (!fieldWritten)
+                throw RuntimeException("Arrow processing failed, value of column " + object->columns[column]->name + " of table " + object->owner +
+                                       "." + object->name + " doesn't match type of the field");
+        }
+        fieldBuilder = nullptr;
+        fieldData = nullptr;
+        fieldLength = 0;
+
+        if (pendingRows == 0)
+            pendingTime = Timer::getTime();
+        ++pendingRows;
+        if (++table->rows >= batchRows)
+            batchFull = true;
+        ++num;
+    }
+
+    void BuilderArrow::appendControl(const char* op, typeSeq sequence, uint64_t offset, const char* sql, uint64_t sqlLength) {
+        check(static_cast<arrow::StringBuilder*>(controlTable->builders[0].get())->Append(op, (int32_t)strlen(op)));
+        check(static_cast<arrow::UInt64Builder*>(controlTable->builders[1].get())->Append(lastScn));
+        check(static_cast<arrow::TimestampBuilder*>(controlTable->builders[2].get())->Append((int64_t)lastTime.toTime() * 1000));
+        check(static_cast<arrow::UInt64Builder*>(controlTable->builders[3].get())->Append(sequence));
+        check(static_cast<arrow::UInt64Builder*>(controlTable->builders[4].get())->Append(offset));
+        if (sql != nullptr)
+            check(static_cast<arrow::StringBuilder*>(controlTable->builders[5].get())->Append(sql, (int32_t)sqlLength));
+        else
+            check(controlTable->builders[5]->AppendNull());
+        ++controlTable->rows;
+        flushTable(controlTable);
+    }
+
+    // Every message is a complete IPC stream: schema, dictionaries and one record batch
+    void BuilderArrow::flushTable(BuilderArrowTable* table) {
+        std::vector<std::shared_ptr<arrow::Array>> arrays;
+        arrays.resize(table->builders.size());
+        for (uint64_t i = 0; i < table->builders.size(); ++i)
+            check(table->builders[i]->Finish(&arrays[i]));
+        std::shared_ptr<arrow::RecordBatch> batch = arrow::RecordBatch::Make(table->schema, (int64_t)table->rows, arrays);
+        table->rows = 0;
+
+        arrow::Result<std::shared_ptr<arrow::io::BufferOutputStream>> sink = arrow::io::BufferOutputStream::Create();
+        check(sink.status());
+        arrow::Result<std::shared_ptr<arrow::ipc::RecordBatchWriter>> writer = arrow::ipc::MakeStreamWriter(*sink, table->schema);
+        check(writer.status());
+        check((*writer)->WriteRecordBatch(*batch));
+        check((*writer)->Close());
+        arrow::Result<std::shared_ptr<arrow::Buffer>> buffer = (*sink)->Finish();
+        check(buffer.status());
+
+        // Batch has rows of one table, but no single row key
+        builderBeginTagged(table->obj, table->object, false);
+        builderAppend((const char*)(*buffer)->data(), (*buffer)->size());
+        builderCommit(true);
+    }
+
+    // All tables are flushed together, so that every message is confirmed only after all rows it covers
+    void BuilderArrow::flush() {
+        for (auto it : tables) {
+            if (it.second->rows > 0)
+                flushTable(it.second);
+        }
+        pendingRows = 0;
+        pendingTime = 0;
+        batchFull = false;
+    }
+
+    void BuilderArrow::processBeginMessage() {
+        newTran = false;
+    }
+
+    void BuilderArrow::processCommit(bool system) {
+        if (system && !FLAG(REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS))
+            return;
+
+        if (netChange)
+            netChangeFlush();
+
+        newTran = false;
+        num = 0;
+
+        if (pendingRows > 0 && (batchFull || Timer::getTime() - pendingTime >= (time_t)batchIntervalMs * 1000))
+            flush();
+    }
+
+    void BuilderArrow::processPartial(bool system __attribute__((unused))) {
+        throw RuntimeException("Arrow partial transaction processing failed, streaming of uncommitted transactions is not supported");
+    }
+
+    void BuilderArrow::processRollback(bool system __attribute__((unused))) {
+        throw RuntimeException("Arrow rollback processing failed, streaming of uncommitted transactions is not supported");
+    }
+
+    void BuilderArrow::processInsert(OracleObject* object, typeDataObj dataObj __attribute__((unused)), typeDba bdba __attribute__((unused)),
+                                     typeSlot slot __attribute__((unused)), typeXid xid __attribute__((unused))) {
+        appendRow(object, "c", VALUE_AFTER, compressedAfter);
+    }
+
+    void BuilderArrow::processUpdate(OracleObject* object, typeDataObj dataObj __attribute__((unused)), typeDba bdba __attribute__((unused)),
+                                     typeSlot slot __attribute__((unused)), typeXid xid __attribute__((unused))) {
+        appendRow(object, "u", VALUE_AFTER, compressedAfter);
+    }
+
+    void BuilderArrow::processDelete(OracleObject* object, typeDataObj dataObj __attribute__((unused)), typeDba bdba __attribute__((unused)),
+                                     typeSlot slot __attribute__((unused)), typeXid xid __attribute__((unused))) {
+        appendRow(object, "d", VALUE_BEFORE, compressedBefore);
+    }
+
+    void BuilderArrow::processDdl(OracleObject* object __attribute__((unused)), typeDataObj dataObj __attribute__((unused)), uint16_t type __attribute__((unused)),
+                                  uint16_t seq __attribute__((unused)), const char* operation __attribute__((unused)), const char* sql, uint64_t sqlLength) {
+        newTran = false;
+        if (pendingRows > 0)
+            flush();
+        appendControl("ddl", lastSequence, 0, sql, sqlLength);
+        ++num;
+    }
+
+    void BuilderArrow::resetObjects() {
+        Builder::resetObjects();
+        if (pendingRows > 0)
+            flush();
+        for (auto it : tables)
+            delete it.second;
+        tables.clear();
+    }
+
+    void BuilderArrow::processCheckpoint(typeScn scn, typeTime time_, typeSeq sequence, uint64_t offset, bool redo) {
+        lastTime = time_;
+        lastScn = scn;
+        lastSequence = sequence;
+
+        if (pendingRows > 0 && (batchFull || redo || ctx->softShutdown || Timer::getTime() - pendingTime >= (time_t)batchIntervalMs * 1000))
+            flush();
+
+        // Checkpoint position can't be confirmed before rows from earlier transactions are sent
+        if (pendingRows > 0 || FLAG(REDO_FLAGS_HIDE_CHECKPOINT))
+            return;
+
+        appendControl(redo ? "chkpt-redo" : "chkpt", sequence, offset, nullptr, 0);
+    }
+}
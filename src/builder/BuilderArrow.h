@@ -0,0 +1,111 @@
+/* Header for BuilderArrow class
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <memory>
+
+#include "../common/OracleObject.h"
+#include "Builder.h"
+
+#ifndef BUILDER_ARROW_H_
+#define BUILDER_ARROW_H_
+
+#define ARROW_TYPE_STRING                       0
+#define ARROW_TYPE_DICTIONARY                   1
+#define ARROW_TYPE_DECIMAL                      2
+#define ARROW_TYPE_FLOAT                        3
+#define ARROW_TYPE_DOUBLE                       4
+#define ARROW_TYPE_BINARY                       5
+#define ARROW_TYPE_TIMESTAMP                    6
+
+// op, scn, tm, xid, unset
+#define ARROW_HEADER_FIELDS                     5
+
+// Arrow headers require C++20, only BuilderArrow.cpp includes them
+namespace arrow {
+    class ArrayBuilder;
+    class Schema;
+    class Status;
+}
+
+namespace OpenLogReplicator {
+    // Rows of one table collected since last flush
+    struct BuilderArrowTable {
+        typeObj obj;
+        OracleObject* object;
+        std::shared_ptr<arrow::Schema> schema;
+        std::vector<typeCol> columns;
+        std::vector<uint64_t> types;
+        std::vector<std::unique_ptr<arrow::ArrayBuilder>> builders;
+        uint64_t rows;
+    };
+
+    class BuilderArrow : public Builder {
+    protected:
+        uint64_t batchRows;
+        uint64_t batchIntervalMs;
+        uint64_t dictionaryLength;
+        std::unordered_map<OracleObject*, BuilderArrowTable*> tables;
+        BuilderArrowTable* controlTable;
+        uint64_t pendingRows;
+        time_t pendingTime;
+        bool batchFull;
+        // Column currently written
+        uint64_t fieldType;
+        arrow::ArrayBuilder* fieldBuilder;
+        const uint8_t* fieldData;
+        uint64_t fieldLength;
+        bool fieldWritten;
+
+        static void check(const arrow::Status& status);
+
+        void columnFloat(std::string& columnName, float value) override;
+        void columnDouble(std::string& columnName, double value) override;
+        void columnString(std::string& columnName) override;
+        void columnNumber(std::string& columnName, uint64_t precision, uint64_t scale) override;
+        void columnRaw(std::string& columnName, const uint8_t* data, uint64_t length) override;
+        void columnTimestamp(std::string& columnName, struct tm& epochTime, uint64_t fraction, const char* tz) override;
+        void appendString(const char* str, uint64_t length);
+        BuilderArrowTable* getTable(OracleObject* object);
+        void appendRow(OracleObject* object, const char* op, uint64_t type, bool compressed);
+        void appendControl(const char* op, typeSeq sequence, uint64_t offset, const char* sql, uint64_t sqlLength);
+        void flushTable(BuilderArrowTable* table);
+        void flush();
+        void processInsert(OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid) override;
+        void processUpdate(OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid) override;
+        void processDelete(OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid) override;
+        void processDdl(OracleObject* object, typeDataObj dataObj, uint16_t type, uint16_t seq, const char* operation,
+                        const char* sql, uint64_t sqlLength) override;
+        void processBeginMessage() override;
+
+    public:
+        BuilderArrow(Ctx* newCtx, Locales* newLocales, Metadata* newMetadata, uint64_t newMessageFormat, uint64_t newRidFormat, uint64_t newXidFormat,
+                     uint64_t newTimestampFormat, uint64_t newCharFormat, uint64_t newScnFormat, uint64_t newUnknownFormat, uint64_t newSchemaFormat,
+                     uint64_t newColumnFormat, uint64_t newUnknownType, uint64_t newFlushBuffer, uint64_t newBatchRows, uint64_t newBatchIntervalMs,
+                     uint64_t newDictionaryLength);
+        ~BuilderArrow() override;
+
+        void resetObjects() override;
+        void processCommit(bool system) override;
+        void processPartial(bool system) override;
+        void processRollback(bool system) override;
+        void processCheckpoint(typeScn scn, typeTime time_, typeSeq sequence, uint64_t offset, bool redo) override;
+    };
+}
+
+#endif
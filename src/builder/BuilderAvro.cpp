@@ -0,0 +1,489 @@
+/* Memory buffer for handling output data in Avro format
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include "../common/OracleColumn.h"
+#include "../common/OracleObject.h"
+#include "../common/SysCol.h"
+#include "../common/typeRowId.h"
+#include "BuilderAvro.h"
+
+namespace OpenLogReplicator {
+    BuilderAvro::BuilderAvro(Ctx* newCtx, Locales* newLocales, Metadata* newMetadata, uint64_t newMessageFormat, uint64_t newRidFormat, uint64_t newXidFormat,
+                             uint64_t newTimestampFormat, uint64_t newCharFormat, uint64_t newScnFormat, uint64_t newUnknownFormat, uint64_t newSchemaFormat,
+                             uint64_t newColumnFormat, uint64_t newUnknownType, uint64_t newFlushBuffer) :
+            Builder(newCtx, newLocales, newMetadata, newMessageFormat, newRidFormat, newXidFormat, newTimestampFormat, newCharFormat, newScnFormat,
+                    newUnknownFormat, newSchemaFormat, newColumnFormat, newUnknownType, newFlushBuffer),
+            controlFingerprint(0),
+            controlSchemaSent(false),
+            fieldType(AVRO_TYPE_STRING),
+            fieldData(nullptr),
+            fieldLength(0),
+            fieldWritten(false) {
+
+        // CRC-64-AVRO
+        for (uint64_t i = 0; i < 256; ++i) {
+            uint64_t value = i;
+            for (uint64_t j = 0; j < 8; ++j)
+                value = (value >> 1) ^ (AVRO_FINGERPRINT_EMPTY & (0 - (value & 1)));
+            fingerprintTable[i] = value;
+        }
+
+        // Used for begin, commit, rollback, ddl and checkpoint messages, already in parsing canonical form
+        controlSchema = R"({"name":"OpenLogReplicator.Control","type":"record","fields":[{"name":"op","type":"string"},{"name":"scn","type":"long"},)"
+                        R"({"name":"tm","type":"long"},{"name":"xid","type":"string"},{"name":"seq","type":"long"},{"name":"offset","type":"long"},)"
+                        R"({"name":"sql","type":["null","string"]}]})";
+        controlFingerprint = fingerprint(controlSchema);
+    }
+
+    BuilderAvro::~BuilderAvro() {
+        for (auto it : schemas)
+            delete it.second;
+        schemas.clear();
+    }
+
+    void BuilderAvro::columnFloat(std::string& columnName __attribute__((unused)), float value) {
+        if (fieldType != AVRO_TYPE_FLOAT)
+            return;
+
+        appendLong(1);
+        builderAppend((const char*)&value, sizeof(value));
+        fieldWritten = true;
+    }
+
+    void BuilderAvro::columnDouble(std::string& columnName __attribute__((unused)), double value) {
+        if (fieldType != AVRO_TYPE_DOUBLE)
+            return;
+
+        appendLong(1);
+        builderAppend((const char*)&value, sizeof(value));
+        fieldWritten = true;
+    }
+
+    void BuilderAvro::columnString(std::string& columnName __attribute__((unused))) {
+        if (fieldType != AVRO_TYPE_STRING)
+            return;
+
+        appendLong(1);
+        appendBytes(valueBuffer, valueLength);
+        fieldWritten = true;
+    }
+
+    void BuilderAvro::columnNumber(std::string& columnName, uint64_t precision, uint64_t scale) {
+        if (fieldType == AVRO_TYPE_STRING) {
+            appendLong(1);
+            appendBytes(valueBuffer, valueLength);
+            fieldWritten = true;
+            return;
+        }
+
+        if (fieldType != AVRO_TYPE_DECIMAL)
+            return;
+
+        // Column definition doesn't match the data, writing null or a rounded value would silently lose data
+        typeInt128 value;
+        if (!decodeDecimal(fieldData, fieldLength, (int64_t)scale, value))
+            throw RuntimeException("Avro processing failed, value " + std::string(valueBuffer, valueLength) + " of column " + columnName +
+                                   " doesn't fit decimal(" + std::to_string(precision) + ", " + std::to_string(scale) + ")");
+
+        // Two's complement, big endian, shortest form
+        char buffer[16];
+        auto bits = (typeUInt128)value;
+        for (uint64_t i = 0; i < 16; ++i)
+            buffer[15 - i] = (char)(uint8_t)(bits >> (i * 8));
+        uint64_t start = 0;
+        while (start < 15 && ((buffer[start] == 0 && (buffer[start + 1] & 0x80) == 0) ||
+                              ((uint8_t)buffer[start] == 0xFF && (buffer[start + 1] & 0x80) != 0)))
+            ++start;
+
+        appendLong(1);
+        appendBytes(buffer + start, 16 - start);
+        fieldWritten = true;
+    }
+
+    void BuilderAvro::columnRaw(std::string& columnName __attribute__((unused)), const uint8_t* data, uint64_t length) {
+        if (fieldType != AVRO_TYPE_BYTES)
+            return;
+
+        appendLong(1);
+        appendBytes((const char*)data, length);
+        fieldWritten = true;
+    }
+
+    void BuilderAvro::columnTimestamp(std::string& columnName __attribute__((unused)), struct tm& epochTime, uint64_t fraction, const char* tz) {
+        if (fieldType == AVRO_TYPE_TIMESTAMP) {
+            appendLong(1);
+            appendLong(epochMicros(epochTime, fraction));
+            fieldWritten = true;
+        } else if (fieldType == AVRO_TYPE_STRING) {
+            valueBufferTimestamp(epochTime, fraction, tz);
+            appendLong(1);
+            appendBytes(valueBuffer, valueLength);
+            fieldWritten = true;
+        }
+    }
+
+    uint64_t BuilderAvro::fingerprint(const std::string& canonical) const {
+        uint64_t value = AVRO_FINGERPRINT_EMPTY;
+        for (char character : canonical)
+            value = (value >> 8) ^ fingerprintTable[(value ^ (uint8_t)character) & 0xFF];
+        return value;
+    }
+
+    // Avro names are limited to [A-Za-z_][A-Za-z0-9_]*
+    void BuilderAvro::appendName(std::string& out, const std::string& name) {
+        if (name.empty() || (name[0] >= '0' && name[0] <= '9'))
+            out.push_back('_');
+        for (char character : name) {
+            if ((character >= 'A' && character <= 'Z') || (character >= 'a' && character <= 'z') ||
+                    (character >= '0' && character <= '9') || character == '_')
+                out.push_back(character);
+            else
+                out.push_back('_');
+        }
+    }
+
+    BuilderAvroSchema* BuilderAvro::getSchema(OracleObject* object) {
+        auto it = schemas.find(object);
+        if (it != schemas.end())
+            return it->second;
+
+        auto* schema = new BuilderAvroSchema;
+        std::string owner;
+        std::string name;
+        appendName(owner, object->owner);
+        appendName(name, object->name);
+
+        std::string fields;
+        std::string fieldsCanonical;
+        std::unordered_set<std::string> fieldNames;
+        for (typeCol col = 0; col < (typeCol)object->columns.size(); ++col) {
+            OracleColumn* column = object->columns[col];
+            if (column == nullptr || column->storedAsLob)
+                continue;
+            if (column->constraint && !FLAG(REDO_FLAGS_SHOW_CONSTRAINT_COLUMNS))
+                continue;
+            if (column->nested && !FLAG(REDO_FLAGS_SHOW_NESTED_COLUMNS))
+                continue;
+            if (column->invisible && !FLAG(REDO_FLAGS_SHOW_INVISIBLE_COLUMNS))
+                continue;
+            if (column->unused && !FLAG(REDO_FLAGS_SHOW_UNUSED_COLUMNS))
+                continue;
+
+            uint64_t type;
+            std::string typeFull;
+            std::string typeCanonical;
+            switch (column->type) {
+            case SYS_COL_TYPE_VARCHAR:
+            case SYS_COL_TYPE_CHAR:
+            case SYS_COL_TYPE_TIMESTAMP_WITH_TZ:
+                type = AVRO_TYPE_STRING;
+                typeCanonical = R"("string")";
+                typeFull = typeCanonical;
+                break;
+
+            case SYS_COL_TYPE_NUMBER:
+                if (column->precision > 0 && column->precision <= 38 && column->scale >= 0 && column->scale <= column->precision) {
+                    type = AVRO_TYPE_DECIMAL;
+                    typeCanonical = R"("bytes")";
+                    typeFull = R"({"type":"bytes","logicalType":"decimal","precision":)" + std::to_string(column->precision) +
+                            R"(,"scale":)" + std::to_string(column->scale) + "}";
+                } else {
+                    type = AVRO_TYPE_STRING;
+                    typeCanonical = R"("string")";
+                    typeFull = typeCanonical;
+                }
+                break;
+
+            case SYS_COL_TYPE_FLOAT:
+                type = AVRO_TYPE_FLOAT;
+                typeCanonical = R"("float")";
+                typeFull = typeCanonical;
+                break;
+
+            case SYS_COL_TYPE_DOUBLE:
+                type = AVRO_TYPE_DOUBLE;
+                typeCanonical = R"("double")";
+                typeFull = typeCanonical;
+                break;
+
+            case SYS_COL_TYPE_RAW:
+                type = AVRO_TYPE_BYTES;
+                typeCanonical = R"("bytes")";
+                typeFull = typeCanonical;
+                break;
+
+            case SYS_COL_TYPE_DATE:
+            case SYS_COL_TYPE_TIMESTAMP:
+                type = AVRO_TYPE_TIMESTAMP;
+                typeCanonical = R"("long")";
+                typeFull = R"({"type":"long","logicalType":"timestamp-micros"})";
+                break;
+
+            default:
+                continue;
+            }
+
+            std::string fieldName;
+            appendName(fieldName, column->name);
+            if (fieldNames.find(fieldName) != fieldNames.end())
+                fieldName += "_" + std::to_string(col);
+            fieldNames.insert(fieldName);
+
+            if (!schema->columns.empty()) {
+                fields.push_back(',');
+                fieldsCanonical.push_back(',');
+            }
+            fields += R"({"name":")" + fieldName + R"(","type":["null",)" + typeFull + "]}";
+            fieldsCanonical += R"({"name":")" + fieldName + R"(","type":["null",)" + typeCanonical + "]}";
+            schema->columns.push_back(col);
+            schema->types.push_back(type);
+        }
+
+        std::string rid;
+        if (ridFormat != RID_FORMAT_SKIP)
+            rid = R"({"name":"rid","type":"string"},)";
+
+        std::string full = R"({"type":"record","name":")" + name + R"(","namespace":")" + owner +
+                R"(","fields":[{"name":"op","type":"string"},{"name":"scn","type":"long"},)"
+                R"({"name":"tm","type":{"type":"long","logicalType":"timestamp-millis"}},{"name":"xid","type":"string"},)" + rid +
+                R"({"name":"before","type":["null",{"type":"record","name":")" + name + R"(_row","fields":[)" + fields + "]}]},"
+                R"({"name":"after","type":["null",")" + name + R"(_row"]},{"name":"unset","type":{"type":"array","items":"int"}}]})";
+        std::string canonical = R"({"name":")" + owner + "." + name +
+                R"(","type":"record","fields":[{"name":"op","type":"string"},{"name":"scn","type":"long"},)"
+                R"({"name":"tm","type":"long"},{"name":"xid","type":"string"},)" + rid +
+                R"({"name":"before","type":["null",{"name":")" + owner + "." + name + R"(_row","type":"record","fields":[)" + fieldsCanonical + "]}]},"
+                R"({"name":"after","type":["null",")" + owner + "." + name + R"(_row"]},{"name":"unset","type":{"type":"array","items":"int"}}]})";
+        schema->fingerprint = fingerprint(canonical);
+        schemas.insert(std::pair<OracleObject*, BuilderAvroSchema*>(object, schema));
+
+        // Schema precedes the first record using it
+        appendSchemaMessage(object, full);
+        return schema;
+    }
+
+    // Schema message goes with messages of the table, but without key of the row
+    void BuilderAvro::appendSchemaMessage(OracleObject* object, const std::string& schema) {
+        builderBeginTagged((object != nullptr) ? object->obj : 0, object, false);
+        builderAppend(schema.c_str(), schema.length());
+        builderCommit(false);
+    }
+
+    // Writing null in place of a value which can't be decoded or represented would silently lose data
+    void BuilderAvro::appendRow(OracleObject* object, BuilderAvroSchema* schema, uint64_t type, bool compressed) {
+        if (compressed)
+            throw RuntimeException("Avro processing failed, compressed row of table " + object->owner + "." + object->name + " can't be decoded");
+
+        appendLong(1);
+        for (uint64_t i = 0; i < schema->columns.size(); ++i) {
+            typeCol column = schema->columns[i];
+            if (values[column][type] == nullptr || lengths[column][type] == 0) {
+                appendLong(0);
+                continue;
+            }
+
+            fieldType = schema->types[i];
+            fieldData = values[column][type];
+            fieldLength = lengths[column][type];
+            fieldWritten = false;
+            processValue(object, column, fieldData, fieldLength, false);
+            if (!fieldWritten)
+                throw RuntimeException("Avro processing failed, value of column " + object->columns[column]->name + " of table " + object->owner + "." +
+                                       object->name + " doesn't match type of the field");
+        }
+        fieldData = nullptr;
+        fieldLength = 0;
+    }
+
+    // Update redo contains only changed and supplementally logged columns, other fields are null but not known to be null
+    void BuilderAvro::appendUnset(BuilderAvroSchema* schema) {
+        uint64_t unset = 0;
+        for (typeCol column : schema->columns)
+            if (!isValueSet(column))
+                ++unset;
+
+        if (unset > 0) {
+            appendLong((int64_t)unset);
+            for (uint64_t i = 0; i < schema->columns.size(); ++i)
+                if (!isValueSet(schema->columns[i]))
+                    appendLong((int64_t)i);
+        }
+        appendLong(0);
+    }
+
+    void BuilderAvro::appendRecord(OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, const char* op, bool before, bool after) {
+        if (newTran)
+            processBeginMessage();
+
+        if (object == nullptr) {
+            WARNING("Avro output skips DML for unknown object, data object: " << std::dec << dataObj)
+            return;
+        }
+
+        BuilderAvroSchema* schema = getSchema(object);
+        std::string xid = lastXid.toString();
+
+        builderBeginRow(object);
+        appendHeader(schema->fingerprint);
+        appendBytes(op, 1);
+        appendLong((int64_t)lastScn);
+        appendLong((int64_t)lastTime.toTime() * 1000);
+        appendBytes(xid.c_str(), xid.length());
+        if (ridFormat != RID_FORMAT_SKIP) {
+            typeRowId rowId(dataObj, bdba, slot);
+            char str[19];
+            rowId.toString(str);
+            appendBytes(str, 18);
+        }
+
+        if (before)
+            appendRow(object, schema, VALUE_BEFORE, compressedBefore);
+        else
+            appendLong(0);
+        if (after)
+            appendRow(object, schema, VALUE_AFTER, compressedAfter);
+        else
+            appendLong(0);
+        if (before && after)
+            appendUnset(schema);
+        else
+            appendLong(0);
+        builderCommit(false);
+        ++num;
+    }
+
+    void BuilderAvro::appendControl(const char* op, typeSeq sequence, uint64_t offset, const char* sql, uint64_t sqlLength) {
+        if (!controlSchemaSent) {
+            appendSchemaMessage(nullptr, controlSchema);
+            controlSchemaSent = true;
+        }
+
+        std::string xid;
+        if (lastXid.getVal() != 0)
+            xid = lastXid.toString();
+
+        builderBegin(0);
+        appendHeader(controlFingerprint);
+        appendBytes(op, strlen(op));
+        appendLong((int64_t)lastScn);
+        appendLong((int64_t)lastTime.toTime() * 1000);
+        appendBytes(xid.c_str(), xid.length());
+        appendLong((int64_t)sequence);
+        appendLong((int64_t)offset);
+        if (sql != nullptr) {
+            appendLong(1);
+            appendBytes(sql, sqlLength);
+        } else
+            appendLong(0);
+        builderCommit(true);
+    }
+
+    void BuilderAvro::processBeginMessage() {
+        newTran = false;
+
+        // Begin was already sent with the first part of the transaction
+        if (continuedTran)
+            return;
+
+        if ((messageFormat & MESSAGE_FORMAT_SKIP_BEGIN) != 0)
+            return;
+
+        appendControl("begin", lastSequence, 0, nullptr, 0);
+    }
+
+    void BuilderAvro::processCommit(bool system) {
+        if (system && !FLAG(REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS))
+            return;
+
+        if (netChange)
+            netChangeFlush();
+
+        // Skip empty transaction
+        if (newTran) {
+            newTran = false;
+            // Part of the transaction was already sent, the commit marker is still needed
+            if (continuedTran)
+                appendControl("commit", lastSequence, 0, nullptr, 0);
+            num = 0;
+            return;
+        }
+
+        if ((messageFormat & MESSAGE_FORMAT_SKIP_COMMIT) == 0 || continuedTran)
+            appendControl("commit", lastSequence, 0, nullptr, 0);
+        num = 0;
+    }
+
+    void BuilderAvro::processPartial(bool system) {
+        if (system && !FLAG(REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS))
+            return;
+
+        if (netChange)
+            netChangeFlush();
+
+        if (newTran)
+            newTran = false;
+    }
+
+    void BuilderAvro::processRollback(bool system) {
+        if (system && !FLAG(REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS))
+            return;
+
+        newTran = false;
+        appendControl("rollback", lastSequence, 0, nullptr, 0);
+        num = 0;
+    }
+
+    void BuilderAvro::processInsert(OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid __attribute__((unused))) {
+        appendRecord(object, dataObj, bdba, slot, "c", false, true);
+    }
+
+    void BuilderAvro::processUpdate(OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid __attribute__((unused))) {
+        appendRecord(object, dataObj, bdba, slot, "u", true, true);
+    }
+
+    void BuilderAvro::processDelete(OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid __attribute__((unused))) {
+        appendRecord(object, dataObj, bdba, slot, "d", true, false);
+    }
+
+    void BuilderAvro::processDdl(OracleObject* object __attribute__((unused)), typeDataObj dataObj __attribute__((unused)), uint16_t type __attribute__((unused)),
+                                 uint16_t seq __attribute__((unused)), const char* operation __attribute__((unused)), const char* sql, uint64_t sqlLength) {
+        if (newTran)
+            processBeginMessage();
+
+        appendControl("ddl", lastSequence, 0, sql, sqlLength);
+        ++num;
+    }
+
+    void BuilderAvro::resetObjects() {
+        Builder::resetObjects();
+        for (auto it : schemas)
+            delete it.second;
+        schemas.clear();
+    }
+
+    void BuilderAvro::processCheckpoint(typeScn scn, typeTime time_, typeSeq sequence, uint64_t offset, bool redo) {
+        if (FLAG(REDO_FLAGS_HIDE_CHECKPOINT))
+            return;
+
+        lastTime = time_;
+        lastScn = scn;
+        lastSequence = sequence;
+        lastXid = typeXid();
+        appendControl(redo ? "chkpt-redo" : "chkpt", sequence, offset, nullptr, 0);
+    }
+}
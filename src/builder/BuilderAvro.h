@@ -0,0 +1,120 @@
+/* Header for BuilderAvro class
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include "../common/OracleObject.h"
+#include "Builder.h"
+
+#ifndef BUILDER_AVRO_H_
+#define BUILDER_AVRO_H_
+
+#define AVRO_TYPE_STRING                        0
+#define AVRO_TYPE_DECIMAL                       1
+#define AVRO_TYPE_FLOAT                         2
+#define AVRO_TYPE_DOUBLE                        3
+#define AVRO_TYPE_BYTES                         4
+#define AVRO_TYPE_TIMESTAMP                     5
+
+#define AVRO_FINGERPRINT_EMPTY                  0xC15D213AA4D7A795ULL
+
+namespace OpenLogReplicator {
+    // Avro schema of one table, fields follow order of columns
+    struct BuilderAvroSchema {
+        uint64_t fingerprint;
+        std::vector<typeCol> columns;
+        std::vector<uint64_t> types;
+    };
+
+    class BuilderAvro : public Builder {
+    protected:
+        uint64_t fingerprintTable[256];
+        std::unordered_map<OracleObject*, BuilderAvroSchema*> schemas;
+        std::string controlSchema;
+        uint64_t controlFingerprint;
+        bool controlSchemaSent;
+        // Column currently written
+        uint64_t fieldType;
+        const uint8_t* fieldData;
+        uint64_t fieldLength;
+        bool fieldWritten;
+
+        void columnFloat(std::string& columnName, float value) override;
+        void columnDouble(std::string& columnName, double value) override;
+        void columnString(std::string& columnName) override;
+        void columnNumber(std::string& columnName, uint64_t precision, uint64_t scale) override;
+        void columnRaw(std::string& columnName, const uint8_t* data, uint64_t length) override;
+        void columnTimestamp(std::string& columnName, struct tm& epochTime, uint64_t fraction, const char* tz) override;
+        uint64_t fingerprint(const std::string& canonical) const;
+        static void appendName(std::string& out, const std::string& name);
+        BuilderAvroSchema* getSchema(OracleObject* object);
+        void appendSchemaMessage(OracleObject* object, const std::string& schema);
+        void appendRow(OracleObject* object, BuilderAvroSchema* schema, uint64_t type, bool compressed);
+        void appendUnset(BuilderAvroSchema* schema);
+        void appendRecord(OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, const char* op, bool before, bool after);
+        void appendControl(const char* op, typeSeq sequence, uint64_t offset, const char* sql, uint64_t sqlLength);
+
+        // Zig-zag encoded variable length integer
+        void appendLong(int64_t value) {
+            char buffer[10];
+            uint64_t length = 0;
+            uint64_t zigzag = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+            while (zigzag >= 0x80) {
+                buffer[length++] = (char)(zigzag | 0x80);
+                zigzag >>= 7;
+            }
+            buffer[length++] = (char)zigzag;
+            builderAppend(buffer, length);
+        }
+
+        void appendBytes(const char* data, uint64_t length) {
+            appendLong((int64_t)length);
+            builderAppend(data, length);
+        }
+
+        // Single object encoding: marker, 8 byte little endian fingerprint
+        void appendHeader(uint64_t value) {
+            char buffer[10];
+            buffer[0] = (char)0xC3;
+            buffer[1] = (char)0x01;
+            for (uint64_t i = 0; i < 8; ++i)
+                buffer[2 + i] = (char)(value >> (i * 8));
+            builderAppend(buffer, sizeof(buffer));
+        }
+
+        void processInsert(OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid) override;
+        void processUpdate(OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid) override;
+        void processDelete(OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid) override;
+        void processDdl(OracleObject* object, typeDataObj dataObj, uint16_t type, uint16_t seq, const char* operation,
+                        const char* sql, uint64_t sqlLength) override;
+        void processBeginMessage() override;
+
+    public:
+        BuilderAvro(Ctx* newCtx, Locales* newLocales, Metadata* newMetadata, uint64_t newMessageFormat, uint64_t newRidFormat, uint64_t newXidFormat,
+                    uint64_t newTimestampFormat, uint64_t newCharFormat, uint64_t newScnFormat, uint64_t newUnknownFormat, uint64_t newSchemaFormat,
+                    uint64_t newColumnFormat, uint64_t newUnknownType, uint64_t newFlushBuffer);
+        ~BuilderAvro() override;
+
+        void resetObjects() override;
+        void processCommit(bool system) override;
+        void processPartial(bool system) override;
+        void processRollback(bool system) override;
+        void processCheckpoint(typeScn scn, typeTime time_, typeSeq sequence, uint64_t offset, bool redo) override;
+    };
+}
+
+#endif
@@ -31,7 +31,8 @@ namespace OpenLogReplicator {
                 newColumnFormat, newUnknownType, newFlushBuffer),
                      hasPreviousValue(false),
                      hasPreviousRedo(false),
-                     hasPreviousColumn(false) {
+                     hasPreviousColumn(false),
+                     columnKey(nullptr) {
     }
 
     void BuilderJson::columnNull(OracleObject* object, typeCol col) {
@@ -61,122 +62,188 @@ namespace OpenLogReplicator {
                 return;
         }
 
-        if (hasPreviousColumn)
-            builderAppend(',');
-        else
-            hasPreviousColumn = true;
-
-        builderAppend('"');
         if (object != nullptr)
-            builderAppend(object->columns[col]->name);
+            appendColumnKey(object->columns[col]->name);
         else {
             std::string columnName("COL_" + std::to_string(col));
-            builderAppend(columnName);
+            appendColumnKey(columnName);
         }
-        builderAppend(R"(":null)", sizeof(R"(":null)") - 1);
+        builderAppend("null", sizeof("null") - 1);
     }
 
     void BuilderJson::columnFloat(std::string& columnName, float value) {
-        if (hasPreviousColumn)
-            builderAppend(',');
-        else
-            hasPreviousColumn = true;
-
-        builderAppend('"');
-        builderAppend(columnName);
-        builderAppend(R"(":)", sizeof(R"(":)") - 1);
+        appendColumnKey(columnName);
 
-        std::string valString(std::to_string(value));
-        builderAppend(valString);
+        appendFloat(value);
     }
 
     void BuilderJson::columnDouble(std::string& columnName, double value) {
-        if (hasPreviousColumn)
-            builderAppend(',');
-        else
-            hasPreviousColumn = true;
+        appendColumnKey(columnName);
 
-        builderAppend('"');
-        builderAppend(columnName);
-        builderAppend(R"(":)", sizeof(R"(":)") - 1);
-
-        std::string valString(std::to_string(value));
-        builderAppend(valString);
+        appendFloat(value);
     }
 
     void BuilderJson::columnString(std::string& columnName) {
-        if (hasPreviousColumn)
-            builderAppend(',');
-        else
-            hasPreviousColumn = true;
-
+        appendColumnKey(columnName);
         builderAppend('"');
-        builderAppend(columnName);
-        builderAppend(R"(":")", sizeof(R"(":")") - 1);
         appendEscape(valueBuffer, valueLength);
         builderAppend('"');
     }
 
     void BuilderJson::columnNumber(std::string& columnName, uint64_t precision __attribute__((unused)), uint64_t scale __attribute__((unused))) {
-        if (hasPreviousColumn)
-            builderAppend(',');
-        else
-            hasPreviousColumn = true;
-
-        builderAppend('"');
-        builderAppend(columnName);
-        builderAppend(R"(":)", sizeof(R"(":)") - 1);
+        appendColumnKey(columnName);
         builderAppend(valueBuffer, valueLength);
     }
 
     void BuilderJson::columnRaw(std::string& columnName, const uint8_t* data, uint64_t length) {
-        if (hasPreviousColumn)
-            builderAppend(',');
-        else
-            hasPreviousColumn = true;
-
+        appendColumnKey(columnName);
         builderAppend('"');
-        builderAppend(columnName);
-        builderAppend(R"(":")", sizeof(R"(":")") - 1);
-        for (uint64_t j = 0; j < length; ++j)
-            appendHex(*(data + j), 2);
+        if (rawFormat == RAW_FORMAT_BASE64)
+            appendRawBase64(data, length);
+        else
+            appendRawHex(data, length);
         builderAppend('"');
     }
 
-    void BuilderJson::columnTimestamp(std::string& columnName, struct tm &epochTime, uint64_t fraction, const char* tz) {
-        if (hasPreviousColumn)
-            builderAppend(',');
-        else
-            hasPreviousColumn = true;
+    void BuilderJson::appendRawHex(const uint8_t* data, uint64_t length) {
+        // Value crossing output buffer boundary, encode the part which fits and continue in next buffer
+        while (lastBuffer->length + length * 2 >= OUTPUT_BUFFER_DATA_SIZE) {
+            uint64_t part = (OUTPUT_BUFFER_DATA_SIZE - 1 - lastBuffer->length) / 2;
+            if (part > 0)
+                appendRawHex(data, part);
+            else {
+                part = 1;
+                appendHex(*data, 2);
+            }
+            data += part;
+            length -= part;
+        }
 
-        builderAppend('"');
-        builderAppend(columnName);
-        builderAppend(R"(":)", sizeof(R"(":)") - 1);
+        char* out = (char*)(lastBuffer->data + lastBuffer->length);
+        uint64_t j = 0;
+#ifdef __SSE2__
+        const __m128i maskLow = _mm_set1_epi8(0x0F);
+        const __m128i nine = _mm_set1_epi8(9);
+        const __m128i digit = _mm_set1_epi8('0');
+        const __m128i letter = _mm_set1_epi8('a' - '0' - 10);
+        for (; j + 16 <= length; j += 16) {
+            __m128i block = _mm_loadu_si128((const __m128i*)(data + j));
+            __m128i high = _mm_and_si128(_mm_srli_epi16(block, 4), maskLow);
+            __m128i low = _mm_and_si128(block, maskLow);
+            high = _mm_add_epi8(_mm_add_epi8(high, digit), _mm_and_si128(_mm_cmpgt_epi8(high, nine), letter));
+            low = _mm_add_epi8(_mm_add_epi8(low, digit), _mm_and_si128(_mm_cmpgt_epi8(low, nine), letter));
+            _mm_storeu_si128((__m128i*)(out + j * 2), _mm_unpacklo_epi8(high, low));
+            _mm_storeu_si128((__m128i*)(out + j * 2 + 16), _mm_unpackhi_epi8(high, low));
+        }
+#endif
+        for (; j < length; ++j) {
+            out[j * 2] = map16[data[j] >> 4];
+            out[j * 2 + 1] = map16[data[j] & 0x0F];
+        }
+
+        builderShiftFast(length * 2);
+        messageLength += length * 2;
+    }
+
+    void BuilderJson::appendRawBase64(const uint8_t* data, uint64_t length) {
+        uint64_t outLength = (length + 2) / 3 * 4;
+        // Value crossing output buffer boundary, encode whole groups which fit and continue in next buffer
+        while (lastBuffer->length + outLength >= OUTPUT_BUFFER_DATA_SIZE) {
+            uint64_t part = (OUTPUT_BUFFER_DATA_SIZE - 1 - lastBuffer->length) / 4 * 3;
+            if (part > 0)
+                appendRawBase64(data, part);
+            else {
+                part = (length < 3) ? length : 3;
+                uint64_t value = ((uint64_t)data[0]) << 16;
+                if (part > 1)
+                    value |= ((uint64_t)data[1]) << 8;
+                if (part > 2)
+                    value |= data[2];
+                builderAppend(map64[(value >> 18) & 0x3F]);
+                builderAppend(map64[(value >> 12) & 0x3F]);
+                builderAppend((part > 1) ? map64[(value >> 6) & 0x3F] : '=');
+                builderAppend((part > 2) ? map64[value & 0x3F] : '=');
+            }
+            data += part;
+            length -= part;
+            outLength = (length + 2) / 3 * 4;
+        }
+
+        char* out = (char*)(lastBuffer->data + lastBuffer->length);
+        uint64_t j = 0;
+        for (; j + 3 <= length; j += 3) {
+            uint64_t value = (((uint64_t)data[j]) << 16) | (((uint64_t)data[j + 1]) << 8) | data[j + 2];
+            *out++ = map64[(value >> 18) & 0x3F];
+            *out++ = map64[(value >> 12) & 0x3F];
+            *out++ = map64[(value >> 6) & 0x3F];
+            *out++ = map64[value & 0x3F];
+        }
+        if (j < length) {
+            uint64_t value = ((uint64_t)data[j]) << 16;
+            if (j + 1 < length)
+                value |= ((uint64_t)data[j + 1]) << 8;
+            *out++ = map64[(value >> 18) & 0x3F];
+            *out++ = map64[(value >> 12) & 0x3F];
+            *out++ = (j + 1 < length) ? map64[(value >> 6) & 0x3F] : '=';
+            *out++ = '=';
+        }
+
+        builderShiftFast(outLength);
+        messageLength += outLength;
+    }
+
+    void BuilderJson::columnTimestamp(std::string& columnName, struct tm &epochTime, uint64_t fraction, const char* tz) {
+        appendColumnKey(columnName);
 
         if ((timestampFormat & TIMESTAMP_FORMAT_ISO8601) != 0) {
             // 2012-04-23T18:25:43.511Z - ISO 8601 format
-            builderAppend('"');
-            if (epochTime.tm_year > 0) {
-                appendDec((uint64_t)epochTime.tm_year);
-            } else {
-                appendDec((uint64_t)(-epochTime.tm_year));
-                builderAppend("BC", sizeof("BC") - 1);
+            char buffer[64];
+            char* out = buffer;
+            *out++ = '"';
+            uint64_t year;
+            if (epochTime.tm_year > 0)
+                year = epochTime.tm_year;
+            else
+                year = -epochTime.tm_year;
+            uint64_t yearLength = 1;
+            for (uint64_t value = year; value >= 10; value /= 10)
+                ++yearLength;
+            for (uint64_t i = yearLength; i > 0; --i) {
+                out[i - 1] = map10[year % 10];
+                year /= 10;
+            }
+            out += yearLength;
+            if (epochTime.tm_year <= 0) {
+                *out++ = 'B';
+                *out++ = 'C';
             }
-            builderAppend('-');
-            appendDec(epochTime.tm_mon, 2);
-            builderAppend('-');
-            appendDec(epochTime.tm_mday, 2);
-            builderAppend('T');
-            appendDec(epochTime.tm_hour, 2);
-            builderAppend(':');
-            appendDec(epochTime.tm_min, 2);
-            builderAppend(':');
-            appendDec(epochTime.tm_sec, 2);
+
+            out[0] = '-';
+            out[1] = map10[epochTime.tm_mon / 10];
+            out[2] = map10[epochTime.tm_mon % 10];
+            out[3] = '-';
+            out[4] = map10[epochTime.tm_mday / 10];
+            out[5] = map10[epochTime.tm_mday % 10];
+            out[6] = 'T';
+            out[7] = map10[epochTime.tm_hour / 10];
+            out[8] = map10[epochTime.tm_hour % 10];
+            out[9] = ':';
+            out[10] = map10[epochTime.tm_min / 10];
+            out[11] = map10[epochTime.tm_min % 10];
+            out[12] = ':';
+            out[13] = map10[epochTime.tm_sec / 10];
+            out[14] = map10[epochTime.tm_sec % 10];
+            out += 15;
 
             if (fraction > 0) {
-                builderAppend('.');
-                appendDec(fraction, 9);
+                *out++ = '.';
+                for (uint64_t i = 9; i > 0; --i) {
+                    out[i - 1] = map10[fraction % 10];
+                    fraction /= 10;
+                }
+                out += 9;
             }
+            builderAppend(buffer, out - buffer);
 
             if (tz != nullptr) {
                 builderAppend(' ');
@@ -186,9 +253,9 @@ namespace OpenLogReplicator {
         } else {
             // Unix epoch format
             if (epochTime.tm_year >= 1900) {
-                --epochTime.tm_mon;
-                epochTime.tm_year -= 1900;
-                appendSDec(tmToEpoch(&epochTime) * 1000 + ((fraction + 500000) / 1000000));
+                int64_t epoch = ((daysFromCivil(epochTime.tm_year, epochTime.tm_mon, epochTime.tm_mday) * 24 + epochTime.tm_hour) * 60 +
+                        epochTime.tm_min) * 60 + epochTime.tm_sec;
+                appendSDec(epoch * 1000 + (int64_t)((fraction + 500000) / 1000000));
             } else
                 appendDec(0);
         }
@@ -276,26 +343,37 @@ namespace OpenLogReplicator {
             return;
         }
 
-        builderAppend(R"("schema":{"owner":")", sizeof(R"("schema":{"owner":")") - 1);
-        builderAppend(object->owner);
-        builderAppend(R"(","table":")", sizeof(R"(","table":")") - 1);
-        builderAppend(object->name);
-        builderAppend('"');
+        // Column list is sent just once per object unless repeated
+        if ((schemaFormat & SCHEMA_FORMAT_FULL) != 0 && (schemaFormat & SCHEMA_FORMAT_REPEATED) == 0 && objects.count(object) == 0) {
+            objects.insert(object);
+            std::string schema;
+            buildSchema(object, true, schema);
+            builderAppend(schema);
+            return;
+        }
+
+        auto it = schemaBlocks.find(object);
+        if (it == schemaBlocks.end())
+            it = schemaBlocks.emplace(object, std::string()).first;
+        if (it->second.empty())
+            buildSchema(object, (schemaFormat & SCHEMA_FORMAT_FULL) != 0 && (schemaFormat & SCHEMA_FORMAT_REPEATED) != 0, it->second);
+        builderAppend(it->second);
+    }
+
+    void BuilderJson::buildSchema(OracleObject* object, bool columns, std::string& out) {
+        out.append(R"("schema":{"owner":")");
+        out.append(object->owner);
+        out.append(R"(","table":")");
+        out.append(object->name);
+        out.push_back('"');
 
         if ((schemaFormat & SCHEMA_FORMAT_OBJ) != 0) {
-            builderAppend(R"(,"obj":)", sizeof(R"(,"obj":)") - 1);
-            appendDec(object->obj);
+            out.append(R"(,"obj":)");
+            out.append(std::to_string(object->obj));
         }
 
-        if ((schemaFormat & SCHEMA_FORMAT_FULL) != 0) {
-            if ((schemaFormat & SCHEMA_FORMAT_REPEATED) == 0) {
-                if (objects.count(object) > 0)
-                    return;
-                else
-                    objects.insert(object);
-            }
-
-            builderAppend(R"(,"columns":[)", sizeof(R"(,"columns":[)") - 1);
+        if (columns) {
+            out.append(R"(,"columns":[)");
 
             bool hasPrev = false;
             for (typeCol column = 0; column < (typeCol)object->columns.size(); ++column) {
@@ -303,145 +381,165 @@ namespace OpenLogReplicator {
                     continue;
 
                 if (hasPrev)
-                    builderAppend(',');
+                    out.push_back(',');
                 else
                     hasPrev = true;
 
-                builderAppend(R"({"name":")", sizeof(R"({"name":")") - 1);
-                builderAppend(object->columns[column]->name);
+                out.append(R"({"name":")");
+                out.append(object->columns[column]->name);
 
-                builderAppend(R"(","type":)", sizeof(R"(","type":)") - 1);
+                out.append(R"(","type":)");
                 switch(object->columns[column]->type) {
                 case SYS_COL_TYPE_VARCHAR:
-                    builderAppend(R"("varchar2","length":)", sizeof(R"("varchar2","length":)") - 1);
-                    appendDec(object->columns[column]->length);
+                    out.append(R"("varchar2","length":)");
+                    out.append(std::to_string(object->columns[column]->length));
                     break;
 
                 case SYS_COL_TYPE_NUMBER:
-                    builderAppend(R"("number","precision":)", sizeof(R"("number","precision":)") - 1);
-                    appendSDec(object->columns[column]->precision);
-                    builderAppend(R"(,"scale":)", sizeof(R"(,"scale":)") - 1);
-                    appendSDec(object->columns[column]->scale);
+                    out.append(R"("number","precision":)");
+                    out.append(std::to_string(object->columns[column]->precision));
+                    out.append(R"(,"scale":)");
+                    out.append(std::to_string(object->columns[column]->scale));
                     break;
 
                 case SYS_COL_TYPE_LONG: // long, not supported
-                    builderAppend(R"("long")", sizeof(R"("long")") - 1);
+                    out.append(R"("long")");
                     break;
 
                 case SYS_COL_TYPE_DATE:
-                    builderAppend(R"("date")", sizeof(R"("date")") - 1);
+                    out.append(R"("date")");
                     break;
 
                 case SYS_COL_TYPE_RAW:
-                    builderAppend(R"("raw","length":)", sizeof(R"("raw","length":)") - 1);
-                    appendDec(object->columns[column]->length);
+                    out.append(R"("raw","length":)");
+                    out.append(std::to_string(object->columns[column]->length));
                     break;
 
                 case SYS_COL_TYPE_LONG_RAW: // Not supported
-                    builderAppend(R"("long raw")", sizeof(R"("long raw")") - 1);
+                    out.append(R"("long raw")");
                     break;
 
                 case SYS_COL_TYPE_ROWID: // Not supported
-                    builderAppend(R"("rowid")", sizeof(R"("rowid")") - 1);
+                    out.append(R"("rowid")");
                     break;
 
                 case SYS_COL_TYPE_CHAR:
-                    builderAppend(R"("char","length":)", sizeof(R"("char","length":)") - 1);
-                    appendDec(object->columns[column]->length);
+                    out.append(R"("char","length":)");
+                    out.append(std::to_string(object->columns[column]->length));
                     break;
 
                 case SYS_COL_TYPE_FLOAT:
-                    builderAppend(R"("binary_float")", sizeof(R"("binary_float")") - 1);
+                    out.append(R"("binary_float")");
                     break;
 
                 case SYS_COL_TYPE_DOUBLE:
-                    builderAppend(R"("binary_double")", sizeof(R"("binary_double")") - 1);
+                    out.append(R"("binary_double")");
                     break;
 
                 case SYS_COL_TYPE_CLOB: // Not supported
-                    builderAppend(R"("clob")", sizeof(R"("clob")") - 1);
+                    out.append(R"("clob")");
                     break;
 
                 case SYS_COL_TYPE_BLOB: // Not supported
-                    builderAppend(R"("blob")", sizeof(R"("blob")") - 1);
+                    out.append(R"("blob")");
                     break;
 
                 case SYS_COL_TYPE_TIMESTAMP:
-                    builderAppend(R"("timestamp","length":)", sizeof(R"("timestamp","length":)") - 1);
-                    appendDec(object->columns[column]->length);
+                    out.append(R"("timestamp","length":)");
+                    out.append(std::to_string(object->columns[column]->length));
                     break;
 
                 case SYS_COL_TYPE_TIMESTAMP_WITH_TZ:
-                    builderAppend(R"("timestamp with time zone","length":)", sizeof(R"("timestamp with time zone","length":)") - 1);
-                    appendDec(object->columns[column]->length);
+                    out.append(R"("timestamp with time zone","length":)");
+                    out.append(std::to_string(object->columns[column]->length));
                     break;
 
                 case SYS_COL_TYPE_INTERVAL_YEAR_TO_MONTH:
-                    builderAppend(R"("interval year to month","length":)", sizeof(R"("interval year to month","length":)") - 1);
-                    appendDec(object->columns[column]->length);
+                    out.append(R"("interval year to month","length":)");
+                    out.append(std::to_string(object->columns[column]->length));
                     break;
 
                 case SYS_COL_TYPE_INTERVAL_DAY_TO_SECOND:
-                    builderAppend(R"("interval day to second","length":)", sizeof(R"("interval day to second","length":)") - 1);
-                    appendDec(object->columns[column]->length);
+                    out.append(R"("interval day to second","length":)");
+                    out.append(std::to_string(object->columns[column]->length));
                     break;
 
                 case SYS_COL_TYPE_URAWID:
-                    builderAppend(R"("urawid","length":)", sizeof(R"("urawid","length":)") - 1);
-                    appendDec(object->columns[column]->length);
+                    out.append(R"("urawid","length":)");
+                    out.append(std::to_string(object->columns[column]->length));
                     break;
 
                 case SYS_COL_TYPE_TIMESTAMP_WITH_LOCAL_TZ: // Not supported
-                    builderAppend(R"("timestamp with local time zone","length":)", sizeof(R"("timestamp with local time zone","length":)") - 1);
-                    appendDec(object->columns[column]->length);
+                    out.append(R"("timestamp with local time zone","length":)");
+                    out.append(std::to_string(object->columns[column]->length));
                     break;
 
                 default:
-                    builderAppend(R"("unknown")", sizeof(R"("unknown")") - 1);
+                    out.append(R"("unknown")");
                     break;
                 }
 
-                builderAppend(R"(,"nullable":)", sizeof(R"(,"nullable":)") - 1);
+                out.append(R"(,"nullable":)");
                 if (object->columns[column]->nullable)
-                    builderAppend('1');
+                    out.push_back('1');
                 else
-                    builderAppend('0');
+                    out.push_back('0');
 
-                builderAppend('}');
+                out.push_back('}');
             }
-            builderAppend(']');
+            out.push_back(']');
         }
 
-        builderAppend('}');
+        out.push_back('}');
+    }
+
+    std::vector<std::string>& BuilderJson::getColumnKeys(OracleObject* object) {
+        auto it = columnKeys.find(object);
+        if (it != columnKeys.end())
+            return it->second;
+
+        std::vector<std::string>& keys = columnKeys[object];
+        keys.resize(object->columns.size());
+        for (typeCol column = 0; column < (typeCol)object->columns.size(); ++column) {
+            if (object->columns[column] == nullptr)
+                continue;
+            keys[column] = "\"" + object->columns[column]->name + "\":";
+        }
+        return keys;
     }
 
-    time_t BuilderJson::tmToEpoch(struct tm* epoch) {
-        static const int cumdays[12] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
-        long year;
-        time_t result;
-
-        year = 1900 + epoch->tm_year + epoch->tm_mon / 12;
-        result = (year - 1970) * 365 + cumdays[epoch->tm_mon % 12];
-        result += (year - 1968) / 4;
-        result -= (year - 1900) / 100;
-        result += (year - 1600) / 400;
-        if ((year % 4) == 0 && ((year % 100) != 0 || (year % 400) == 0) &&
-            (epoch->tm_mon % 12) < 2)
-            result--;
-        result += epoch->tm_mday - 1;
-        result *= 24;
-        result += epoch->tm_hour;
-        result *= 60;
-        result += epoch->tm_min;
-        result *= 60;
-        result += epoch->tm_sec;
-        return result;
+    void BuilderJson::resetObjects() {
+        columnKeys.clear();
+        schemaBlocks.clear();
+        Builder::resetObjects();
+    }
+
+    void BuilderJson::appendMarker(bool first, const char* op, uint64_t opLength) {
+        builderBegin(0);
+        builderAppend('{');
+
+        hasPreviousValue = false;
+        appendHeader(first, true);
+
+        if (hasPreviousValue)
+            builderAppend(',');
+        else
+            hasPreviousValue = true;
+
+        builderAppend(R"("payload":[{"op":")", sizeof(R"("payload":[{"op":")") - 1);
+        builderAppend(op, opLength);
+        builderAppend(R"("}]})", sizeof(R"("}]})") - 1);
+        builderCommit(true);
     }
 
     void BuilderJson::processBeginMessage() {
         newTran = false;
         hasPreviousRedo = false;
 
+        // Begin was already sent with the first part of the transaction
+        if (continuedTran && (messageFormat & MESSAGE_FORMAT_FULL) == 0)
+            return;
+
         if ((messageFormat & MESSAGE_FORMAT_SKIP_BEGIN) != 0)
             return;
 
@@ -467,30 +565,53 @@ namespace OpenLogReplicator {
         if (system && !FLAG(REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS))
             return;
 
+        if (netChange)
+            netChangeFlush();
+
         // Skip empty transaction
         if (newTran) {
             newTran = false;
+            // Part of the transaction was already sent, the commit marker is still needed
+            if (continuedTran)
+                appendMarker(false, "commit", sizeof("commit") - 1);
+            num = 0;
             return;
         }
 
         if ((messageFormat & MESSAGE_FORMAT_FULL) != 0) {
             builderAppend("]}", sizeof("]}") - 1);
             builderCommit(true);
-        } else if ((messageFormat & MESSAGE_FORMAT_SKIP_COMMIT) == 0) {
-            builderBegin(0);
-            builderAppend('{');
+        } else if ((messageFormat & MESSAGE_FORMAT_SKIP_COMMIT) == 0 || continuedTran) {
+            appendMarker(false, "commit", sizeof("commit") - 1);
+        }
+        num = 0;
+    }
 
-            hasPreviousValue = false;
-            appendHeader(false, true);
+    void BuilderJson::processPartial(bool system) {
+        if (system && !FLAG(REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS))
+            return;
 
-            if (hasPreviousValue)
-                builderAppend(',');
-            else
-                hasPreviousValue = true;
+        if (netChange)
+            netChangeFlush();
+
+        // Nothing sent in this part
+        if (newTran) {
+            newTran = false;
+            return;
+        }
 
-            builderAppend(R"("payload":[{"op":"commit"}]})", sizeof(R"("payload":[{"op":"commit"}]})") - 1);
+        if ((messageFormat & MESSAGE_FORMAT_FULL) != 0) {
+            builderAppend(R"(],"partial":true})", sizeof(R"(],"partial":true})") - 1);
             builderCommit(true);
         }
+    }
+
+    void BuilderJson::processRollback(bool system) {
+        if (system && !FLAG(REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS))
+            return;
+
+        newTran = false;
+        appendMarker(true, "rollback", sizeof("rollback") - 1);
         num = 0;
     }
 
@@ -504,10 +625,7 @@ namespace OpenLogReplicator {
             else
                 hasPreviousRedo = true;
         } else {
-            if (object != nullptr)
-                builderBegin(object->obj);
-            else
-                builderBegin(0);
+            builderBeginRow(object);
 
             builderAppend('{');
             hasPreviousValue = false;
@@ -544,10 +662,7 @@ namespace OpenLogReplicator {
             else
                 hasPreviousRedo = true;
         } else {
-            if (object != nullptr)
-                builderBegin(object->obj);
-            else
-                builderBegin(0);
+            builderBeginRow(object);
 
             builderAppend('{');
             hasPreviousValue = false;
@@ -585,10 +700,7 @@ namespace OpenLogReplicator {
             else
                 hasPreviousRedo = true;
         } else {
-            if (object != nullptr)
-                builderBegin(object->obj);
-            else
-                builderBegin(0);
+            builderBeginRow(object);
 
             builderAppend('{');
             hasPreviousValue = false;
@@ -625,10 +737,7 @@ namespace OpenLogReplicator {
             else
                 hasPreviousRedo = true;
         } else {
-            if (object != nullptr)
-                builderBegin(object->obj);
-            else
-                builderBegin(0);
+            builderBeginRow(object);
 
             builderAppend('{');
             hasPreviousValue = false;
@@ -17,18 +17,32 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "../common/OracleObject.h"
 #include "Builder.h"
 
 #ifndef BUILDER_JSON_H_
 #define BUILDER_JSON_H_
 
+#define FLOAT_BUFFER_LENGTH                     32
+
 namespace OpenLogReplicator {
     class BuilderJson : public Builder {
     protected:
         bool hasPreviousValue;
         bool hasPreviousRedo;
         bool hasPreviousColumn;
+        // Rendered "name": of columns and schema blocks, dropped on schema change
+        std::unordered_map<OracleObject*, std::vector<std::string>> columnKeys;
+        std::unordered_map<OracleObject*, std::string> schemaBlocks;
+        const std::string* columnKey;
         void columnNull(OracleObject* object, typeCol col);
         void columnFloat(std::string& columnName, float value) override;
         void columnDouble(std::string& columnName, double value) override;
@@ -36,9 +50,14 @@ namespace OpenLogReplicator {
         void columnNumber(std::string& columnName, uint64_t precision, uint64_t scale) override;
         void columnRaw(std::string& columnName, const uint8_t* data, uint64_t length) override;
         void columnTimestamp(std::string& columnName, struct tm& epochtime, uint64_t fraction, const char* tz) override;
+        void appendRawHex(const uint8_t* data, uint64_t length);
+        void appendRawBase64(const uint8_t* data, uint64_t length);
         void appendRowid(typeDataObj dataObj, typeDba bdba, typeSlot slot);
         void appendHeader(bool first, bool showXid);
         void appendSchema(OracleObject* object, typeDataObj dataObj);
+        void buildSchema(OracleObject* object, bool columns, std::string& out);
+        std::vector<std::string>& getColumnKeys(OracleObject* object);
+        void appendMarker(bool first, const char* op, uint64_t opLength);
 
         void appendHex(uint64_t value, uint64_t length) {
             uint64_t j = (length - 1) * 4;
@@ -105,8 +124,60 @@ namespace OpenLogReplicator {
                 builderAppend(buffer[length - i - 1]);
         }
 
+        template<class T>
+        void appendFloat(T value) {
+            char buffer[FLOAT_BUFFER_LENGTH];
+            uint64_t length = formatFloat(buffer, value);
+
+            // JSON has no numeric representation for NaN and infinity
+            if (std::isfinite(value)) {
+                builderAppend(buffer, length);
+            } else {
+                builderAppend('"');
+                builderAppend(buffer, length);
+                builderAppend('"');
+            }
+        }
+
+        static bool needsEscape(char character) {
+            return (uint8_t)character < 14 || character == '"' || character == '\\' || character == '/';
+        }
+
+        // Number of leading characters which can be copied without escaping
+        static uint64_t escapeScan(const char* str, uint64_t length) {
+            uint64_t pos = 0;
+#ifdef __SSE2__
+            const __m128i controlMax = _mm_set1_epi8(13);
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i slash = _mm_set1_epi8('/');
+            while (pos + 16 <= length) {
+                __m128i block = _mm_loadu_si128((const __m128i*)(str + pos));
+                __m128i hits = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(block, controlMax), block), _mm_cmpeq_epi8(block, quote)),
+                        _mm_or_si128(_mm_cmpeq_epi8(block, backslash), _mm_cmpeq_epi8(block, slash)));
+                int mask = _mm_movemask_epi8(hits);
+                if (mask != 0)
+                    return pos + __builtin_ctz(mask);
+                pos += 16;
+            }
+#endif
+            while (pos < length && !needsEscape(str[pos]))
+                ++pos;
+            return pos;
+        }
+
         void appendEscape(const char* str, uint64_t length) {
             while (length > 0) {
+                uint64_t clean = escapeScan(str, length);
+                if (clean > 0) {
+                    builderAppend(str, clean);
+                    str += clean;
+                    length -= clean;
+                    if (length == 0)
+                        break;
+                }
+
                 if (*str == '\t') {
                     builderAppend("\\t", sizeof("\\t") - 1);
                 } else if (*str == '\r') {
@@ -129,54 +200,43 @@ namespace OpenLogReplicator {
             }
         }
 
-        void appendAfter(OracleObject* object) {
-            builderAppend(R"(,"after":{)", sizeof(R"(,"after":{)") - 1);
+        void appendColumnKey(std::string& columnName) {
+            if (hasPreviousColumn)
+                builderAppend(',');
+            else
+                hasPreviousColumn = true;
 
-            hasPreviousColumn = false;
-            if (columnFormat > 0 && object != nullptr) {
-                for (typeCol column = 0; column < object->maxSegCol; ++column) {
-                    if (values[column][VALUE_AFTER] != nullptr) {
-                        if (lengths[column][VALUE_AFTER] > 0)
-                            processValue(object, column, values[column][VALUE_AFTER], lengths[column][VALUE_AFTER], compressedAfter);
-                        else
-                            columnNull(object, column);
-                    }
-                }
+            if (columnKey != nullptr) {
+                builderAppend(columnKey->c_str(), columnKey->length());
             } else {
-                uint64_t baseMax = valuesMax >> 6;
-                for (uint64_t base = 0; base <= baseMax; ++base) {
-                    auto column = (typeCol)(base << 6);
-                    for (uint64_t mask = 1; mask != 0; mask <<= 1, ++column) {
-                        if (valuesSet[base] < mask)
-                            break;
-                        if ((valuesSet[base] & mask) == 0)
-                            continue;
-
-                        if (values[column][VALUE_AFTER] != nullptr) {
-                            if (lengths[column][VALUE_AFTER] > 0)
-                                processValue(object, column, values[column][VALUE_AFTER], lengths[column][VALUE_AFTER], compressedAfter);
-                            else
-                                columnNull(object, column);
-                        }
-                    }
-                }
+                builderAppend('"');
+                builderAppend(columnName);
+                builderAppend(R"(":)", sizeof(R"(":)") - 1);
             }
-            builderAppend('}');
         }
 
-        void appendBefore(OracleObject* object) {
-            builderAppend(R"(,"before":{)", sizeof(R"(,"before":{)") - 1);
+        void appendColumn(OracleObject* object, std::vector<std::string>* keys, typeCol column, uint64_t type, bool compressed) {
+            if (values[column][type] == nullptr)
+                return;
+
+            if (keys != nullptr && !compressed && column < (typeCol)keys->size())
+                columnKey = &(*keys)[column];
+            if (lengths[column][type] > 0)
+                processValue(object, column, values[column][type], lengths[column][type], compressed);
+            else
+                columnNull(object, column);
+            columnKey = nullptr;
+        }
+
+        void appendColumns(OracleObject* object, uint64_t type, bool compressed) {
+            std::vector<std::string>* keys = nullptr;
+            if (object != nullptr)
+                keys = &getColumnKeys(object);
 
             hasPreviousColumn = false;
             if (columnFormat > 0 && object != nullptr) {
-                for (typeCol column = 0; column < object->maxSegCol; ++column) {
-                    if (values[column][VALUE_BEFORE] != nullptr) {
-                        if (lengths[column][VALUE_BEFORE] > 0)
-                            processValue(object, column, values[column][VALUE_BEFORE], lengths[column][VALUE_BEFORE], compressedBefore);
-                        else
-                            columnNull(object, column);
-                    }
-                }
+                for (typeCol column = 0; column < object->maxSegCol; ++column)
+                    appendColumn(object, keys, column, type, compressed);
             } else {
                 uint64_t baseMax = valuesMax >> 6;
                 for (uint64_t base = 0; base <= baseMax; ++base) {
@@ -187,19 +247,24 @@ namespace OpenLogReplicator {
                         if ((valuesSet[base] & mask) == 0)
                             continue;
 
-                        if (values[column][VALUE_BEFORE] != nullptr) {
-                            if (lengths[column][VALUE_BEFORE] > 0)
-                                processValue(object, column, values[column][VALUE_BEFORE], lengths[column][VALUE_BEFORE], compressedBefore);
-                            else
-                                columnNull(object, column);
-                        }
+                        appendColumn(object, keys, column, type, compressed);
                     }
                 }
             }
+        }
+
+        void appendAfter(OracleObject* object) {
+            builderAppend(R"(,"after":{)", sizeof(R"(,"after":{)") - 1);
+            appendColumns(object, VALUE_AFTER, compressedAfter);
+            builderAppend('}');
+        }
+
+        void appendBefore(OracleObject* object) {
+            builderAppend(R"(,"before":{)", sizeof(R"(,"before":{)") - 1);
+            appendColumns(object, VALUE_BEFORE, compressedBefore);
             builderAppend('}');
         }
 
-        static time_t tmToEpoch(struct tm* );
         void processInsert(OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid) override;
         void processUpdate(OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid) override;
         void processDelete(OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid) override;
@@ -208,11 +273,30 @@ namespace OpenLogReplicator {
         void processBeginMessage() override;
 
     public:
+        // Shortest representation which reads back to the same value, older compilers without floating point to_chars use max_digits10 digits
+        template<class T>
+        static uint64_t formatFloat(char* buffer, T value) {
+#ifdef HAS_FLOAT_TO_CHARS
+            std::to_chars_result result = std::to_chars(buffer, buffer + FLOAT_BUFFER_LENGTH, value);
+            return result.ptr - buffer;
+#else
+            int length = snprintf(buffer, FLOAT_BUFFER_LENGTH, "%.*g", std::numeric_limits<T>::max_digits10, (double)value);
+            // Decimal separator of current locale
+            for (int i = 0; i < length; ++i)
+                if (buffer[i] == ',')
+                    buffer[i] = '.';
+            return length;
+#endif
+        }
+
         BuilderJson(Ctx* newCtx, Locales* newLocales, Metadata* newMetadata, uint64_t newMessageFormat, uint64_t newRidFormat, uint64_t newXidFormat,
                     uint64_t newTimestampFormat, uint64_t newCharFormat, uint64_t newScnFormat, uint64_t newUnknownFormat, uint64_t newSchemaFormat,
                     uint64_t newColumnFormat, uint64_t newUnknownType, uint64_t newFlushBuffer);
 
+        void resetObjects() override;
         void processCommit(bool system) override;
+        void processPartial(bool system) override;
+        void processRollback(bool system) override;
         void processCheckpoint(typeScn scn, typeTime time_, typeSeq sequence, uint64_t offset, bool redo) override;
     };
 }
@@ -30,16 +30,26 @@ namespace OpenLogReplicator {
                                      uint64_t newColumnFormat, uint64_t newUnknownType, uint64_t newFlushBuffer) :
             Builder(newCtx, newLocales, newMetadata, newMessageFormat, newRidFormat, newXidFormat, newTimestampFormat, newCharFormat, newScnFormat, newUnknownFormat, newSchemaFormat,
                     newColumnFormat, newUnknownType, newFlushBuffer),
+            arenaBlock(nullptr),
+            arena(nullptr),
             redoResponsePB(nullptr),
             valuePB(nullptr),
             payloadPB(nullptr),
             schemaPB(nullptr) {
+        arenaBlock = new char[PROTOBUF_ARENA_BLOCK_SIZE];
+        arena = new google::protobuf::Arena(arenaBlock, PROTOBUF_ARENA_BLOCK_SIZE);
     }
 
     BuilderProtobuf::~BuilderProtobuf() {
-        if (redoResponsePB != nullptr) {
-            delete redoResponsePB;
-            redoResponsePB = nullptr;
+        // Messages are owned by the arena
+        redoResponsePB = nullptr;
+        if (arena != nullptr) {
+            delete arena;
+            arena = nullptr;
+        }
+        if (arenaBlock != nullptr) {
+            delete[] arenaBlock;
+            arenaBlock = nullptr;
         }
         google::protobuf::ShutdownProtobufLibrary();
     }
@@ -304,6 +314,29 @@ namespace OpenLogReplicator {
         buf[length] = 0;
     }
 
+    // Serialization goes straight to the output buffer unless the message crosses its end
+    void BuilderProtobuf::serializeResponse(const char* op, bool force) {
+        uint64_t size = redoResponsePB->ByteSizeLong();
+        if (lastBuffer->length + size < OUTPUT_BUFFER_DATA_SIZE) {
+            uint8_t* end = redoResponsePB->SerializeWithCachedSizesToArray(lastBuffer->data + lastBuffer->length);
+            if (end != lastBuffer->data + lastBuffer->length + size)
+                throw RuntimeException(std::string("PB ") + op + " processing failed, error serializing to buffer");
+            builderShiftFast(size);
+            messageLength += size;
+        } else {
+            if (!redoResponsePB->SerializeToString(&output))
+                throw RuntimeException(std::string("PB ") + op + " processing failed, error serializing to string");
+            builderAppend(output);
+        }
+
+        redoResponsePB = nullptr;
+        payloadPB = nullptr;
+        valuePB = nullptr;
+        schemaPB = nullptr;
+        arena->Reset();
+        builderCommit(force);
+    }
+
     void BuilderProtobuf::processBeginMessage() {
         newTran = false;
         builderBegin(0);
@@ -316,15 +349,7 @@ namespace OpenLogReplicator {
             payloadPB = redoResponsePB->mutable_payload(redoResponsePB->payload_size() - 1);
             payloadPB->set_op(pb::BEGIN);
 
-            std::string output;
-            bool ret = redoResponsePB->SerializeToString(&output);
-            delete redoResponsePB;
-            redoResponsePB = nullptr;
-
-            if (!ret)
-                throw RuntimeException("PB begin processing failed, error serializing to string");
-            builderAppend(output);
-            builderCommit(false);
+            serializeResponse("begin", false);
         }
     }
 
@@ -336,10 +361,7 @@ namespace OpenLogReplicator {
             if (redoResponsePB == nullptr)
                 throw RuntimeException("PB insert processing failed, message missing, internal error");
         } else {
-            if (object != nullptr)
-                builderBegin(object->obj);
-            else
-                builderBegin(0);
+            builderBeginRow(object);
 
             createResponse();
             appendHeader(true, true);
@@ -355,15 +377,7 @@ namespace OpenLogReplicator {
         appendAfter(object);
 
         if ((messageFormat & MESSAGE_FORMAT_FULL) == 0) {
-            std::string output;
-            bool ret = redoResponsePB->SerializeToString(&output);
-            delete redoResponsePB;
-            redoResponsePB = nullptr;
-
-            if (!ret)
-                throw RuntimeException("PB insert processing failed, error serializing to string");
-            builderAppend(output);
-            builderCommit(false);
+            serializeResponse("insert", false);
         }
         ++num;
     }
@@ -376,10 +390,7 @@ namespace OpenLogReplicator {
             if (redoResponsePB == nullptr)
                 throw RuntimeException("PB update processing failed, message missing, internal error");
         } else {
-            if (object != nullptr)
-                builderBegin(object->obj);
-            else
-                builderBegin(0);
+            builderBeginRow(object);
 
             createResponse();
             appendHeader(true, true);
@@ -396,15 +407,7 @@ namespace OpenLogReplicator {
         appendAfter(object);
 
         if ((messageFormat & MESSAGE_FORMAT_FULL) == 0) {
-            std::string output;
-            bool ret = redoResponsePB->SerializeToString(&output);
-            delete redoResponsePB;
-            redoResponsePB = nullptr;
-
-            if (!ret)
-                throw RuntimeException("PB update processing failed, error serializing to string");
-            builderAppend(output);
-            builderCommit(false);
+            serializeResponse("update", false);
         }
         ++num;
     }
@@ -418,10 +421,7 @@ namespace OpenLogReplicator {
                 throw RuntimeException("PB delete processing failed, message missing, internal error");
         } else {
 
-            if (object != nullptr)
-                builderBegin(object->obj);
-            else
-                builderBegin(0);
+            builderBeginRow(object);
 
             createResponse();
             appendHeader(true, true);
@@ -437,15 +437,7 @@ namespace OpenLogReplicator {
         appendBefore(object);
 
         if ((messageFormat & MESSAGE_FORMAT_FULL) == 0) {
-            std::string output;
-            bool ret = redoResponsePB->SerializeToString(&output);
-            delete redoResponsePB;
-            redoResponsePB = nullptr;
-
-            if (!ret)
-                throw RuntimeException("PB delete processing failed, error serializing to string");
-            builderAppend(output);
-            builderCommit(false);
+            serializeResponse("delete", false);
         }
         ++num;
     }
@@ -458,6 +450,7 @@ namespace OpenLogReplicator {
             if (redoResponsePB == nullptr)
                 throw RuntimeException("PB commit processing failed, message missing, internal error");
         } else {
+            builderBegin(0);
             createResponse();
             appendHeader(true, true);
 
@@ -468,15 +461,7 @@ namespace OpenLogReplicator {
         }
 
         if ((messageFormat & MESSAGE_FORMAT_FULL) == 0) {
-            std::string output;
-            bool ret = redoResponsePB->SerializeToString(&output);
-            delete redoResponsePB;
-            redoResponsePB = nullptr;
-
-            if (!ret)
-                throw RuntimeException("PB commit processing failed, error serializing to string");
-            builderAppend(output);
-            builderCommit(true);
+            serializeResponse("commit", true);
         }
         ++num;
     }
@@ -491,6 +476,9 @@ namespace OpenLogReplicator {
         if (system && !FLAG(REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS))
             return;
 
+        if (netChange)
+            netChangeFlush();
+
         // Skip empty transaction
         if (newTran) {
             newTran = false;
@@ -511,19 +499,19 @@ namespace OpenLogReplicator {
             payloadPB->set_op(pb::COMMIT);
         }
 
-        std::string output;
-        bool ret = redoResponsePB->SerializeToString(&output);
-        delete redoResponsePB;
-        redoResponsePB = nullptr;
-
-        if (!ret)
-            throw RuntimeException("PB commit processing failed, error serializing to string");
-        builderAppend(output);
-        builderCommit(true);
+        serializeResponse("commit", true);
 
         num = 0;
     }
 
+    void BuilderProtobuf::processPartial(bool system __attribute__((unused))) {
+        throw RuntimeException("PB partial transaction processing failed, streaming of uncommitted transactions is not supported");
+    }
+
+    void BuilderProtobuf::processRollback(bool system __attribute__((unused))) {
+        throw RuntimeException("PB rollback processing failed, streaming of uncommitted transactions is not supported");
+    }
+
     void BuilderProtobuf::processCheckpoint(typeScn scn __attribute__((unused)), typeTime time_ __attribute__((unused)), typeSeq sequence, uint64_t offset, bool redo) {
         if (FLAG(REDO_FLAGS_HIDE_CHECKPOINT))
             return;
@@ -539,14 +527,6 @@ namespace OpenLogReplicator {
         payloadPB->set_offset(offset);
         payloadPB->set_redo(redo);
 
-        std::string output;
-        bool ret = redoResponsePB->SerializeToString(&output);
-        delete redoResponsePB;
-        redoResponsePB = nullptr;
-
-        if (!ret)
-            throw RuntimeException("PB commit processing failed, error serializing to string");
-        builderAppend(output);
-        builderCommit(true);
+        serializeResponse("commit", true);
     }
 }
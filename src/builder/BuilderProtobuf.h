@@ -24,9 +24,15 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 #ifndef BUILDER_PROTOBUF_H_
 #define BUILDER_PROTOBUF_H_
 
+#define PROTOBUF_ARENA_BLOCK_SIZE               65536
+
 namespace OpenLogReplicator {
     class BuilderProtobuf : public Builder {
     protected:
+        // Messages of one output message, released together after serialization, first block is kept
+        char* arenaBlock;
+        google::protobuf::Arena* arena;
+        std::string output;
         pb::RedoResponse* redoResponsePB;
         pb::Value* valuePB;
         pb::Payload* payloadPB;
@@ -128,9 +134,10 @@ namespace OpenLogReplicator {
         void createResponse() {
             if (redoResponsePB != nullptr)
                 throw RuntimeException("PB commit processing failed, message already exists, internal error");
-            redoResponsePB = new pb::RedoResponse;
+            redoResponsePB = google::protobuf::Arena::CreateMessage<pb::RedoResponse>(arena);
         }
 
+        void serializeResponse(const char* op, bool force);
         static void numToString(uint64_t value, char* buf, uint64_t length);
         void processInsert(OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid) override;
         void processUpdate(OracleObject* object, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid) override;
@@ -146,6 +153,8 @@ namespace OpenLogReplicator {
 
         void initialize() override;
         void processCommit(bool system) override;
+        void processPartial(bool system) override;
+        void processRollback(bool system) override;
         void processCheckpoint(typeScn scn, typeTime time_, typeSeq sequence, uint64_t offset, bool redo) override;
     };
 }
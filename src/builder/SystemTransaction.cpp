@@ -1414,5 +1414,8 @@ namespace OpenLogReplicator {
         for (auto msg: msgs) {
             INFO("updated metadata: " << msg)
         }
+
+        // Objects could have been recreated
+        builder->resetObjects();
     }
 }
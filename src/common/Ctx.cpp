@@ -67,6 +67,9 @@ namespace OpenLogReplicator {
             stopCheckpoints(0),
             stopTransactions(0),
             transactionSizeMax(0),
+            transactionStreamSize(0),
+            transactionReportIntervalS(0),
+            transactionReportTop(10),
             trace(3),
             trace2(0),
             flags(0),
@@ -74,6 +77,7 @@ namespace OpenLogReplicator {
             hardShutdown(false),
             softShutdown(false),
             replicatorFinished(false),
+            transactionReportRequest(false),
             read16(read16Little),
             read32(read32Little),
             read56(read56Little),
@@ -729,4 +733,9 @@ namespace OpenLogReplicator {
                 pthread_kill(thread->pthread, SIGUSR1);
         }
     }
+
+    // Report of open transactions is written by parser thread when next redo log data is processed
+    void Ctx::signalReport() {
+        transactionReportRequest = true;
+    }
 }
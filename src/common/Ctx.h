@@ -259,6 +259,9 @@ namespace OpenLogReplicator {
         uint64_t stopCheckpoints;
         uint64_t stopTransactions;
         uint64_t transactionSizeMax;
+        uint64_t transactionStreamSize;
+        uint64_t transactionReportIntervalS;
+        uint64_t transactionReportTop;
         std::atomic<uint64_t> trace;
         std::atomic<uint64_t> trace2;
         std::atomic<uint64_t> flags;
@@ -266,6 +269,7 @@ namespace OpenLogReplicator {
         std::atomic<bool> hardShutdown;
         std::atomic<bool> softShutdown;
         std::atomic<bool> replicatorFinished;
+        std::atomic<bool> transactionReportRequest;
 
         Ctx();
         virtual ~Ctx();
@@ -348,6 +352,7 @@ namespace OpenLogReplicator {
         void releaseBuffer();
         void allocateBuffer();
         void signalDump();
+        void signalReport();
     };
 }
 
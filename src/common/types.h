@@ -57,6 +57,8 @@ typedef uint32_t typeCon;
 typedef uint32_t typeUser;
 typedef uint8_t  typeOptions;
 typedef uint16_t typeField;
+__extension__ typedef __int128 typeInt128;
+__extension__ typedef unsigned __int128 typeUInt128;
 
 typedef uint16_t typeUnicode16;
 typedef uint32_t typeUnicode32;
@@ -112,6 +114,9 @@ typedef uint64_t typeUnicode;
 #define UNKNOWN_TYPE_HIDE                       0
 #define UNKNOWN_TYPE_SHOW                       1
 
+#define RAW_FORMAT_HEX                          0
+#define RAW_FORMAT_BASE64                       1
+
 // Default, only changed columns for update, or PK
 #define COLUMN_FORMAT_CHANGED                   0
 // Show full nulls from insert & delete
@@ -28,6 +28,25 @@ namespace OpenLogReplicator {
 
     CharacterSet::~CharacterSet() = default;
 
+    // Default for character sets which keep 7-bit ASCII as single bytes
+    uint64_t CharacterSet::decodeToUtf8(const uint8_t* str, uint64_t length, char* out) const {
+        char* start = out;
+        const char* end = out + MAX_FIELD_LENGTH;
+        while (length > 0) {
+            uint64_t run = asciiRun(str, length);
+            if (run > 0) {
+                out = appendRun(out, end, str, run);
+                str += run;
+                length -= run;
+                if (length == 0)
+                    break;
+            }
+
+            out = appendUtf8(out, end, decode(str, length));
+        }
+        return out - start;
+    }
+
     uint64_t CharacterSet::badChar(uint64_t byte1) const {
         ERROR("can't decode character: 0x" << std::setfill('0') << std::setw(2) << std::hex << byte1 << " in character set " << name)
         return UNICODE_UNKNOWN_CHARACTER;
@@ -17,6 +17,12 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "../common/RuntimeException.h"
 #include "../common/types.h"
 
 #ifndef CHARACTER_SET_H_
@@ -34,6 +40,88 @@ namespace OpenLogReplicator {
         [[nodiscard]] uint64_t badChar(uint64_t byte1, uint64_t byte2, uint64_t byte3, uint64_t byte4, uint64_t byte5) const;
         [[nodiscard]] uint64_t badChar(uint64_t byte1, uint64_t byte2, uint64_t byte3, uint64_t byte4, uint64_t byte5, uint64_t byte6) const;
 
+        // Number of leading characters from 7-bit ASCII range
+        static uint64_t asciiRun(const uint8_t* str, uint64_t length) {
+            uint64_t pos = 0;
+#ifdef __SSE2__
+            while (pos + 16 <= length) {
+                int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(str + pos)));
+                if (mask != 0)
+                    return pos + __builtin_ctz(mask);
+                pos += 16;
+            }
+#endif
+            while (pos < length && str[pos] <= 0x7F)
+                ++pos;
+            return pos;
+        }
+
+        static char* appendUtf8(char* out, typeUnicode character) {
+            // 0xxxxxxx
+            if (character <= 0x7F) {
+                *out++ = (char)character;
+
+            // 110xxxxx 10xxxxxx
+            } else if (character <= 0x7FF) {
+                *out++ = (char)(0xC0 | (uint8_t)(character >> 6));
+                *out++ = (char)(0x80 | (uint8_t)(character & 0x3F));
+
+            // 1110xxxx 10xxxxxx 10xxxxxx
+            } else if (character <= 0xFFFF) {
+                *out++ = (char)(0xE0 | (uint8_t)(character >> 12));
+                *out++ = (char)(0x80 | (uint8_t)((character >> 6) & 0x3F));
+                *out++ = (char)(0x80 | (uint8_t)(character & 0x3F));
+
+            // 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
+            } else if (character <= 0x10FFFF) {
+                *out++ = (char)(0xF0 | (uint8_t)(character >> 18));
+                *out++ = (char)(0x80 | (uint8_t)((character >> 12) & 0x3F));
+                *out++ = (char)(0x80 | (uint8_t)((character >> 6) & 0x3F));
+                *out++ = (char)(0x80 | (uint8_t)(character & 0x3F));
+
+            } else
+                throw RuntimeException("got character code: U+" + std::to_string(character));
+            return out;
+        }
+
+        [[noreturn]] static void valueTooLong() {
+            throw RuntimeException("length of value exceeded " + std::to_string(MAX_FIELD_LENGTH) +
+                                   ", increase MAX_FIELD_LENGTH and recompile code");
+        }
+
+        // Output checked against the end of buffer, the exact length is only computed close to the end
+        static char* appendUtf8(char* out, const char* end, typeUnicode character) {
+            if (end - out >= 4)
+                return appendUtf8(out, character);
+
+            char buffer[4];
+            uint64_t length = appendUtf8(buffer, character) - buffer;
+            if ((uint64_t)(end - out) < length)
+                valueTooLong();
+            memcpy(out, buffer, length);
+            return out + length;
+        }
+
+        // UTF-8 form of byte from table of 3 bytes and length
+        static char* appendMapped(char* out, const char* end, const char* character) {
+            if (end - out >= 3) {
+                memcpy(out, character, 3);
+                return out + character[3];
+            }
+
+            if (end - out < character[3])
+                valueTooLong();
+            memcpy(out, character, character[3]);
+            return out + character[3];
+        }
+
+        static char* appendRun(char* out, const char* end, const uint8_t* str, uint64_t length) {
+            if ((uint64_t)(end - out) < length)
+                valueTooLong();
+            memcpy(out, str, length);
+            return out + length;
+        }
+
     public:
         const char* name;
 
@@ -41,6 +129,8 @@ namespace OpenLogReplicator {
         virtual ~CharacterSet();
 
         virtual uint64_t decode(const uint8_t*& str, uint64_t& length) const = 0;
+        // Converts whole value to UTF-8, output buffer holds MAX_FIELD_LENGTH bytes, longer value fails
+        virtual uint64_t decodeToUtf8(const uint8_t* str, uint64_t length, char* out) const;
     };
 }
 
@@ -23,10 +23,26 @@ namespace OpenLogReplicator {
     CharacterSet7bit::CharacterSet7bit(const char* newName, const typeUnicode16* newMap) :
         CharacterSet(newName),
         map(newMap) {
+        buildUtf8Map(false);
     }
 
     CharacterSet7bit::~CharacterSet7bit() = default;
 
+    void CharacterSet7bit::buildUtf8Map(bool highBit) {
+        for (uint64_t byte1 = 0; byte1 < 256; ++byte1) {
+            char* end = appendUtf8(utf8Map[byte1], readMap(highBit ? byte1 : (byte1 & 0x7F)));
+            utf8Map[byte1][3] = (char)(end - utf8Map[byte1]);
+        }
+    }
+
+    uint64_t CharacterSet7bit::decodeToUtf8(const uint8_t* str, uint64_t length, char* out) const {
+        char* start = out;
+        const char* end = out + MAX_FIELD_LENGTH;
+        for (uint64_t i = 0; i < length; ++i)
+            out = appendMapped(out, end, utf8Map[str[i]]);
+        return out - start;
+    }
+
     typeUnicode CharacterSet7bit::decode(const uint8_t*& str, uint64_t& length) const {
         uint64_t byte1 = *str++;
         --length;
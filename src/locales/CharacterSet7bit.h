@@ -26,13 +26,17 @@ namespace OpenLogReplicator {
     class CharacterSet7bit : public CharacterSet {
     protected:
         const typeUnicode16* map;
+        // UTF-8 form of every byte, last element is the length
+        char utf8Map[256][4];
         [[nodiscard]] virtual typeUnicode readMap(uint64_t character) const;
+        void buildUtf8Map(bool highBit);
 
     public:
         CharacterSet7bit(const char* newName, const typeUnicode16* newMap);
         ~CharacterSet7bit() override;
 
         typeUnicode decode(const uint8_t*& str, uint64_t& length) const override;
+        uint64_t decodeToUtf8(const uint8_t* str, uint64_t length, char* out) const override;
 
         // Conversion arrays for 7-bit character sets
         static typeUnicode16 unicode_map_D7DEC[128];
@@ -23,15 +23,39 @@ namespace OpenLogReplicator {
     CharacterSet8bit::CharacterSet8bit(const char* newName, const typeUnicode16* newMap) :
         CharacterSet7bit(newName, newMap),
         customAscii(false) {
+        buildUtf8Map(true);
     }
 
     CharacterSet8bit::CharacterSet8bit(const char* newName, const typeUnicode16* newMap, bool newCustomAscii) :
         CharacterSet7bit(newName, newMap),
         customAscii(newCustomAscii) {
+        buildUtf8Map(true);
     }
 
     CharacterSet8bit::~CharacterSet8bit() = default;
 
+    uint64_t CharacterSet8bit::decodeToUtf8(const uint8_t* str, uint64_t length, char* out) const {
+        if (customAscii)
+            return CharacterSet7bit::decodeToUtf8(str, length, out);
+
+        char* start = out;
+        const char* end = out + MAX_FIELD_LENGTH;
+        while (length > 0) {
+            uint64_t run = asciiRun(str, length);
+            if (run > 0) {
+                out = appendRun(out, end, str, run);
+                str += run;
+                length -= run;
+                if (length == 0)
+                    break;
+            }
+
+            out = appendMapped(out, end, utf8Map[*str++]);
+            --length;
+        }
+        return out - start;
+    }
+
     typeUnicode CharacterSet8bit::decode(const uint8_t*& str, uint64_t& length) const {
         uint64_t byte1 = *str++;
         --length;
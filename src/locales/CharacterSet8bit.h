@@ -34,6 +34,7 @@ namespace OpenLogReplicator {
         ~CharacterSet8bit() override;
 
         typeUnicode decode(const uint8_t*& str, uint64_t& length) const override;
+        uint64_t decodeToUtf8(const uint8_t* str, uint64_t length, char* out) const override;
 
         static typeUnicode16 unicode_map_AR8ADOS710[128];
         static typeUnicode16 unicode_map_AR8ADOS710T[128];
@@ -63,4 +63,12 @@ namespace OpenLogReplicator {
         } else
             return badChar(byte1, byte2, byte3, byte4);
     }
+
+    uint64_t CharacterSetAL16UTF16::decodeToUtf8(const uint8_t* str, uint64_t length, char* out) const {
+        char* start = out;
+        const char* end = out + MAX_FIELD_LENGTH;
+        while (length > 0)
+            out = appendUtf8(out, end, decode(str, length));
+        return out - start;
+    }
 }
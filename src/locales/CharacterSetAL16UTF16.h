@@ -29,6 +29,7 @@ namespace OpenLogReplicator {
         ~CharacterSetAL16UTF16() override;
 
         typeUnicode decode(const uint8_t*& str, uint64_t& length) const override;
+        uint64_t decodeToUtf8(const uint8_t* str, uint64_t length, char* out) const override;
     };
 }
 
@@ -78,4 +78,61 @@ namespace OpenLogReplicator {
 
         return badChar(byte1, byte2, byte3, byte4);
     }
+
+    // Number of leading bytes forming shortest form sequences, which decode() followed by encoding gives back unchanged
+    uint64_t CharacterSetAL32UTF8::validRun(const uint8_t* str, uint64_t length) {
+        uint64_t pos = 0;
+        while (pos < length) {
+            uint64_t byte1 = str[pos];
+
+            // 0xxxxxxx
+            if (byte1 <= 0x7F) {
+                ++pos;
+
+            // 110xxxxx 10xxxxxx, not overlong
+            } else if ((byte1 & 0xE0) == 0xC0) {
+                if (pos + 2 > length || byte1 < 0xC2 || (str[pos + 1] & 0xC0) != 0x80)
+                    break;
+                pos += 2;
+
+            // 1110xxxx 10xxxxxx 10xxxxxx, not overlong
+            } else if ((byte1 & 0xF0) == 0xE0) {
+                if (pos + 3 > length || (str[pos + 1] & 0xC0) != 0x80 || (str[pos + 2] & 0xC0) != 0x80 || (byte1 == 0xE0 && str[pos + 1] < 0xA0))
+                    break;
+                pos += 3;
+
+            // 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx, not overlong and up to U+10FFFF
+            } else if ((byte1 & 0xF8) == 0xF0) {
+                if (pos + 4 > length || (str[pos + 1] & 0xC0) != 0x80 || (str[pos + 2] & 0xC0) != 0x80 || (str[pos + 3] & 0xC0) != 0x80 ||
+                        (byte1 == 0xF0 && str[pos + 1] < 0x90) || byte1 > 0xF4 || (byte1 == 0xF4 && str[pos + 1] > 0x8F))
+                    break;
+                pos += 4;
+
+            } else
+                break;
+
+            // Plain text continues with blocks of ASCII characters
+            pos += asciiRun(str + pos, length - pos);
+        }
+        return pos;
+    }
+
+    // Valid text is copied as it is, only broken or overlong sequences are decoded and replaced
+    uint64_t CharacterSetAL32UTF8::decodeToUtf8(const uint8_t* str, uint64_t length, char* out) const {
+        char* start = out;
+        const char* end = out + MAX_FIELD_LENGTH;
+        while (length > 0) {
+            uint64_t run = validRun(str, length);
+            if (run > 0) {
+                out = appendRun(out, end, str, run);
+                str += run;
+                length -= run;
+                if (length == 0)
+                    break;
+            }
+
+            out = appendUtf8(out, end, decode(str, length));
+        }
+        return out - start;
+    }
 }
@@ -24,11 +24,15 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 
 namespace OpenLogReplicator {
     class CharacterSetAL32UTF8 : public CharacterSet {
+    protected:
+        static uint64_t validRun(const uint8_t* str, uint64_t length);
+
     public:
         CharacterSetAL32UTF8();
         ~CharacterSetAL32UTF8() override;
 
         typeUnicode decode(const uint8_t*& str, uint64_t& length) const override;
+        uint64_t decodeToUtf8(const uint8_t* str, uint64_t length, char* out) const override;
     };
 }
 
@@ -53,6 +53,12 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 #define HAS_ZEROMQ ""
 #endif /* LINK_LIBRARY_PROTOBUF */
 
+#ifdef LINK_LIBRARY_ARROW
+#define HAS_ARROW " Arrow"
+#else
+#define HAS_ARROW ""
+#endif /* LINK_LIBRARY_ARROW */
+
 #ifdef LINK_LIBRARY_RDKAFKA
 #define HAS_KAFKA " Kafka"
 #else
@@ -82,6 +88,10 @@ namespace OpenLogReplicator {
         mainCtx->signalDump();
     }
 
+    void signalReport(int sig __attribute__((unused))) {
+        mainCtx->signalReport();
+    }
+
     int mainFunction(int argc, char** argv) {
         int ret = 1;
         struct utsname name;
@@ -92,7 +102,7 @@ namespace OpenLogReplicator {
                                    ", system: " << name.sysname <<
                                    ", release: " << name.release <<
                                    ", build: " << OpenLogReplicator_CMAKE_BUILD_TYPE <<
-                                   ", modules:" HAS_KAFKA HAS_OCI HAS_PROTOBUF HAS_ZEROMQ)
+                                   ", modules:" HAS_ARROW HAS_KAFKA HAS_OCI HAS_PROTOBUF HAS_ZEROMQ)
 
         const char* fileName = "scripts/OpenLogReplicator.json";
         try {
@@ -136,6 +146,7 @@ int main(int argc, char** argv) {
     signal(SIGPIPE, OpenLogReplicator::signalHandler);
     signal(SIGSEGV, OpenLogReplicator::signalCrash);
     signal(SIGUSR1, OpenLogReplicator::signalDump);
+    signal(SIGUSR2, OpenLogReplicator::signalReport);
 
     std::string olrLocales;
     const char* olrLocalesStr = getenv("OLR_LOCALES");
@@ -150,6 +161,7 @@ int main(int argc, char** argv) {
     signal(SIGPIPE, nullptr);
     signal(SIGSEGV, nullptr);
     signal(SIGUSR1, nullptr);
+    signal(SIGUSR2, nullptr);
 
     return ret;
 }
@@ -49,6 +49,8 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 namespace OpenLogReplicator {
     Metadata::Metadata(Ctx* newCtx, Locales* newLocales, const char* newDatabase, typeConId newConId, typeScn newStartScn, typeSeq newStartSequence,
                        const char* newStartTime, int64_t newStartTimeRel) :
+            writersPending(0),
+            writerCheckpoint(false),
             schema(new Schema(newCtx, newLocales)),
             ctx(newCtx),
             locales(newLocales),
@@ -237,13 +239,43 @@ namespace OpenLogReplicator {
         condStartedReplication.notify_all();
     }
 
+    void Metadata::registerWriter() {
+        std::unique_lock<std::mutex> lck(mtx);
+        ++writersPending;
+    }
+
+    // Replication starts when all writers have read their checkpoints, from the lowest checkpoint scn
+    void Metadata::setStatusReplicateWriter(typeScn scn) {
+        std::unique_lock<std::mutex> lck(mtx);
+        if (status == METADATA_STATUS_REPLICATE)
+            return;
+
+        if (scn != ZERO_SCN && (!writerCheckpoint || scn < startScn)) {
+            // Started earlier - continue work & ignore default startup parameters
+            startScn = scn;
+            startSequence = ZERO_SEQ;
+            startTime.clear();
+            startTimeRel = 0;
+            writerCheckpoint = true;
+        }
+
+        if (writersPending > 0)
+            --writersPending;
+        if (writersPending > 0)
+            return;
+
+        status = METADATA_STATUS_REPLICATE;
+        condStartedReplication.notify_all();
+    }
+
     void Metadata::wakeUp() {
         std::unique_lock<std::mutex> lck(mtx);
         condStartedReplication.notify_all();
     }
 
     void Metadata::checkpoint(typeScn newCheckpointScn, typeTime newCheckpointTime, typeSeq newCheckpointSequence, uint64_t newCheckpointOffset,
-                              uint64_t newCheckpointBytes, typeSeq newMinSequence, uint64_t newMinOffset, typeXid newMinXid) {
+                              uint64_t newCheckpointBytes, typeSeq newMinSequence, uint64_t newMinOffset, typeXid newMinXid,
+                              std::map<typeXid, uint64_t>& newStreamedTransactions) {
         std::unique_lock<std::mutex> lck(mtx);
         checkpointScn = newCheckpointScn;
         checkpointTime = newCheckpointTime;
@@ -253,6 +285,7 @@ namespace OpenLogReplicator {
         minSequence = newMinSequence;
         minOffset = newMinOffset;
         minXid = newMinXid;
+        streamedTransactions.swap(newStreamedTransactions);
     }
 
     void Metadata::writeCheckpoint(bool force) {
@@ -20,6 +20,7 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 #include <atomic>
 #include <condition_variable>
 #include <functional>
+#include <map>
 #include <mutex>
 #include <rapidjson/document.h>
 #include <rapidjson/error/en.h>
@@ -50,6 +51,8 @@ namespace OpenLogReplicator {
     class Metadata {
     protected:
         std::condition_variable condStartedReplication;
+        uint64_t writersPending;
+        bool writerCheckpoint;
 
     public:
         Schema* schema;
@@ -99,6 +102,8 @@ namespace OpenLogReplicator {
         typeSeq minSequence;
         uint64_t minOffset;
         typeXid minXid;
+        // Operations of open transactions already sent in parts
+        std::map<typeXid, uint64_t> streamedTransactions;
         uint64_t schemaInterval;
         typeScn lastCheckpointScn;
         typeSeq lastSequence;
@@ -132,9 +137,12 @@ namespace OpenLogReplicator {
 
         void waitForReplication();
         void setStatusReplicate();
+        void registerWriter();
+        void setStatusReplicateWriter(typeScn scn);
         void wakeUp();
         void checkpoint(typeScn newCheckpointScn, typeTime newCheckpointTime, typeSeq newCheckpointSequence, uint64_t newCheckpointOffset,
-                        uint64_t newCheckpointBytes, typeSeq newMinSequence, uint64_t newMinOffset, typeXid newMinXid);
+                        uint64_t newCheckpointBytes, typeSeq newMinSequence, uint64_t newMinOffset, typeXid newMinXid,
+                        std::map<typeXid, uint64_t>& newStreamedTransactions);
         void writeCheckpoint(bool force);
         void readCheckpoints();
         void readCheckpoint(typeScn scn);
@@ -61,6 +61,18 @@ namespace OpenLogReplicator {
                R"(,"offset":)" << std::dec << metadata->minOffset <<
                R"(,"xid:":")" << metadata->minXid << R"("})";
         }
+        if (!metadata->streamedTransactions.empty()) {
+            ss << R"(,"streamed-tran":[)";
+            bool hasPrev = false;
+            for (auto it : metadata->streamedTransactions) {
+                if (hasPrev)
+                    ss << ",";
+                else
+                    hasPrev = true;
+                ss << R"({"xid":")" << it.first << R"(","ops":)" << std::dec << it.second << "}";
+            }
+            ss << "]";
+        }
         ss << R"(,"big-endian":)" << std::dec << (metadata->ctx->isBigEndian() ? 1 : 0) <<
            R"(,"context":")" << metadata->context <<
            R"(","con-id":)" << std::dec << metadata->conId <<
@@ -391,6 +403,15 @@ namespace OpenLogReplicator {
                 metadata->minSequence = ZERO_SEQ;
                 metadata->minOffset = 0;
                 metadata->minXid = 0;
+
+                metadata->streamedTransactions.clear();
+                if (document.HasMember("streamed-tran")) {
+                    const rapidjson::Value& streamedTranJson = Ctx::getJsonFieldA(name, document, "streamed-tran");
+                    for (rapidjson::SizeType i = 0; i < streamedTranJson.Size(); ++i) {
+                        typeXid xid(Ctx::getJsonFieldS(name, JSON_PARAMETER_LENGTH, streamedTranJson[i], "xid"));
+                        metadata->streamedTransactions[xid] = Ctx::getJsonFieldU64(name, streamedTranJson[i], "ops");
+                    }
+                }
                 metadata->lastCheckpointScn = ZERO_SCN;
                 metadata->lastSequence = ZERO_SEQ;
                 metadata->lastCheckpointOffset = 0;
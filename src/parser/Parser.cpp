@@ -557,11 +557,8 @@ namespace OpenLogReplicator {
 
         // Transaction size limit
         if (ctx->transactionSizeMax > 0 &&
-            transaction->size + redoLogRecord1->length + ROW_HEADER_TOTAL >= ctx->transactionSizeMax) {
-            transactionBuffer->skipXidList.insert(transaction->xid);
-            transactionBuffer->dropTransaction(redoLogRecord1->xid, redoLogRecord1->conId);
-            transaction->purge(transactionBuffer);
-            delete transaction;
+            transaction->size + transaction->sentSize + redoLogRecord1->length + ROW_HEADER_TOTAL >= ctx->transactionSizeMax) {
+            skipTransaction(transaction, redoLogRecord1->conId);
             return;
         }
 
@@ -605,11 +602,8 @@ namespace OpenLogReplicator {
 
             // Transaction size limit
             if (ctx->transactionSizeMax > 0 &&
-                transaction->size + redoLogRecord1->length + ROW_HEADER_TOTAL >= ctx->transactionSizeMax) {
-                transactionBuffer->skipXidList.insert(transaction->xid);
-                transactionBuffer->dropTransaction(redoLogRecord1->xid, redoLogRecord1->conId);
-                transaction->purge(transactionBuffer);
-                delete transaction;
+                transaction->size + transaction->sentSize + redoLogRecord1->length + ROW_HEADER_TOTAL >= ctx->transactionSizeMax) {
+                skipTransaction(transaction, redoLogRecord1->conId);
                 return;
             }
 
@@ -619,7 +613,7 @@ namespace OpenLogReplicator {
             Transaction* transaction = transactionBuffer->findTransaction(xid, redoLogRecord1->conId, true, false, true);
             if (transaction != nullptr) {
                 transaction->rollbackLastOp(transactionBuffer, redoLogRecord1);
-            } else {
+            } else if (!transactionBuffer->checkTransactionBegin(xid, redoLogRecord1->conId)) {
                 typeXidMap xidMap = (redoLogRecord1->xid.getVal() >> 32) | (((uint64_t)redoLogRecord1->conId) << 32);
                 auto iter = transactionBuffer->brokenXidMapList.find(xidMap);
                 if (iter == transactionBuffer->brokenXidMapList.end()) {
@@ -638,10 +632,8 @@ namespace OpenLogReplicator {
         if (redoLogRecord1->xid.sqn() == 0)
             return;
 
-        Transaction* transaction = transactionBuffer->findTransaction(redoLogRecord1->xid, redoLogRecord1->conId, false, true, false);
-        transaction->begin = true;
-        transaction->firstSequence = sequence;
-        transaction->firstOffset = lwnCheckpointBlock * reader->getBlockSize();
+        transactionBuffer->addTransactionBegin(redoLogRecord1->xid, redoLogRecord1->conId, sequence, lwnCheckpointBlock * reader->getBlockSize(),
+                                               lwnTimestamp);
     }
 
     void Parser::appendToTransactionCommit(RedoLogRecord* redoLogRecord1) {
@@ -660,6 +652,18 @@ namespace OpenLogReplicator {
         if (iter != transactionBuffer->brokenXidMapList.end())
             transactionBuffer->brokenXidMapList.erase(xidMap);
 
+        // Transaction without any relevant operation
+        if (transactionBuffer->dropTransactionBegin(redoLogRecord1->xid, redoLogRecord1->conId)) {
+            if (redoLogRecord1->scnRecord > metadata->firstDataScn && ctx->stopTransactions > 0) {
+                --ctx->stopTransactions;
+                if (ctx->stopTransactions == 0) {
+                    INFO("shutdown started - exhausted number of transactions")
+                    ctx->stopSoft();
+                }
+            }
+            return;
+        }
+
         Transaction* transaction = transactionBuffer->findTransaction(redoLogRecord1->xid, redoLogRecord1->conId,
                                                                                true, FLAG(REDO_FLAGS_SHOW_INCOMPLETE_TRANSACTIONS), false);
         if (transaction == nullptr)
@@ -787,13 +791,10 @@ namespace OpenLogReplicator {
                 if (system)
                     transaction->system = true;
 
-                // Transaction size limit
-                if (ctx->transactionSizeMax > 0 &&
-                        transaction->size + redoLogRecord1->length + redoLogRecord2->length + ROW_HEADER_TOTAL >= ctx->transactionSizeMax) {
-                    transactionBuffer->skipXidList.insert(transaction->xid);
-                    transactionBuffer->dropTransaction(redoLogRecord1->xid, redoLogRecord1->conId);
-                    transaction->purge(transactionBuffer);
-                    delete transaction;
+                // Transaction size limit, row images kept after sending part of the transaction are counted too
+                if (ctx->transactionSizeMax > 0 && transaction->size + transaction->sentSize + redoLogRecord1->length + redoLogRecord2->length +
+                        ROW_HEADER_TOTAL >= ctx->transactionSizeMax) {
+                    skipTransaction(transaction, redoLogRecord1->conId);
                     return;
                 }
 
@@ -801,6 +802,17 @@ namespace OpenLogReplicator {
 
                 if (object != nullptr && (object->options & OPTIONS_DEBUG_TABLE) != 0 && opCodeLong == 0x05010B02 && !ctx->softShutdown)
                     transaction->shutdown = true;
+
+                // Part sent before restart is not sent again, only row images are kept for rollback
+                if (transaction->opsStreamedRestored > 0) {
+                    if (transaction->opsAdded >= transaction->opsStreamedRestored && transaction->begin &&
+                            (opCodeLong == 0x05010B0B || opCodeLong == 0x05010B0C || (redoLogRecord1->suppLogFb & FB_L) != 0))
+                        transaction->streamReplay(metadata, transactionBuffer, builder);
+                // Send big transaction before commit, only when the last row is complete
+                } else if (ctx->transactionStreamSize > 0 && transaction->size >= ctx->transactionStreamSize && transaction->begin && !transaction->system &&
+                        lwnScn > metadata->firstDataScn &&
+                        (opCodeLong == 0x05010B0B || opCodeLong == 0x05010B0C || (redoLogRecord1->suppLogFb & FB_L) != 0))
+                    transaction->stream(metadata, transactionBuffer, builder, lwnScn, lwnTimestamp, sequence);
             }
             break;
 
@@ -843,8 +855,12 @@ namespace OpenLogReplicator {
                 typeXid xid(redoLogRecord2->usn, redoLogRecord2->slt, 0);
                 Transaction* transaction = transactionBuffer->findTransaction(xid, redoLogRecord2->conId, true, false, true);
                 if (transaction != nullptr) {
-                    transaction->rollbackLastOp(transactionBuffer, redoLogRecord1, redoLogRecord2);
-                } else {
+                    // Rollback of operation which was already sent
+                    if (transaction->streamed && transaction->lastTc == nullptr)
+                        transaction->rollbackStreamedOp(metadata, builder, redoLogRecord1, lwnScn, lwnTimestamp, sequence);
+                    else
+                        transaction->rollbackLastOp(transactionBuffer, redoLogRecord1, redoLogRecord2);
+                } else if (!transactionBuffer->checkTransactionBegin(xid, redoLogRecord2->conId)) {
                     typeXidMap xidMap = (redoLogRecord2->xid.getVal() >> 32) | (((uint64_t)redoLogRecord2->conId) << 32);
                     auto iter = transactionBuffer->brokenXidMapList.find(xidMap);
                     if (iter == transactionBuffer->brokenXidMapList.end()) {
@@ -861,6 +877,20 @@ namespace OpenLogReplicator {
         }
     }
 
+    // Part of the transaction which was already sent is reverted by the rollback marker
+    void Parser::skipTransaction(Transaction* transaction, typeConId conId) {
+        if (transaction->streamed) {
+            WARNING("transaction " << transaction->xid.toString() << " exceeds 'transaction-max-mb', part already sent is rolled back")
+            builder->processContinue(lwnScn, lwnTimestamp, sequence, transaction->xid);
+            builder->processRollback(transaction->system);
+        }
+
+        transactionBuffer->skipXidList.insert(transaction->xid);
+        transactionBuffer->dropTransaction(transaction->xid, conId);
+        transaction->purge(transactionBuffer);
+        delete transaction;
+    }
+
     void Parser::dumpRedoVector(uint8_t* data, uint64_t recordLength) const {
         if (ctx->trace >= TRACE_WARNING) {
             std::stringstream ss;
@@ -1087,11 +1117,13 @@ namespace OpenLogReplicator {
                         typeSeq minSequence = ZERO_SEQ;
                         uint64_t minOffset = -1;
                         typeXid minXid;
-                        transactionBuffer->checkpoint(minSequence, minOffset, minXid);
+                        std::map<typeXid, uint64_t> streamedTransactions;
+                        transactionBuffer->checkpoint(minSequence, minOffset, minXid, streamedTransactions);
+                        transactionBuffer->report(lwnTimestamp, builder);
                         metadata->checkpoint(lwnScn, lwnTimestamp, sequence,
                                              currentBlock * reader->getBlockSize(),
                                              (currentBlock - lwnConfirmedBlock) * reader->getBlockSize(), minSequence,
-                                             minOffset, minXid);
+                                             minOffset, minXid, streamedTransactions);
 
                         if (ctx->stopCheckpoints > 0) {
                             --ctx->stopCheckpoints;
@@ -1100,7 +1132,8 @@ namespace OpenLogReplicator {
                                 ctx->stopSoft();
                             }
                         }
-                    }
+                    } else if (ctx->transactionReportRequest)
+                        transactionBuffer->report(lwnTimestamp, builder);
 
                     lwnNumCnt = 0;
                     freeLwn();
@@ -31,6 +31,7 @@ namespace OpenLogReplicator {
     class Builder;
     class Reader;
     class Metadata;
+    class Transaction;
     class TransactionBuffer;
 
     struct LwnMember {
@@ -64,6 +65,7 @@ namespace OpenLogReplicator {
         void appendToTransactionBegin(RedoLogRecord* redoLogRecord1);
         void appendToTransactionCommit(RedoLogRecord* redoLogRecord1);
         void appendToTransaction(RedoLogRecord* redoLogRecord1, RedoLogRecord* redoLogRecord2);
+        void skipTransaction(Transaction* transaction, typeConId conId);
         void dumpRedoVector(uint8_t* data, uint64_t recordLength4) const;
 
     public:
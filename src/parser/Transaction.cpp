@@ -37,23 +37,34 @@ namespace OpenLogReplicator {
         commitScn(0),
         firstTc(nullptr),
         lastTc(nullptr),
+        spareTc(nullptr),
         commitTimestamp(0),
+        beginTimestamp(0),
         begin(false),
         rollback(false),
         system(false),
         shutdown(false),
         lastSplit(false),
-        size(0) {
+        streamed(false),
+        size(0),
+        chunks(0),
+        opsAdded(0),
+        opsStreamed(0),
+        opsStreamedRestored(0),
+        sentSize(0),
+        sentOpsLeft(0) {
     }
 
     void Transaction::add(TransactionBuffer* transactionBuffer, RedoLogRecord* redoLogRecord) {
         transactionBuffer->addTransactionChunk(this, redoLogRecord);
         ++opCodes;
+        ++opsAdded;
     }
 
     void Transaction::add(TransactionBuffer* transactionBuffer, RedoLogRecord* redoLogRecord1, RedoLogRecord* redoLogRecord2) {
         transactionBuffer->addTransactionChunk(this, redoLogRecord1, redoLogRecord2);
         ++opCodes;
+        ++opsAdded;
     }
 
     void Transaction::rollbackLastOp(TransactionBuffer* transactionBuffer, RedoLogRecord* redoLogRecord1, RedoLogRecord* redoLogRecord2 __attribute__((unused))) {
@@ -102,14 +113,95 @@ namespace OpenLogReplicator {
             --opCodes;
     }
 
+    void Transaction::rollbackStreamedOp(Metadata* metadata, Builder* builder, RedoLogRecord* redoLogRecord1, typeScn scn, typeTime time_, typeSeq sequence) {
+        Ctx* ctx = metadata->ctx;
+        uint64_t rows;
+
+        switch (redoLogRecord1->opCode) {
+        // Insert row piece - reverts delete, delete row piece - reverts insert, update row piece, overwrite row piece - reverts update
+        case 0x0B02:
+        case 0x0B03:
+        case 0x0B05:
+        case 0x0B06:
+            rows = 1;
+            break;
+
+        // Insert multiple rows - reverts delete multiple rows, delete multiple rows - reverts insert multiple rows
+        case 0x0B0B:
+        case 0x0B0C:
+            rows = redoLogRecord1->nrow;
+            break;
+
+        // Change forwarding address, supp log for update, logminer support - no row data
+        case 0x0B08:
+        case 0x0B10:
+        case 0x0B16:
+            return;
+
+        default:
+            WARNING("can't revert already sent operation of transaction " << xid.toString() << ", op: " << std::hex << redoLogRecord1->opCode <<
+                    " offset: " << std::dec << redoLogRecord1->dataOffset)
+            return;
+        }
+
+        // Compensation sent before restart is not sent again
+        bool send = (scn > metadata->firstDataScn);
+        bool sent = false;
+        TRACE(TRACE2_TRANSACTION, "TRANSACTION: revert sent op: " << std::hex << redoLogRecord1->opCode << " " << *this)
+
+        // The undo part is not available any more, the images are taken from the rows which were sent
+        for (; rows > 0; --rows) {
+            // Row with many pieces is reverted with the first of them, the rest is just counted
+            if (sentOpsLeft > 0) {
+                --sentOpsLeft;
+                continue;
+            }
+
+            if (sentRows.empty()) {
+                WARNING("can't revert already sent operation of transaction " << xid.toString() << ", no row image, op: " << std::hex <<
+                        redoLogRecord1->opCode << " offset: " << std::dec << redoLogRecord1->dataOffset)
+                break;
+            }
+
+            // Pieces of a chained row are in other blocks, only the object can be checked
+            BuilderNetRow* row = sentRows.back();
+            if (row->dataObj != redoLogRecord1->dataObj || (row->ops <= 1 && (row->bdba != redoLogRecord1->bdba ||
+                    (redoLogRecord1->opCode != 0x0B0B && redoLogRecord1->opCode != 0x0B0C && row->slot != redoLogRecord1->slot)))) {
+                WARNING("can't revert already sent operation of transaction " << xid.toString() << ", row image does not match, op: " <<
+                        std::hex << redoLogRecord1->opCode << " offset: " << std::dec << redoLogRecord1->dataOffset)
+                break;
+            }
+
+            if (send) {
+                if (!sent)
+                    builder->processContinue(scn, time_, sequence, xid);
+                sent = true;
+                builder->processNetRow(row, true);
+            }
+            sentOpsLeft = (row->ops > 0) ? row->ops - 1 : 0;
+            sentSize -= row->size;
+            delete row;
+            sentRows.pop_back();
+        }
+
+        if (sent)
+            builder->processPartial(false);
+    }
+
     void Transaction::flush(Metadata* metadata, TransactionBuffer* transactionBuffer, Builder* builder) {
         Ctx* ctx = metadata->ctx;
-        bool opFlush = false;
-        deallocTc = nullptr;
-        uint64_t maxMessageMb = builder->getMaxMessageMb();
         std::unique_lock<std::mutex> lck(metadata->mtx, std::defer_lock);
 
-        if (opCodes == 0 || rollback)
+        if (rollback) {
+            // Part of the transaction was already sent
+            if (streamed) {
+                builder->processContinue(commitScn, commitTimestamp, commitSequence, xid);
+                builder->processRollback(system);
+            }
+            return;
+        }
+
+        if (opCodes == 0 && !streamed)
             return;
         TRACE(TRACE2_TRANSACTION, "TRANSACTION: " << *this)
 
@@ -120,7 +212,71 @@ namespace OpenLogReplicator {
                 throw RedoLogException("system transaction already active:1");
             builder->systemTransaction = new SystemTransaction(builder, metadata);
         }
-        builder->processBegin(commitScn, commitTimestamp, commitSequence, xid, system);
+
+        if (streamed)
+            builder->processContinue(commitScn, commitTimestamp, commitSequence, xid);
+        else
+            builder->processBegin(commitScn, commitTimestamp, commitSequence, xid, system);
+
+        flushChunks(metadata, transactionBuffer, builder, commitScn, commitTimestamp, commitSequence);
+
+        if (system) {
+            builder->systemTransaction->commit(commitScn);
+            delete builder->systemTransaction;
+            builder->systemTransaction = nullptr;
+
+            // Unlock schema
+            lck.unlock();
+        }
+        builder->processCommit(system);
+    }
+
+    void Transaction::stream(Metadata* metadata, TransactionBuffer* transactionBuffer, Builder* builder, typeScn scn, typeTime time_, typeSeq sequence) {
+        Ctx* ctx = metadata->ctx;
+
+        if (opCodes == 0 || system)
+            return;
+        TRACE(TRACE2_TRANSACTION, "TRANSACTION: stream " << *this)
+
+        if (streamed)
+            builder->processContinue(scn, time_, sequence, xid);
+        else
+            builder->processBegin(scn, time_, sequence, xid, false);
+        streamed = true;
+
+        builder->setSentRows(&sentRows, &sentSize, false);
+        flushChunks(metadata, transactionBuffer, builder, scn, time_, sequence);
+        builder->setSentRows(nullptr, nullptr, false);
+        sentOpsLeft = 0;
+        size = 0;
+        opsStreamed = opsAdded;
+
+        builder->processPartial(false);
+    }
+
+    // Part of the transaction was sent before restart, only the row images are kept
+    void Transaction::streamReplay(Metadata* metadata, TransactionBuffer* transactionBuffer, Builder* builder) {
+        Ctx* ctx = metadata->ctx;
+
+        if (opCodes == 0 || system)
+            return;
+        TRACE(TRACE2_TRANSACTION, "TRANSACTION: stream replay " << *this)
+        streamed = true;
+
+        builder->setSentRows(&sentRows, &sentSize, true);
+        flushChunks(metadata, transactionBuffer, builder, 0, typeTime(0), 0);
+        builder->setSentRows(nullptr, nullptr, false);
+        sentOpsLeft = 0;
+        size = 0;
+        opsStreamed = opsAdded;
+        opsStreamedRestored = 0;
+    }
+
+    void Transaction::flushChunks(Metadata* metadata, TransactionBuffer* transactionBuffer, Builder* builder, typeScn scn, typeTime time_, typeSeq sequence) {
+        Ctx* ctx = metadata->ctx;
+        bool opFlush = false;
+        deallocTc = nullptr;
+        uint64_t maxMessageMb = builder->getMaxMessageMb();
 
         uint64_t pos;
         uint64_t type = 0;
@@ -286,20 +442,25 @@ namespace OpenLogReplicator {
 
                 // Split very big transactions
                 if (maxMessageMb > 0 && builder->builderSize() + DATA_BUFFER_SIZE > maxMessageMb * 1024 * 1024) {
-                    WARNING("big transaction divided (forced commit after " << builder->builderSize() << " bytes)")
+                    if (streamed) {
+                        builder->processPartial(system);
+                        builder->processContinue(scn, time_, sequence, xid);
+                    } else {
+                        WARNING("big transaction divided (forced commit after " << builder->builderSize() << " bytes)")
 
-                    if (system) {
-                        TRACE(TRACE2_SYSTEM, "SYSTEM: commit");
-                        builder->systemTransaction->commit(commitScn);
-                        delete builder->systemTransaction;
-                        builder->systemTransaction = nullptr;
+                        if (system) {
+                            TRACE(TRACE2_SYSTEM, "SYSTEM: commit");
+                            builder->systemTransaction->commit(scn);
+                            delete builder->systemTransaction;
+                            builder->systemTransaction = nullptr;
 
-                        TRACE(TRACE2_SYSTEM, "SYSTEM: begin")
-                        builder->systemTransaction = new SystemTransaction(builder, metadata);
-                    }
+                            TRACE(TRACE2_SYSTEM, "SYSTEM: begin")
+                            builder->systemTransaction = new SystemTransaction(builder, metadata);
+                        }
 
-                    builder->processCommit(system);
-                    builder->processBegin(commitScn, commitTimestamp, commitSequence, xid, system);
+                        builder->processCommit(system);
+                        builder->processBegin(scn, time_, sequence, xid, system);
+                    }
                 }
 
                 if (opFlush) {
@@ -321,6 +482,10 @@ namespace OpenLogReplicator {
                 }
             }
 
+            // Report requested during flush of large transaction includes rows collected for net change
+            if (ctx->transactionReportRequest)
+                transactionBuffer->report(time_, builder);
+
             TransactionChunk* nextTc = tc->next;
             tc->next = deallocTc;
             deallocTc = tc;
@@ -337,16 +502,7 @@ namespace OpenLogReplicator {
         firstTc = nullptr;
         lastTc = nullptr;
         opCodes = 0;
-
-        if (system) {
-            builder->systemTransaction->commit(commitScn);
-            delete builder->systemTransaction;
-            builder->systemTransaction = nullptr;
-
-            // Unlock schema
-            lck.unlock();
-        }
-        builder->processCommit(system);
+        chunks = (spareTc != nullptr) ? 1 : 0;
     }
 
     void Transaction::purge(TransactionBuffer* transactionBuffer) {
@@ -363,11 +519,23 @@ namespace OpenLogReplicator {
         }
         deallocTc = nullptr;
 
+        if (spareTc != nullptr) {
+            transactionBuffer->deleteTransactionChunk(spareTc);
+            spareTc = nullptr;
+        }
+
         for (uint8_t* buf : merges)
             delete[] buf;
         merges.clear();
 
+        for (BuilderNetRow* row : sentRows)
+            delete row;
+        sentRows.clear();
+        sentSize = 0;
+        sentOpsLeft = 0;
+
         size = 0;
+        chunks = 0;
         opCodes = 0;
     }
 
@@ -383,10 +551,12 @@ namespace OpenLogReplicator {
                 " seq: " << std::dec << tran.firstSequence <<
                 " offset: " << std::dec << tran.firstOffset <<
                 " xid: " << tran.xid <<
-                " flags: " << std::dec << tran.begin << "/" << tran.rollback << "/" << tran.system <<
+                " flags: " << std::dec << tran.begin << "/" << tran.rollback << "/" << tran.system << "/" << tran.streamed <<
                 " op: " << std::dec << tran.opCodes <<
                 " chunks: " << std::dec << tcCount <<
-                " sz: " << std::dec << tran.size;
+                " sz: " << std::dec << tran.size <<
+                " sent: " << std::dec << tran.sentSize <<
+                " allocated: " << std::dec << tran.chunks;
         return os;
     }
 }
@@ -28,6 +28,7 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 
 namespace OpenLogReplicator {
     class Builder;
+    struct BuilderNetRow;
     class RedoLogRecord;
     class Metadata;
     class TransactionBuffer;
@@ -38,6 +39,8 @@ namespace OpenLogReplicator {
         TransactionChunk* deallocTc;
         uint64_t opCodes;
 
+        void flushChunks(Metadata* metadata, TransactionBuffer* transactionBuffer, Builder* builder, typeScn scn, typeTime time_, typeSeq sequence);
+
     public:
         std::vector<uint8_t*> merges;
         typeXid xid;
@@ -47,13 +50,25 @@ namespace OpenLogReplicator {
         typeScn commitScn;
         TransactionChunk* firstTc;
         TransactionChunk* lastTc;
+        TransactionChunk* spareTc;
         typeTime commitTimestamp;
+        typeTime beginTimestamp;
         bool begin;
         bool rollback;
         bool system;
         bool shutdown;
         bool lastSplit;
+        bool streamed;
         uint64_t size;
+        uint64_t chunks;
+        // Operations added so far, also the ones rolled back, and how many of them were already sent
+        uint64_t opsAdded;
+        uint64_t opsStreamed;
+        uint64_t opsStreamedRestored;
+        // Row images of sent part kept for rollback, their memory and pieces of the last reverted row still to be rolled back
+        std::vector<BuilderNetRow*> sentRows;
+        uint64_t sentSize;
+        uint64_t sentOpsLeft;
 
         explicit Transaction(typeXid newXid);
 
@@ -61,7 +76,10 @@ namespace OpenLogReplicator {
         void add(TransactionBuffer* transactionBuffer, RedoLogRecord* redoLogRecord1, RedoLogRecord* redoLogRecord2);
         void rollbackLastOp(TransactionBuffer* transactionBuffer, RedoLogRecord* redoLogRecord1, RedoLogRecord* redoLogRecord2);
         void rollbackLastOp(TransactionBuffer* transactionBuffer, RedoLogRecord* redoLogRecord);
+        void rollbackStreamedOp(Metadata* metadata, Builder* builder, RedoLogRecord* redoLogRecord1, typeScn scn, typeTime time_, typeSeq sequence);
         void flush(Metadata* metadata, TransactionBuffer* transactionBuffer, Builder* builder);
+        void stream(Metadata* metadata, TransactionBuffer* transactionBuffer, Builder* builder, typeScn scn, typeTime time_, typeSeq sequence);
+        void streamReplay(Metadata* metadata, TransactionBuffer* transactionBuffer, Builder* builder);
         void purge(TransactionBuffer* transactionBuffer);
 
         friend std::ostream& operator<<(std::ostream& os, const Transaction& tran);
@@ -17,8 +17,11 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <algorithm>
 #include <cstring>
+#include <vector>
 
+#include "../builder/Builder.h"
 #include "../common/RedoLogRecord.h"
 #include "../common/RuntimeException.h"
 #include "OpCode0501.h"
@@ -28,7 +31,8 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 
 namespace OpenLogReplicator {
     TransactionBuffer::TransactionBuffer(Ctx* newCtx) :
-        ctx(newCtx) {
+        ctx(newCtx),
+        lastReport(time(nullptr)) {
     }
 
     TransactionBuffer::~TransactionBuffer() {
@@ -47,6 +51,7 @@ namespace OpenLogReplicator {
             delete transaction;
         }
         xidTransactionMap.clear();
+        xidBeginMap.clear();
     }
 
     Transaction* TransactionBuffer::findTransaction(typeXid xid, typeConId conId, bool old, bool add, bool rollback) {
@@ -58,15 +63,47 @@ namespace OpenLogReplicator {
             transaction = transactionIter->second;
             if (!rollback && (!old || transaction->xid != xid))
                 throw RedoLogException("Transaction " + xid.toString() + " conflicts with " + transaction->xid.toString());
-        } else {
-            if (!add)
+            return transaction;
+        }
+
+        // Transaction is created on first relevant operation
+        auto beginIter = xidBeginMap.find(xidMap);
+        if (beginIter != xidBeginMap.end()) {
+            // Nothing to roll back before the first relevant operation
+            if (rollback)
                 return nullptr;
 
-            transaction = new Transaction(xid);
+            TransactionBegin& transactionBegin = beginIter->second;
+            if (!old || transactionBegin.xid != xid)
+                throw RedoLogException("Transaction " + xid.toString() + " conflicts with " + transactionBegin.xid.toString());
+
+            transaction = new Transaction(transactionBegin.xid);
+            transaction->begin = true;
+            transaction->beginTimestamp = transactionBegin.timestamp;
+            transaction->firstSequence = transactionBegin.sequence;
+            transaction->firstOffset = transactionBegin.offset;
+
+            // Part of the transaction was sent before restart
+            auto streamedIter = streamedXidMap.find(transaction->xid);
+            if (streamedIter != streamedXidMap.end()) {
+                transaction->opsStreamedRestored = streamedIter->second;
+                streamedXidMap.erase(streamedIter);
+            }
             {
                 std::unique_lock<std::mutex> lck(mtx);
+                xidBeginMap.erase(beginIter);
                 xidTransactionMap[xidMap] = transaction;
             }
+            return transaction;
+        }
+
+        if (!add)
+            return nullptr;
+
+        transaction = new Transaction(xid);
+        {
+            std::unique_lock<std::mutex> lck(mtx);
+            xidTransactionMap[xidMap] = transaction;
         }
 
         return transaction;
@@ -80,6 +117,42 @@ namespace OpenLogReplicator {
         }
     }
 
+    void TransactionBuffer::addTransactionBegin(typeXid xid, typeConId conId, typeSeq sequence, uint64_t offset, typeTime timestamp) {
+        typeXidMap xidMap = (xid.getVal() >> 32) | (((uint64_t)conId) << 32);
+
+        auto transactionIter = xidTransactionMap.find(xidMap);
+        if (transactionIter != xidTransactionMap.end())
+            throw RedoLogException("Transaction " + xid.toString() + " conflicts with " + transactionIter->second->xid.toString());
+
+        auto beginIter = xidBeginMap.find(xidMap);
+        if (beginIter != xidBeginMap.end())
+            throw RedoLogException("Transaction " + xid.toString() + " conflicts with " + beginIter->second.xid.toString());
+
+        {
+            std::unique_lock<std::mutex> lck(mtx);
+            xidBeginMap[xidMap] = {xid, sequence, offset, timestamp};
+        }
+    }
+
+    bool TransactionBuffer::checkTransactionBegin(typeXid xid, typeConId conId) const {
+        typeXidMap xidMap = (xid.getVal() >> 32) | (((uint64_t)conId) << 32);
+        return xidBeginMap.find(xidMap) != xidBeginMap.end();
+    }
+
+    bool TransactionBuffer::dropTransactionBegin(typeXid xid, typeConId conId) {
+        typeXidMap xidMap = (xid.getVal() >> 32) | (((uint64_t)conId) << 32);
+
+        auto beginIter = xidBeginMap.find(xidMap);
+        if (beginIter == xidBeginMap.end() || beginIter->second.xid != xid)
+            return false;
+
+        {
+            std::unique_lock<std::mutex> lck(mtx);
+            xidBeginMap.erase(beginIter);
+        }
+        return true;
+    }
+
     TransactionChunk* TransactionBuffer::newTransactionChunk() {
         uint8_t* chunk;
         TransactionChunk* tc;
@@ -108,6 +181,22 @@ namespace OpenLogReplicator {
         return tc;
     }
 
+    TransactionChunk* TransactionBuffer::newTransactionChunk(Transaction* transaction) {
+        // Reuse chunk emptied by rollback
+        if (transaction->spareTc != nullptr) {
+            TransactionChunk* tc = transaction->spareTc;
+            transaction->spareTc = nullptr;
+            tc->elements = 0;
+            tc->size = 0;
+            tc->prev = nullptr;
+            tc->next = nullptr;
+            return tc;
+        }
+
+        ++transaction->chunks;
+        return newTransactionChunk();
+    }
+
     void TransactionBuffer::deleteTransactionChunk(TransactionChunk* tc) {
         uint8_t* chunk = tc->header;
         uint64_t pos = tc->pos;
@@ -160,13 +249,13 @@ namespace OpenLogReplicator {
 
         // Empty list
         if (transaction->lastTc == nullptr) {
-            transaction->lastTc = newTransactionChunk();
+            transaction->lastTc = newTransactionChunk(transaction);
             transaction->firstTc = transaction->lastTc;
         }
 
         // New block needed
         if (transaction->lastTc->size + length > DATA_BUFFER_SIZE) {
-            TransactionChunk* tcNew = newTransactionChunk();
+            TransactionChunk* tcNew = newTransactionChunk(transaction);
             tcNew->prev = transaction->lastTc;
             transaction->lastTc->next = tcNew;
             transaction->lastTc = tcNew;
@@ -230,13 +319,13 @@ namespace OpenLogReplicator {
 
         // Empty list
         if (transaction->lastTc == nullptr) {
-            transaction->lastTc = newTransactionChunk();
+            transaction->lastTc = newTransactionChunk(transaction);
             transaction->firstTc = transaction->lastTc;
         }
 
         // New block needed
         if (transaction->lastTc->size + length > DATA_BUFFER_SIZE) {
-            TransactionChunk* tcNew = newTransactionChunk();
+            TransactionChunk* tcNew = newTransactionChunk(transaction);
             tcNew->prev = transaction->lastTc;
             transaction->lastTc->next = tcNew;
             transaction->lastTc = tcNew;
@@ -264,6 +353,7 @@ namespace OpenLogReplicator {
         }
     }
 
+    // Undo records come one at a time, each one removes the last operation using the length stored at its end
     void TransactionBuffer::rollbackTransactionChunk(Transaction* transaction) {
         if (transaction->lastTc == nullptr)
             return;
@@ -286,7 +376,14 @@ namespace OpenLogReplicator {
             } else {
                 transaction->firstTc = nullptr;
             }
-            deleteTransactionChunk(tc);
+
+            // Keep one empty chunk, rollback to savepoint is often followed by new operations
+            if (transaction->spareTc == nullptr)
+                transaction->spareTc = tc;
+            else {
+                deleteTransactionChunk(tc);
+                --transaction->chunks;
+            }
         }
     }
 
@@ -328,9 +425,13 @@ namespace OpenLogReplicator {
         redoLogRecord1->data = mergeBuffer;
     }
 
-    void TransactionBuffer::checkpoint(typeSeq& minSequence, uint64_t& minOffset, typeXid& minXid) {
+    void TransactionBuffer::checkpoint(typeSeq& minSequence, uint64_t& minOffset, typeXid& minXid, std::map<typeXid, uint64_t>& streamedTransactions) {
         for (auto it : xidTransactionMap) {
             Transaction* transaction = it.second;
+            if (transaction->opsStreamedRestored > 0)
+                streamedTransactions[transaction->xid] = transaction->opsStreamedRestored;
+            else if (transaction->opsStreamed > 0)
+                streamedTransactions[transaction->xid] = transaction->opsStreamed;
             if (transaction->firstSequence < minSequence) {
                 minSequence = transaction->firstSequence;
                 minOffset = transaction->firstOffset;
@@ -340,5 +441,63 @@ namespace OpenLogReplicator {
                 minXid = transaction->xid;
             }
         }
+
+        for (auto it : xidBeginMap) {
+            TransactionBegin& transactionBegin = it.second;
+            if (transactionBegin.sequence < minSequence) {
+                minSequence = transactionBegin.sequence;
+                minOffset = transactionBegin.offset;
+                minXid = transactionBegin.xid;
+            } else if (transactionBegin.sequence == minSequence && transactionBegin.offset < minOffset) {
+                minOffset = transactionBegin.offset;
+                minXid = transactionBegin.xid;
+            }
+        }
+    }
+
+    // Periodic report or the one requested by signal, size of sent part is memory of row images kept for rollback
+    void TransactionBuffer::report(typeTime time_, Builder* builder) {
+        if (!ctx->transactionReportRequest.exchange(false)) {
+            if (ctx->transactionReportIntervalS == 0)
+                return;
+
+            time_t now = time(nullptr);
+            if (now < lastReport + (time_t)ctx->transactionReportIntervalS)
+                return;
+            lastReport = now;
+        }
+
+        std::vector<Transaction*> transactions;
+        uint64_t sizeTotal = 0;
+        uint64_t sentSizeTotal = 0;
+        uint64_t chunksTotal = 0;
+        transactions.reserve(xidTransactionMap.size());
+        for (auto it : xidTransactionMap) {
+            transactions.push_back(it.second);
+            sizeTotal += it.second->size;
+            sentSizeTotal += it.second->sentSize;
+            chunksTotal += it.second->chunks;
+        }
+
+        INFO("open transactions: " << std::dec << transactions.size() << " (without data: " << xidBeginMap.size() << "), size: " << (sizeTotal / 1024 / 1024) <<
+             "MB, sent: " << (sentSizeTotal / 1024 / 1024) << "MB, chunks: " << chunksTotal << ", net change: " << (builder->getNetSize() / 1024 / 1024) << "MB")
+
+        uint64_t top = ctx->transactionReportTop;
+        if (top > transactions.size())
+            top = transactions.size();
+        std::partial_sort(transactions.begin(), transactions.begin() + top, transactions.end(),
+                          [](Transaction* a, Transaction* b) { return a->size + a->sentSize > b->size + b->sentSize; });
+
+        for (uint64_t i = 0; i < top; ++i) {
+            Transaction* transaction = transactions[i];
+            if (transaction->begin) {
+                INFO("transaction " << transaction->xid << " size: " << std::dec << transaction->size << " sent: " << transaction->sentSize << " (rows: " <<
+                     transaction->sentRows.size() << ") chunks: " << transaction->chunks << " age: " << (time_.toTime() - transaction->beginTimestamp.toTime()) <<
+                     "s seq: " << transaction->firstSequence << " offset: " << transaction->firstOffset)
+            } else {
+                INFO("transaction " << transaction->xid << " size: " << std::dec << transaction->size << " sent: " << transaction->sentSize << " (rows: " <<
+                     transaction->sentRows.size() << ") chunks: " << transaction->chunks << " age: unknown (no begin)")
+            }
+        }
     }
 }
@@ -17,12 +17,15 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <ctime>
+#include <map>
 #include <mutex>
 #include <set>
 #include <unordered_map>
 
 #include "../common/Ctx.h"
 #include "../common/types.h"
+#include "../common/typeTime.h"
 #include "../common/typeXid.h"
 
 #ifndef TRANSACTION_BUFFER_H_
@@ -41,6 +44,7 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 #define BUFFERS_FREE_MASK   0xFFFF
 
 namespace OpenLogReplicator {
+    class Builder;
     class RedoLogRecord;
     class Transaction;
 
@@ -54,6 +58,13 @@ namespace OpenLogReplicator {
         uint8_t buffer[DATA_BUFFER_SIZE];
     };
 
+    struct TransactionBegin {
+        typeXid xid;
+        typeSeq sequence;
+        uint64_t offset;
+        typeTime timestamp;
+    };
+
     class TransactionBuffer {
     protected:
         Ctx* ctx;
@@ -62,10 +73,13 @@ namespace OpenLogReplicator {
 
         std::mutex mtx;
         std::unordered_map<typeXidMap, Transaction*> xidTransactionMap;
+        std::unordered_map<typeXidMap, TransactionBegin> xidBeginMap;
+        time_t lastReport;
 
     public:
         std::set<typeXid> skipXidList;
         std::set<typeXidMap> brokenXidMapList;
+        std::map<typeXid, uint64_t> streamedXidMap;
         std::string dumpPath;
 
         explicit TransactionBuffer(Ctx* newCtx);
@@ -74,14 +88,19 @@ namespace OpenLogReplicator {
         void purge();
         [[nodiscard]] Transaction* findTransaction(typeXid xid, typeConId conId, bool old, bool add, bool rollback);
         void dropTransaction(typeXid xid, typeConId conId);
+        void addTransactionBegin(typeXid xid, typeConId conId, typeSeq sequence, uint64_t offset, typeTime timestamp);
+        [[nodiscard]] bool checkTransactionBegin(typeXid xid, typeConId conId) const;
+        bool dropTransactionBegin(typeXid xid, typeConId conId);
         void addTransactionChunk(Transaction* transaction, RedoLogRecord* redoLogRecord1);
         void addTransactionChunk(Transaction* transaction, RedoLogRecord* redoLogRecord1, RedoLogRecord* redoLogRecord2);
         void rollbackTransactionChunk(Transaction* transaction);
         [[nodiscard]] TransactionChunk* newTransactionChunk();
+        [[nodiscard]] TransactionChunk* newTransactionChunk(Transaction* transaction);
         void deleteTransactionChunk(TransactionChunk* tc);
         void deleteTransactionChunks(TransactionChunk* tc);
         void mergeBlocks(uint8_t* mergeBuffer, RedoLogRecord* redoLogRecord1, RedoLogRecord* redoLogRecord2);
-        void checkpoint(typeSeq& minSequence, uint64_t& minOffset, typeXid& minXid);
+        void checkpoint(typeSeq& minSequence, uint64_t& minOffset, typeXid& minXid, std::map<typeXid, uint64_t>& streamedTransactions);
+        void report(typeTime time_, Builder* builder);
     };
 }
 
@@ -161,6 +161,7 @@ namespace OpenLogReplicator {
                     break;
 
                 metadata->readCheckpoints();
+                transactionBuffer->streamedXidMap = metadata->streamedTransactions;
                 if (metadata->firstDataScn == ZERO_SCN || metadata->sequence == ZERO_SEQ)
                     positionReader();
 
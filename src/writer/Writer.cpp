@@ -37,68 +37,137 @@ namespace OpenLogReplicator {
             metadata(newMetadata),
             checkpointScn(ZERO_SCN),
             checkpointTime(time(nullptr)),
+            checkpointDetached(false),
+            skipScn(ZERO_SCN),
             confirmedScn(ZERO_SCN),
             confirmedMessages(0),
             sentMessages(0),
             tmpQueueSize(0),
             maxQueueSize(0),
             queue(nullptr),
-            streaming(false) {
+            queueConfirmed(nullptr),
+            queueFirst(0),
+            reader(nullptr),
+            maxLagMb(0),
+            shard(0),
+            shards(1),
+            shardKey(WRITER_SHARD_KEY_TABLE),
+            streaming(false),
+            scatterGather(false) {
     }
 
     Writer::~Writer() {
         if (queue != nullptr) {
+            resetQueue();
             delete[] queue;
             queue = nullptr;
         }
+
+        if (queueConfirmed != nullptr) {
+            delete[] queueConfirmed;
+            queueConfirmed = nullptr;
+        }
     }
 
     void Writer::initialize() {
         if (queue != nullptr)
             return;
-        queue = new BuilderMsg*[ctx->queueSize];
+        queue = new BuilderMsg[ctx->queueSize];
+        queueConfirmed = new uint64_t[(ctx->queueSize + 63) / 64];
+        resetQueue();
+
+        reader = builder->addReader(maxLagMb);
+        metadata->registerWriter();
+        // First writer of the source keeps the original checkpoint name, thread alias of other writers is "<target alias>-writer",
+        // so their checkpoints are "<db>-<target alias>-writer-chkpt"
+        if (reader->num == 0)
+            checkpointName = database + "-chkpt";
+        else
+            checkpointName = database + "-" + alias + "-chkpt";
     }
 
-    void Writer::createMessage(BuilderMsg* msg) {
-        ++sentMessages;
+    void Writer::setMaxLagMb(uint64_t newMaxLagMb) {
+        maxLagMb = newMaxLagMb;
+    }
 
-        queue[tmpQueueSize++] = msg;
-        if (tmpQueueSize > maxQueueSize)
-            maxQueueSize = tmpQueueSize;
+    void Writer::setShard(uint64_t newShard, uint64_t newShards, uint64_t newShardKey) {
+        shard = newShard;
+        shards = newShards;
+        shardKey = newShardKey;
     }
 
-    void Writer::sortQueue() {
-        if (tmpQueueSize == 0)
-            return;
+    // Messages not related to any table (begin, commit, checkpoint) are sent by the first shard only
+    bool Writer::shardMatch(BuilderMsg* msg) const {
+        if (shards <= 1)
+            return true;
+        if (msg->obj == 0)
+            return shard == 0;
+        if (shardKey == WRITER_SHARD_KEY_PRIMARY_KEY && msg->key != 0)
+            return msg->key % shards == shard;
+        return msg->obj % shards == shard;
+    }
 
-        BuilderMsg** oldQueue = queue;
-        queue = new BuilderMsg*[ctx->queueSize];
-        uint64_t oldQueueSize = tmpQueueSize;
-
-        for (uint64_t newId = 0 ; newId < tmpQueueSize; ++newId) {
-            queue[newId] = oldQueue[0];
-            uint64_t i = 0;
-            --oldQueueSize;
-            while (i < oldQueueSize) {
-                if (i * 2 + 2 < oldQueueSize && oldQueue[i * 2 + 2]->id < oldQueue[oldQueueSize]->id) {
-                    if (oldQueue[i * 2 + 1]->id < oldQueue[i * 2 + 2]->id) {
-                        oldQueue[i] = oldQueue[i * 2 + 1];
-                        i = i * 2 + 1;
-                    } else {
-                        oldQueue[i] = oldQueue[i * 2 + 2];
-                        i = i * 2 + 2;
-                    }
-                } else if (i * 2 + 1 < oldQueueSize && oldQueue[i * 2 + 1]->id < oldQueue[oldQueueSize]->id) {
-                    oldQueue[i] = oldQueue[i * 2 + 1];
-                    i = i * 2 + 1;
-                } else
-                    break;
-            }
-            oldQueue[i] = oldQueue[oldQueueSize];
+    // Replication restarts from the lowest checkpoint of all writers, messages already confirmed by this writer are not sent again
+    bool Writer::checkpointMatch(BuilderMsg* msg) const {
+        return skipScn == ZERO_SCN || msg->scn > skipScn;
+    }
+
+    // Message of other shard is confirmed without sending to keep order of confirmations
+    void Writer::skipMessage(BuilderMsg* msg) {
+        ++tmpQueueSize;
+        confirmMessage(msg);
+    }
+
+    void Writer::resetQueue() {
+        uint64_t pos = queueFirst;
+        for (uint64_t i = 0; i < tmpQueueSize; ++i) {
+            if ((queue[pos].flags & OUTPUT_BUFFER_ALLOCATED) != 0)
+                free(queue[pos].data);
+            if (++pos == ctx->queueSize)
+                pos = 0;
         }
+        tmpQueueSize = 0;
+        queueFirst = 0;
+        memset((void*)queueConfirmed, 0, sizeof(uint64_t) * ((ctx->queueSize + 63) / 64));
+    }
 
-        if (oldQueue != nullptr)
-            delete[] oldQueue;
+    // Header is copied to the ring, the buffers may be shared with other writers
+    BuilderMsg* Writer::queueMessage(BuilderMsg* msg) {
+        uint64_t pos = queueFirst + tmpQueueSize;
+        if (pos >= ctx->queueSize)
+            pos -= ctx->queueSize;
+        queue[pos] = *msg;
+        return queue + pos;
+    }
+
+    bool Writer::detach() {
+        if (reader->state == BUILDER_READER_ACTIVE)
+            return false;
+
+        // Waiting for confirmations of a stalled target would hold the buffers of all writers, unconfirmed messages are dropped
+        // and sent again after restart from the checkpoint
+        if (reader->state == BUILDER_READER_LAGGING) {
+            flush();
+            purgeQueue();
+            uint64_t dropped = tmpQueueSize;
+            resetQueue();
+            reader->state = BUILDER_READER_DETACHING;
+            builder->releaseBuffers(reader, 0);
+
+            writeCheckpoint(true);
+            reader->state = BUILDER_READER_DETACHED;
+            WARNING("writer " << getName() << " detached, last confirmed scn: " << std::dec << confirmedScn << ", unconfirmed messages dropped: " <<
+                    dropped)
+        }
+        return true;
+    }
+
+    void Writer::createMessage() {
+        ++sentMessages;
+
+        ++tmpQueueSize;
+        if (tmpQueueSize > maxQueueSize)
+            maxQueueSize = tmpQueueSize;
     }
 
     void Writer::confirmMessage(BuilderMsg* msg) {
@@ -107,46 +176,33 @@ namespace OpenLogReplicator {
                 WARNING("trying to confirm empty message")
                 return;
             }
-            msg = queue[0];
+            msg = queue + queueFirst;
         }
 
-        msg->flags |= OUTPUT_BUFFER_CONFIRMED;
+        uint64_t pos = msg - queue;
+        queueConfirmed[pos >> 6] |= ((uint64_t)1) << (pos & 0x3F);
         if (msg->flags & OUTPUT_BUFFER_ALLOCATED) {
-            delete[] msg->data;
+            free(msg->data);
             msg->flags &= ~OUTPUT_BUFFER_ALLOCATED;
         }
         ++confirmedMessages;
 
+        // Advance while the oldest message is confirmed
         uint64_t maxId = 0;
-        {
-            while (tmpQueueSize > 0 && (queue[0]->flags & OUTPUT_BUFFER_CONFIRMED) != 0) {
-                maxId = queue[0]->queueId;
-                confirmedScn = queue[0]->scn;
-
-                if (--tmpQueueSize == 0)
-                    break;
-
-                uint64_t i = 0;
-                while (i < tmpQueueSize) {
-                    if (i * 2 + 2 < tmpQueueSize && queue[i * 2 + 2]->id < queue[tmpQueueSize]->id) {
-                        if (queue[i * 2 + 1]->id < queue[i * 2 + 2]->id) {
-                            queue[i] = queue[i * 2 + 1];
-                            i = i * 2 + 1;
-                        } else {
-                            queue[i] = queue[i * 2 + 2];
-                            i = i * 2 + 2;
-                        }
-                    } else if (i * 2 + 1 < tmpQueueSize && queue[i * 2 + 1]->id < queue[tmpQueueSize]->id) {
-                        queue[i] = queue[i * 2 + 1];
-                        i = i * 2 + 1;
-                    } else
-                        break;
-                }
-                queue[i] = queue[tmpQueueSize];
-            }
+        bool advanced = false;
+        while (tmpQueueSize > 0 && (queueConfirmed[queueFirst >> 6] & (((uint64_t)1) << (queueFirst & 0x3F))) != 0) {
+            queueConfirmed[queueFirst >> 6] &= ~(((uint64_t)1) << (queueFirst & 0x3F));
+            maxId = queue[queueFirst].queueId;
+            confirmedScn = queue[queueFirst].scn;
+            advanced = true;
+
+            if (++queueFirst == ctx->queueSize)
+                queueFirst = 0;
+            --tmpQueueSize;
         }
 
-        builder->releaseBuffers(maxId);
+        if (advanced)
+            builder->releaseBuffers(reader, maxId);
     }
 
     void Writer::run() {
@@ -167,6 +223,8 @@ namespace OpenLogReplicator {
 
                 if (ctx->softShutdown && ctx->replicatorFinished)
                     break;
+                if (reader->state == BUILDER_READER_DETACHED)
+                    break;
             }
         } catch (ConfigurationException& ex) {
             ERROR(ex.msg)
@@ -186,22 +244,26 @@ namespace OpenLogReplicator {
         readCheckpoint();
 
         BuilderMsg* msg;
-        BuilderQueue* curBuffer = builder->firstBuffer;
+        BuilderQueue* curBuffer = builder->getFirstBuffer();
         uint64_t curLength = 0;
         uint64_t tmpLength = 0;
-        tmpQueueSize = 0;
+        resetQueue();
 
         // Start streaming
         while (!ctx->hardShutdown) {
 
             // Get message to send
             while (!ctx->hardShutdown) {
+                uint64_t flushSeq = builder->getFlushSeq();
+                if (detach())
+                    return;
+
                 // Check for client checkpoint
                 pollQueue();
                 writeCheckpoint(false);
 
-                // Next buffer
-                if (curBuffer->length == curLength && curBuffer->next != nullptr) {
+                // Next buffer, link is published after the final length of the previous buffer
+                if (curBuffer->next.load(std::memory_order_acquire) != nullptr && curBuffer->length.load(std::memory_order_acquire) == curLength) {
                     curBuffer = curBuffer->next;
                     curLength = 0;
                 }
@@ -209,15 +271,19 @@ namespace OpenLogReplicator {
                 // Found something
                 msg = (BuilderMsg *) (curBuffer->data + curLength);
 
-                if (curBuffer->length > curLength + sizeof(struct BuilderMsg) && msg->length > 0) {
-                    tmpLength = curBuffer->length;
+                tmpLength = curBuffer->length.load(std::memory_order_acquire);
+                if (tmpLength > curLength + sizeof(struct BuilderMsg) && __atomic_load_n(&msg->length, __ATOMIC_ACQUIRE) > 0) {
+                    // Reload after the message is acquired so that the whole message is covered
+                    tmpLength = curBuffer->length.load(std::memory_order_acquire);
                     break;
                 }
 
+                // No more ready messages
+                flush();
                 ctx->wakeAllOutOfMemory();
                 if (ctx->softShutdown && ctx->replicatorFinished)
                     break;
-                builder->sleepForWriterWork(tmpQueueSize, ctx->pollIntervalUs);
+                builder->sleepForWriterWork(flushSeq, tmpQueueSize, ctx->pollIntervalUs);
             }
 
             if (ctx->hardShutdown)
@@ -226,57 +292,88 @@ namespace OpenLogReplicator {
             // Send message
             while (curLength + sizeof(struct BuilderMsg) < tmpLength && !ctx->hardShutdown) {
                 msg = (BuilderMsg*) (curBuffer->data + curLength);
-                if (msg->length == 0)
+                if (__atomic_load_n(&msg->length, __ATOMIC_ACQUIRE) == 0)
                     break;
 
                 // Queue is full
                 pollQueue();
-                while (tmpQueueSize >= ctx->queueSize && !ctx->hardShutdown) {
+                if (tmpQueueSize >= ctx->queueSize)
+                    flush();
+                while (tmpQueueSize >= ctx->queueSize && !ctx->hardShutdown && reader->state == BUILDER_READER_ACTIVE) {
                     DEBUG("output queue is full (" << std::dec << tmpQueueSize << " schemaElements), sleeping " << std::dec << ctx->pollIntervalUs << "us")
                     usleep(ctx->pollIntervalUs);
                     pollQueue();
                 }
+                if (detach())
+                    return;
 
                 writeCheckpoint(false);
                 if (ctx->hardShutdown)
                     break;
 
+                // Flags and data pointer are changed by this writer only
+                msg = queueMessage(msg);
+
                 // builder->firstBufferPos += OUTPUT_BUFFER_RECORD_HEADER_SIZE;
                 uint64_t length8 = (msg->length + 7) & 0xFFFFFFFFFFFFFFF8;
-                curLength += sizeof(struct BuilderMsg);
+                curLength += sizeof(struct BuilderMsg) + ((msg->ownerLength + msg->tableLength + msg->keyLength + 7) & 0xFFFFFFFFFFFFFFF8);
+
+                bool skip = !shardMatch(msg) || !checkpointMatch(msg);
 
                 // Message in one part - send directly from buffer
                 if (curLength + length8 <= OUTPUT_BUFFER_DATA_SIZE) {
-                    createMessage(msg);
-                    sendMessage(msg);
+                    if (skip)
+                        skipMessage(msg);
+                    else {
+                        createMessage();
+                        sendMessage(msg);
+                    }
                     curLength += length8;
                     msg = (BuilderMsg*) (curBuffer->data + curLength);
 
-                    // Message in many parts - merge & copy
+                    // Message in many parts - list of segments, buffers are released after confirmation
                 } else {
-                    msg->data = (uint8_t*)malloc(msg->length);
-                    if (msg->data == nullptr)
-                        throw RuntimeException("couldn't allocate " + std::to_string(msg->length) +
-                                               " bytes memory (for: temporary buffer for JSON message)");
-                    msg->flags |= OUTPUT_BUFFER_ALLOCATED;
-
-                    uint64_t copied = 0;
-                    while (msg->length - copied > 0) {
-                        uint64_t toCopy = msg->length - copied;
-                        if (toCopy > tmpLength - curLength) {
-                            toCopy = tmpLength - curLength;
-                            memcpy((void*)(msg->data + copied), (void*)(curBuffer->data + curLength), toCopy);
-                            curBuffer = curBuffer->next;
-                            tmpLength = OUTPUT_BUFFER_DATA_SIZE;
+                    segments.clear();
+                    uint64_t remaining = msg->length;
+                    while (remaining > 0) {
+                        uint64_t part = tmpLength - curLength;
+                        if (part > remaining)
+                            part = remaining;
+                        if (part > 0)
+                            segments.push_back({(void*)(curBuffer->data + curLength), part});
+                        remaining -= part;
+
+                        if (remaining > 0) {
+                            curBuffer = curBuffer->next.load(std::memory_order_acquire);
+                            tmpLength = curBuffer->length.load(std::memory_order_acquire);
                             curLength = 0;
-                        } else {
-                            memcpy((void*)(msg->data + copied), (void*)(curBuffer->data + curLength), toCopy);
-                            curLength += (toCopy + 7) & 0xFFFFFFFFFFFFFFF8;
+                        } else
+                            curLength += (part + 7) & 0xFFFFFFFFFFFFFFF8;
+                    }
+
+                    if (skip) {
+                        skipMessage(msg);
+                        pollQueue();
+                        writeCheckpoint(false);
+                        break;
+                    } else if (scatterGather) {
+                        msg->flags |= OUTPUT_BUFFER_SEGMENTED;
+                    } else {
+                        // Writer needs one contiguous block
+                        msg->data = (uint8_t*)malloc(msg->length);
+                        if (msg->data == nullptr)
+                            throw RuntimeException("couldn't allocate " + std::to_string(msg->length) +
+                                                   " bytes memory (for: temporary buffer for JSON message)");
+                        msg->flags |= OUTPUT_BUFFER_ALLOCATED;
+
+                        uint64_t copied = 0;
+                        for (struct iovec& segment : segments) {
+                            memcpy((void*)(msg->data + copied), segment.iov_base, segment.iov_len);
+                            copied += segment.iov_len;
                         }
-                        copied += toCopy;
                     }
 
-                    createMessage(msg);
+                    createMessage();
                     sendMessage(msg);
                     pollQueue();
                     writeCheckpoint(false);
@@ -293,12 +390,25 @@ namespace OpenLogReplicator {
             }
         }
 
+        flush();
         writeCheckpoint(true);
     }
 
+    void Writer::flush() {
+    }
+
+    void Writer::purgeQueue() {
+    }
+
     void Writer::writeCheckpoint(bool force) {
+        // Skipped messages don't move the checkpoint back
+        typeScn scn = confirmedScn;
+        if (scn == ZERO_SCN || (skipScn != ZERO_SCN && scn < skipScn))
+            scn = skipScn;
+        bool detached = (reader != nullptr && reader->state != BUILDER_READER_ACTIVE);
+
         // Nothing changed
-        if (checkpointScn == confirmedScn || confirmedScn == ZERO_SCN)
+        if (scn == ZERO_SCN || (checkpointScn == scn && checkpointDetached == detached))
             return;
 
         // Not yet
@@ -307,29 +417,33 @@ namespace OpenLogReplicator {
         if (timeSinceCheckpoint < ctx->checkpointIntervalS && !force)
             return;
 
-        TRACE(TRACE2_CHECKPOINT, "CHECKPOINT: writer checkpoint scn: " << std::dec << checkpointScn << " confirmed scn: " << confirmedScn)
-        std::string name(database + "-chkpt");
+        TRACE(TRACE2_CHECKPOINT, "CHECKPOINT: writer checkpoint scn: " << std::dec << checkpointScn << " confirmed scn: " << scn)
         std::stringstream ss;
         ss << R"({"database":")" << database
-                << R"(","scn":)" << std::dec << confirmedScn
+                << R"(","scn":)" << std::dec << scn
                 << R"(,"resetlogs":)" << std::dec << metadata->resetlogs
-                << R"(,"activation":)" << std::dec << metadata->activation << "}";
-
-        if (metadata->stateWrite(name, ss)) {
-            checkpointScn = confirmedScn;
+                << R"(,"activation":)" << std::dec << metadata->activation;
+        // Detached writer is left out of the restart position
+        if (detached)
+            ss << R"(,"detached":1)";
+        ss << "}";
+
+        if (metadata->stateWrite(checkpointName, ss)) {
+            checkpointScn = scn;
+            checkpointDetached = detached;
             checkpointTime = now;
         }
     }
 
     void Writer::readCheckpoint() {
         std::ifstream infile;
-        std::string name(database + "-chkpt");
+        std::string& name = checkpointName;
 
         // Checkpoint is present - read it
         std::string checkpoint;
         rapidjson::Document document;
         if (!metadata->stateRead(name, CHECKPOINT_FILE_MAX_SIZE, checkpoint)) {
-            metadata->setStatusReplicate();
+            metadata->setStatusReplicateWriter(ZERO_SCN);
             return;
         }
 
@@ -345,13 +459,21 @@ namespace OpenLogReplicator {
         metadata->setActivation(Ctx::getJsonFieldU32(name, document, "activation"));
 
         // Started earlier - continue work & ignore default startup parameters
-        metadata->startScn = Ctx::getJsonFieldU64(name, document, "scn");
-        metadata->startSequence = ZERO_SEQ;
-        metadata->startTime.clear();
-        metadata->startTimeRel = 0;
-        INFO("checkpoint - reading scn: " << std::dec << metadata->startScn)
+        typeScn scn = Ctx::getJsonFieldU64(name, document, "scn");
+        INFO("checkpoint - reading scn: " << std::dec << scn)
+        skipScn = scn;
+        checkpointScn = scn;
+        checkpointDetached = false;
+
+        if (document.HasMember("detached") && Ctx::getJsonFieldU64(name, document, "detached") == 1) {
+            checkpointDetached = true;
+            WARNING("checkpoint - writer " << getName() << " was detached at scn: " << std::dec << scn <<
+                    ", replication restarts from checkpoint of other writers, messages between are lost for this writer")
+            metadata->setStatusReplicateWriter(ZERO_SCN);
+            return;
+        }
 
-        metadata->setStatusReplicate();
+        metadata->setStatusReplicateWriter(scn);
     }
 
     void Writer::wakeUp() {
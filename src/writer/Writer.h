@@ -17,14 +17,21 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <sys/uio.h>
+#include <vector>
+
 #include "../common/Thread.h"
 
 #ifndef WRITER_H_
 #define WRITER_H_
 
+#define WRITER_SHARD_KEY_TABLE              0
+#define WRITER_SHARD_KEY_PRIMARY_KEY        1
+
 namespace OpenLogReplicator {
     class Builder;
     struct BuilderMsg;
+    struct BuilderReader;
     class Metadata;
 
     class Writer : public Thread {
@@ -34,29 +41,54 @@ namespace OpenLogReplicator {
         Metadata* metadata;
         typeScn checkpointScn;
         time_t checkpointTime;
+        bool checkpointDetached;
+        // Messages up to this scn were confirmed by this writer before restart
+        typeScn skipScn;
         typeScn confirmedScn;
         uint64_t confirmedMessages;
         uint64_t sentMessages;
         uint64_t tmpQueueSize;
         uint64_t maxQueueSize;
-        BuilderMsg** queue;
+        // Ring of sent messages in order of sending, confirmed ones are marked in bitmap
+        BuilderMsg* queue;
+        uint64_t* queueConfirmed;
+        uint64_t queueFirst;
+        BuilderReader* reader;
+        uint64_t maxLagMb;
+        uint64_t shard;
+        uint64_t shards;
+        uint64_t shardKey;
+        std::string checkpointName;
         bool streaming;
+        // Writer accepts messages spanning many buffers as list of segments
+        bool scatterGather;
+        std::vector<struct iovec> segments;
 
-        void createMessage(BuilderMsg* msg);
+        void createMessage();
         virtual void sendMessage(BuilderMsg* msg) = 0;
         virtual std::string getName() const = 0;
         virtual void pollQueue() = 0;
+        virtual void flush();
+        // Output forgets messages not confirmed yet, they don't reference the buffers afterwards
+        virtual void purgeQueue();
         void run() override;
         void mainLoop();
         virtual void writeCheckpoint(bool force);
         virtual void readCheckpoint();
-        void sortQueue();
+        void resetQueue();
+        BuilderMsg* queueMessage(BuilderMsg* msg);
+        bool detach();
+        [[nodiscard]] bool shardMatch(BuilderMsg* msg) const;
+        [[nodiscard]] bool checkpointMatch(BuilderMsg* msg) const;
+        void skipMessage(BuilderMsg* msg);
 
     public:
         Writer(Ctx* newCtx, std::string newAlias, std::string& newDatabase, Builder* newBuilder, Metadata* newMetadata);
         ~Writer() override;
 
         virtual void initialize();
+        void setMaxLagMb(uint64_t newMaxLagMb);
+        void setShard(uint64_t newShard, uint64_t newShards, uint64_t newShardKey);
         void confirmMessage(BuilderMsg* msg);
         void wakeUp() override;
     };
@@ -20,19 +20,25 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 #define _LARGEFILE_SOURCE
 #define _FILE_OFFSET_BITS 64
 
+#include <climits>
 #include <cstring>
 #include <dirent.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "../builder/Builder.h"
 #include "../common/RuntimeException.h"
+#include "../common/Timer.h"
 #include "WriterFile.h"
+#include "WriterFileCompressor.h"
 
 namespace OpenLogReplicator {
     WriterFile::WriterFile(Ctx* newCtx, std::string newAlias, std::string& newDatabase, Builder* newBuilder, Metadata* newMetadata, const char* newOutput,
-                           const char* newFormat, uint64_t newMaxSize, uint64_t newNewLine, uint64_t newAppend) :
+                           const char* newFormat, uint64_t newMaxSize, uint64_t newNewLine, uint64_t newAppend, uint64_t newFsync,
+                           uint64_t newFsyncIntervalMs, uint64_t newCompression, uint64_t newCompressionLevel, uint64_t newMaxSizeCompressed,
+                           uint64_t newStatsIntervalS) :
         Writer(newCtx, newAlias, newDatabase, newBuilder, newMetadata),
         prefixPos(0),
         suffixPos(0),
@@ -48,11 +54,51 @@ namespace OpenLogReplicator {
         append(newAppend),
         lastSequence(ZERO_SEQ),
         newLineMsg(nullptr),
-        warningDisplayed(false) {
+        warningDisplayed(false),
+        batchBytes(0),
+        batchTime(0),
+        fsync(newFsync),
+        fsyncIntervalUs(newFsyncIntervalMs * 1000),
+        syncTime(0),
+        syncBytes(0),
+        statSyncs(0),
+        statSyncTimeUs(0),
+        statSyncMaxUs(0),
+        statSyncMessages(0),
+        statSyncBytes(0),
+        statsIntervalS(newStatsIntervalS),
+        statsTime(time(nullptr)),
+        compression(newCompression),
+        compressionLevel(newCompressionLevel),
+        maxSizeCompressed(newMaxSizeCompressed),
+        compressor(nullptr),
+        jobsConfirmed(0),
+        batchMsgsQueued(0) {
+        scatterGather = true;
     }
 
     WriterFile::~WriterFile() {
         closeFile();
+
+        if (compressor != nullptr) {
+            delete compressor;
+            compressor = nullptr;
+        }
+    }
+
+    void WriterFile::run() {
+        Writer::run();
+
+        // Last frame is closed before the compressor is stopped
+        if (compressor != nullptr) {
+            try {
+                closeFile();
+            } catch (RuntimeException& ex) {
+                ERROR(ex.msg)
+            }
+            compressor->stop();
+            ctx->finishThread(compressor);
+        }
     }
 
     void WriterFile::initialize() {
@@ -64,8 +110,15 @@ namespace OpenLogReplicator {
             newLineMsg = "\r\n";
         }
 
+        if (compression != WRITER_FILE_COMPRESSION_NONE) {
+            compressor = new WriterFileCompressor(ctx, alias + "-compressor", compression, compressionLevel);
+            ctx->spawnThread(compressor);
+        }
+
         if (this->output.length() == 0) {
             outputDes = STDOUT_FILENO;
+            if (compressor != nullptr)
+                compressor->open(outputDes, "stdout", 0);
             return;
         }
 
@@ -188,6 +241,17 @@ namespace OpenLogReplicator {
     }
 
     void WriterFile::closeFile() {
+        if (compressor != nullptr && outputDes != -1) {
+            compressor->finish();
+            if (compressor->getInputSize() > 0) {
+                INFO("compressed " << outputFile << ": " << std::dec << compressor->getInputSize() << " bytes to " <<
+                     compressor->getOutputSize() << " bytes")
+            }
+        }
+
+        if (statSyncs > 0)
+            logStats();
+
         if (outputDes != -1) {
             close(outputDes);
             outputDes = -1;
@@ -199,8 +263,16 @@ namespace OpenLogReplicator {
             return;
         } else if (mode == WRITER_FILE_MODE_NO_ROTATE) {
             outputFile = outputPath + "/" + outputFileMask;
-        } else if (mode == WRITER_FILE_MODE_NUM) {
-            if (outputSize + length > maxSize) {
+        }
+
+        // Compressed size is known only for batches already written
+        uint64_t fileSize = outputSize + length;
+        if (compressor != nullptr && maxSizeCompressed > 0)
+            fileSize = compressor->getOutputSize();
+
+        if (mode == WRITER_FILE_MODE_NUM) {
+            if (fileSize > maxSize) {
+                flush();
                 closeFile();
                 ++outputFileNum;
                 outputSize = 0;
@@ -218,7 +290,7 @@ namespace OpenLogReplicator {
             }
         } else if (mode == WRITER_FILE_MODE_TIMESTAMP) {
             bool shouldSwitch = false;
-            if (outputSize + length > maxSize)
+            if (fileSize > maxSize)
                 shouldSwitch = true;
 
             if (length > maxSize) {
@@ -242,11 +314,13 @@ namespace OpenLogReplicator {
             }
 
             if (shouldSwitch) {
+                flush();
                 closeFile();
                 outputSize = 0;
             }
         } else if (mode == WRITER_FILE_MODE_SEQUENCE) {
             if (sequence != lastSequence) {
+                flush();
                 closeFile();
             }
 
@@ -274,30 +348,132 @@ namespace OpenLogReplicator {
 
             if (statRet == 0)
                 outputSize = fileStat.st_size;
-            else
+            else {
                 outputSize = 0;
+                // New directory entry must be durable before messages written to the file are confirmed
+                if (fsync > 0)
+                    syncDirectory();
+            }
+
+            if (compressor != nullptr)
+                compressor->open(outputDes, outputFile, outputSize);
         }
     }
 
+    // Messages are collected and written with one writev, buffers are held until confirmed after the write
     void WriterFile::sendMessage(BuilderMsg* msg) {
-        if (newLine > 0)
-            checkFile(msg->scn, msg->sequence, msg->length + 1);
+        // File may be switched only between batches
+        checkFile(msg->scn, msg->sequence, msg->length + newLine);
+
+        if (batch.empty())
+            batchTime = Timer::getTime();
+        if (batchMsgs.empty())
+            syncTime = Timer::getTime();
+
+        if ((msg->flags & OUTPUT_BUFFER_SEGMENTED) != 0)
+            batch.insert(batch.end(), segments.begin(), segments.end());
         else
-            checkFile(msg->scn, msg->sequence, msg->length);
+            batch.push_back({(void*)msg->data, msg->length});
+        if (newLine > 0)
+            batch.push_back({(void*)newLineMsg, newLine});
+
+        batchMsgs.push_back(msg);
+        batchBytes += msg->length + newLine;
+        outputSize += msg->length + newLine;
+
+        if (batchBytes >= WRITER_FILE_BATCH_BYTES || batch.size() >= IOV_MAX || tmpQueueSize >= ctx->queueSize ||
+                Timer::getTime() - batchTime >= WRITER_FILE_BATCH_US) {
+            writeBatch();
+            // Group commit: many batches may share one sync
+            if (tmpQueueSize >= ctx->queueSize || (fsync > 0 && (uint64_t)(Timer::getTime() - syncTime) >= fsyncIntervalUs) ||
+                    (fsync == 0 && compressor == nullptr))
+                flush();
+            else if (fsync == 0)
+                confirmCompressed();
+        }
+    }
 
-        int64_t bytesWritten = write(outputDes, (const char*)msg->data, msg->length);
-        if ((uint64_t)bytesWritten != msg->length)
-            throw RuntimeException("writing file: " + outputFile + " - " + strerror(errno));
-        outputSize += bytesWritten;
+    void WriterFile::writeBatch() {
+        if (batch.empty())
+            return;
 
-        if (newLine > 0) {
-            bytesWritten = write(outputDes, newLineMsg, newLine);
-            if ((uint64_t)bytesWritten != newLine)
-                throw RuntimeException("writing file: " + outputFile + " - " + strerror(errno));
-            outputSize += bytesWritten;
+        if (compressor != nullptr) {
+            compressor->compress(batch);
+            jobMsgs.push_back(batchMsgs.size() - batchMsgsQueued);
+            batchMsgsQueued = batchMsgs.size();
+        } else
+            writeVector(batch.data(), batch.size());
+        batch.clear();
+        syncBytes += batchBytes;
+        batchBytes = 0;
+    }
+
+    // Messages are confirmed when written, or after the data is synced in fsync mode
+    void WriterFile::flush() {
+        writeBatch();
+        if (batchMsgs.empty())
+            return;
+
+        if (compressor != nullptr) {
+            compressor->drain();
+            jobMsgs.clear();
+            jobsConfirmed = compressor->getJobsDone();
+            batchMsgsQueued = 0;
+        }
+
+        if (fsync > 0) {
+            time_t start = Timer::getTime();
+            if (fdatasync(outputDes) != 0)
+                throw RuntimeException("syncing file: " + outputFile + " - " + strerror(errno));
+            time_t syncUs = Timer::getTime() - start;
+
+            ++statSyncs;
+            statSyncTimeUs += syncUs;
+            if ((uint64_t)syncUs > statSyncMaxUs)
+                statSyncMaxUs = syncUs;
+            statSyncMessages += batchMsgs.size();
+            statSyncBytes += syncBytes;
         }
+        syncBytes = 0;
+
+        for (BuilderMsg* msg : batchMsgs)
+            confirmMessage(msg);
+        batchMsgs.clear();
+    }
+
+    void WriterFile::confirmCompressed() {
+        uint64_t jobsDone = compressor->getJobsDone();
+        while (jobsConfirmed < jobsDone) {
+            for (uint64_t i = jobMsgs.front(); i > 0; --i) {
+                confirmMessage(batchMsgs.front());
+                batchMsgs.pop_front();
+            }
+            batchMsgsQueued -= jobMsgs.front();
+            jobMsgs.pop_front();
+            ++jobsConfirmed;
+        }
+    }
 
-        confirmMessage(msg);
+    void WriterFile::writeVector(struct iovec* iov, uint64_t count) {
+        while (count > 0) {
+            int64_t bytesWritten = writev(outputDes, iov, (count > IOV_MAX) ? IOV_MAX : (int)count);
+            if (bytesWritten < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw RuntimeException("writing file: " + outputFile + " - " + strerror(errno));
+            }
+
+            // Partial write - skip written segments
+            while (count > 0 && (uint64_t)bytesWritten >= iov->iov_len) {
+                bytesWritten -= iov->iov_len;
+                ++iov;
+                --count;
+            }
+            if (bytesWritten > 0) {
+                iov->iov_base = (void*)((char*)iov->iov_base + bytesWritten);
+                iov->iov_len -= bytesWritten;
+            }
+        }
     }
 
     std::string WriterFile::getName() const {
@@ -307,6 +483,33 @@ namespace OpenLogReplicator {
             return "file:" + outputPath + "/" + outputFileMask;
     }
 
+    void WriterFile::syncDirectory() {
+        int dirDes = open(outputPath.c_str(), O_RDONLY | O_DIRECTORY);
+        if (dirDes == -1)
+            throw RuntimeException("opening directory: " + outputPath + " - " + strerror(errno));
+        if (::fsync(dirDes) != 0) {
+            close(dirDes);
+            throw RuntimeException("syncing directory: " + outputPath + " - " + strerror(errno));
+        }
+        close(dirDes);
+    }
+
+    void WriterFile::logStats() {
+        if (statSyncs > 0) {
+            INFO("fsync of " << outputFile << ": " << std::dec << statSyncs << " syncs, latency avg: " << (statSyncTimeUs / statSyncs) <<
+                 "us, max: " << statSyncMaxUs << "us, per sync avg: " << (statSyncMessages / statSyncs) << " messages, " <<
+                 (statSyncBytes / statSyncs) << " bytes")
+            statSyncs = 0;
+            statSyncTimeUs = 0;
+            statSyncMaxUs = 0;
+            statSyncMessages = 0;
+            statSyncBytes = 0;
+        }
+        statsTime = time(nullptr);
+    }
+
     void WriterFile::pollQueue() {
+        if (statsIntervalS > 0 && (uint64_t)(time(nullptr) - statsTime) >= statsIntervalS)
+            logStats();
     }
 }
@@ -17,6 +17,8 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <deque>
+
 #include "Writer.h"
 
 #ifndef WRITER_FILE_H_
@@ -28,7 +30,12 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 #define WRITER_FILE_MODE_TIMESTAMP          3
 #define WRITER_FILE_MODE_SEQUENCE           4
 
+#define WRITER_FILE_BATCH_BYTES             (1024 * 1024)
+#define WRITER_FILE_BATCH_US                10000
+
 namespace OpenLogReplicator {
+    class WriterFileCompressor;
+
     class WriterFile : public Writer {
     protected:
         size_t prefixPos;
@@ -49,15 +56,49 @@ namespace OpenLogReplicator {
         typeSeq lastSequence;
         const char* newLineMsg;
         bool warningDisplayed;
+        // Messages collected but not yet written
+        std::vector<struct iovec> batch;
+        std::deque<BuilderMsg*> batchMsgs;
+        uint64_t batchBytes;
+        time_t batchTime;
+        // Durable output, messages are confirmed after fdatasync
+        uint64_t fsync;
+        uint64_t fsyncIntervalUs;
+        time_t syncTime;
+        uint64_t syncBytes;
+        uint64_t statSyncs;
+        uint64_t statSyncTimeUs;
+        uint64_t statSyncMaxUs;
+        uint64_t statSyncMessages;
+        uint64_t statSyncBytes;
+        uint64_t statsIntervalS;
+        time_t statsTime;
+        // Compression on helper thread, messages are confirmed when their batch is written
+        uint64_t compression;
+        uint64_t compressionLevel;
+        uint64_t maxSizeCompressed;
+        WriterFileCompressor* compressor;
+        std::deque<uint64_t> jobMsgs;
+        uint64_t jobsConfirmed;
+        uint64_t batchMsgsQueued;
         void closeFile();
         void checkFile(typeScn scn, typeSeq sequence, uint64_t length);
+        void writeVector(struct iovec* iov, uint64_t count);
+        void writeBatch();
+        void confirmCompressed();
+        void syncDirectory();
+        void logStats();
         void sendMessage(BuilderMsg* msg) override;
+        void flush() override;
         std::string getName() const override;
         void pollQueue() override;
+        void run() override;
 
     public:
         WriterFile(Ctx* newCtx, std::string newAlias, std::string& newDatabase, Builder* newBuilder, Metadata* newMetadata, const char* newOutput,
-                   const char* newFormat, uint64_t newMaxSize, uint64_t newNewLine, uint64_t newAppend);
+                   const char* newFormat, uint64_t newMaxSize, uint64_t newNewLine, uint64_t newAppend, uint64_t newFsync,
+                   uint64_t newFsyncIntervalMs, uint64_t newCompression, uint64_t newCompressionLevel, uint64_t newMaxSizeCompressed,
+                   uint64_t newStatsIntervalS);
         ~WriterFile() override;
 
         void initialize() override;
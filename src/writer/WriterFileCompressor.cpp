@@ -0,0 +1,263 @@
+/* Thread compressing output of file writer
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+
+#include "../common/Ctx.h"
+#include "../common/RuntimeException.h"
+#include "WriterFileCompressor.h"
+
+namespace OpenLogReplicator {
+    WriterFileCompressor::WriterFileCompressor(Ctx* newCtx, std::string newAlias, uint64_t newType, uint64_t newLevel) :
+            Thread(newCtx, newAlias),
+            type(newType),
+            level(newLevel),
+            stopping(false),
+            stopped(false),
+            jobsDone(0),
+            inputSize(0),
+            outputSize(0),
+            outputDes(-1),
+            frameData(false),
+            buffer(nullptr) {
+        buffer = new uint8_t[WRITER_FILE_COMPRESSOR_BUFFER];
+
+        if (type == WRITER_FILE_COMPRESSION_GZIP) {
+#ifdef LINK_LIBRARY_ZLIB
+            memset((void*)&zStream, 0, sizeof(zStream));
+            // Window bits + 16 for gzip header and trailer
+            if (deflateInit2(&zStream, level == 0 ? Z_DEFAULT_COMPRESSION : (int)level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+                throw RuntimeException("initializing gzip compression failed");
+#else
+            throw RuntimeException("gzip compression is not compiled, exiting");
+#endif /* LINK_LIBRARY_ZLIB */
+        } else if (type == WRITER_FILE_COMPRESSION_ZSTD) {
+#ifdef LINK_LIBRARY_ZSTD
+            zstdCtx = ZSTD_createCCtx();
+            if (zstdCtx == nullptr)
+                throw RuntimeException("initializing zstd compression failed");
+            if (level > 0 && ZSTD_isError(ZSTD_CCtx_setParameter(zstdCtx, ZSTD_c_compressionLevel, (int)level)))
+                throw RuntimeException("invalid zstd compression level: " + std::to_string(level));
+#else
+            throw RuntimeException("zstd compression is not compiled, exiting");
+#endif /* LINK_LIBRARY_ZSTD */
+        }
+    }
+
+    WriterFileCompressor::~WriterFileCompressor() {
+#ifdef LINK_LIBRARY_ZLIB
+        if (type == WRITER_FILE_COMPRESSION_GZIP)
+            deflateEnd(&zStream);
+#endif /* LINK_LIBRARY_ZLIB */
+#ifdef LINK_LIBRARY_ZSTD
+        if (type == WRITER_FILE_COMPRESSION_ZSTD)
+            ZSTD_freeCCtx(zstdCtx);
+#endif /* LINK_LIBRARY_ZSTD */
+
+        if (buffer != nullptr) {
+            delete[] buffer;
+            buffer = nullptr;
+        }
+    }
+
+    void WriterFileCompressor::wakeUp() {
+        std::unique_lock<std::mutex> lck(mtx);
+        condJob.notify_all();
+        condDone.notify_all();
+    }
+
+    // Called by the writer when no job is pending, every file starts a new frame
+    void WriterFileCompressor::open(int newOutputDes, const std::string& newOutputFile, uint64_t newOutputSize) {
+        std::unique_lock<std::mutex> lck(mtx);
+        outputDes = newOutputDes;
+        outputFile = newOutputFile;
+        inputSize = 0;
+        outputSize = newOutputSize;
+        frameData = false;
+    }
+
+    void WriterFileCompressor::compress(const std::vector<struct iovec>& iov) {
+        std::unique_lock<std::mutex> lck(mtx);
+        while (jobs.size() >= WRITER_FILE_COMPRESSOR_JOBS && !stopped)
+            condDone.wait(lck);
+        if (stopped)
+            throw RuntimeException("compressing file: " + outputFile + " - " + (error.empty() ? "compression stopped" : error));
+
+        jobs.push_back({iov, false});
+        frameData = true;
+        condJob.notify_all();
+    }
+
+    void WriterFileCompressor::drain() {
+        std::unique_lock<std::mutex> lck(mtx);
+        while (!jobs.empty() && !stopped)
+            condDone.wait(lck);
+        if (!jobs.empty())
+            throw RuntimeException("compressing file: " + outputFile + " - " + (error.empty() ? "compression stopped" : error));
+    }
+
+    // Close the frame so that the file is complete
+    void WriterFileCompressor::finish() {
+        {
+            std::unique_lock<std::mutex> lck(mtx);
+            if (!frameData || stopped)
+                return;
+
+            jobs.push_back({std::vector<struct iovec>(), true});
+            frameData = false;
+            condJob.notify_all();
+        }
+        drain();
+    }
+
+    void WriterFileCompressor::stop() {
+        std::unique_lock<std::mutex> lck(mtx);
+        stopping = true;
+        condJob.notify_all();
+    }
+
+    void WriterFileCompressor::writeBuffer(uint64_t length) {
+        uint8_t* data = buffer;
+        while (length > 0) {
+            int64_t bytesWritten = write(outputDes, data, length);
+            if (bytesWritten < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw RuntimeException("writing file: " + outputFile + " - " + strerror(errno));
+            }
+            data += bytesWritten;
+            length -= bytesWritten;
+            outputSize.store(outputSize.load(std::memory_order_relaxed) + bytesWritten, std::memory_order_relaxed);
+        }
+    }
+
+    // Every batch is flushed to the file before it is reported as done
+    void WriterFileCompressor::compressJob(WriterFileJob& job) {
+        uint64_t length = 0;
+        for (struct iovec& iov : job.iov)
+            length += iov.iov_len;
+
+#ifdef LINK_LIBRARY_ZLIB
+        if (type == WRITER_FILE_COMPRESSION_GZIP) {
+            for (struct iovec& iov : job.iov) {
+                zStream.next_in = (Bytef*)iov.iov_base;
+                zStream.avail_in = iov.iov_len;
+                while (zStream.avail_in > 0) {
+                    zStream.next_out = buffer;
+                    zStream.avail_out = WRITER_FILE_COMPRESSOR_BUFFER;
+                    if (deflate(&zStream, Z_NO_FLUSH) == Z_STREAM_ERROR)
+                        throw RuntimeException("gzip compression failed");
+                    writeBuffer(WRITER_FILE_COMPRESSOR_BUFFER - zStream.avail_out);
+                }
+            }
+
+            int flush = job.end ? Z_FINISH : Z_SYNC_FLUSH;
+            for (;;) {
+                zStream.next_out = buffer;
+                zStream.avail_out = WRITER_FILE_COMPRESSOR_BUFFER;
+                int ret = deflate(&zStream, flush);
+                if (ret == Z_STREAM_ERROR)
+                    throw RuntimeException("gzip compression failed");
+                writeBuffer(WRITER_FILE_COMPRESSOR_BUFFER - zStream.avail_out);
+                if (job.end ? (ret == Z_STREAM_END) : (zStream.avail_out > 0))
+                    break;
+            }
+            if (job.end)
+                deflateReset(&zStream);
+        }
+#endif /* LINK_LIBRARY_ZLIB */
+
+#ifdef LINK_LIBRARY_ZSTD
+        if (type == WRITER_FILE_COMPRESSION_ZSTD) {
+            ZSTD_outBuffer out;
+            for (struct iovec& iov : job.iov) {
+                ZSTD_inBuffer in = {iov.iov_base, iov.iov_len, 0};
+                while (in.pos < in.size) {
+                    out = {buffer, WRITER_FILE_COMPRESSOR_BUFFER, 0};
+                    size_t ret = ZSTD_compressStream2(zstdCtx, &out, &in, ZSTD_e_continue);
+                    if (ZSTD_isError(ret))
+                        throw RuntimeException(std::string("zstd compression failed: ") + ZSTD_getErrorName(ret));
+                    writeBuffer(out.pos);
+                }
+            }
+
+            ZSTD_inBuffer empty = {nullptr, 0, 0};
+            size_t remaining;
+            do {
+                out = {buffer, WRITER_FILE_COMPRESSOR_BUFFER, 0};
+                remaining = ZSTD_compressStream2(zstdCtx, &out, &empty, job.end ? ZSTD_e_end : ZSTD_e_flush);
+                if (ZSTD_isError(remaining))
+                    throw RuntimeException(std::string("zstd compression failed: ") + ZSTD_getErrorName(remaining));
+                writeBuffer(out.pos);
+            } while (remaining > 0);
+        }
+#endif /* LINK_LIBRARY_ZSTD */
+
+        inputSize.store(inputSize.load(std::memory_order_relaxed) + length, std::memory_order_relaxed);
+    }
+
+    void WriterFileCompressor::run() {
+        TRACE(TRACE2_THREADS, "THREADS: COMPRESSOR (" << std::hex << std::this_thread::get_id() << ") START")
+
+        try {
+            while (!ctx->hardShutdown) {
+                WriterFileJob* job;
+                {
+                    std::unique_lock<std::mutex> lck(mtx);
+                    if (jobs.empty()) {
+                        if (stopping)
+                            break;
+                        condJob.wait_for(lck, std::chrono::milliseconds(100));
+                        continue;
+                    }
+                    // The writer only appends, reference to the front stays valid
+                    job = &jobs.front();
+                }
+
+                compressJob(*job);
+
+                {
+                    std::unique_lock<std::mutex> lck(mtx);
+                    if (!job->end)
+                        jobsDone.store(jobsDone.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+                    jobs.pop_front();
+                    condDone.notify_all();
+                }
+            }
+        } catch (RuntimeException& ex) {
+            ERROR(ex.msg)
+            {
+                std::unique_lock<std::mutex> lck(mtx);
+                error = ex.msg;
+            }
+            ctx->stopHard();
+        }
+
+        {
+            std::unique_lock<std::mutex> lck(mtx);
+            stopped = true;
+            condDone.notify_all();
+        }
+
+        TRACE(TRACE2_THREADS, "THREADS: COMPRESSOR (" << std::hex << std::this_thread::get_id() << ") STOP")
+    }
+}
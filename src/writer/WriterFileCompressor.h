@@ -0,0 +1,107 @@
+/* Header for WriterFileCompressor class
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <sys/uio.h>
+#include <vector>
+
+#ifdef LINK_LIBRARY_ZLIB
+#include <zlib.h>
+#endif /* LINK_LIBRARY_ZLIB */
+#ifdef LINK_LIBRARY_ZSTD
+#include <zstd.h>
+#endif /* LINK_LIBRARY_ZSTD */
+
+#include "../common/Thread.h"
+
+#ifndef WRITER_FILE_COMPRESSOR_H_
+#define WRITER_FILE_COMPRESSOR_H_
+
+#define WRITER_FILE_COMPRESSION_NONE        0
+#define WRITER_FILE_COMPRESSION_GZIP        1
+#define WRITER_FILE_COMPRESSION_ZSTD        2
+
+#define WRITER_FILE_COMPRESSOR_JOBS         4
+#define WRITER_FILE_COMPRESSOR_BUFFER       (256 * 1024)
+
+namespace OpenLogReplicator {
+    // Batch of written messages, job with end flag closes the frame
+    struct WriterFileJob {
+        std::vector<struct iovec> iov;
+        bool end;
+    };
+
+    class WriterFileCompressor : public Thread {
+    protected:
+        uint64_t type;
+        uint64_t level;
+        std::mutex mtx;
+        std::condition_variable condJob;
+        std::condition_variable condDone;
+        std::deque<WriterFileJob> jobs;
+        bool stopping;
+        bool stopped;
+        std::string error;
+        std::atomic<uint64_t> jobsDone;
+        std::atomic<uint64_t> inputSize;
+        std::atomic<uint64_t> outputSize;
+        int outputDes;
+        std::string outputFile;
+        bool frameData;
+        uint8_t* buffer;
+#ifdef LINK_LIBRARY_ZLIB
+        z_stream zStream;
+#endif /* LINK_LIBRARY_ZLIB */
+#ifdef LINK_LIBRARY_ZSTD
+        ZSTD_CCtx* zstdCtx;
+#endif /* LINK_LIBRARY_ZSTD */
+
+        void writeBuffer(uint64_t length);
+        void compressJob(WriterFileJob& job);
+        void run() override;
+
+    public:
+        WriterFileCompressor(Ctx* newCtx, std::string newAlias, uint64_t newType, uint64_t newLevel);
+        ~WriterFileCompressor() override;
+
+        void wakeUp() override;
+        void open(int newOutputDes, const std::string& newOutputFile, uint64_t newOutputSize);
+        void compress(const std::vector<struct iovec>& iov);
+        void drain();
+        void finish();
+        void stop();
+
+        uint64_t getJobsDone() const {
+            return jobsDone.load(std::memory_order_acquire);
+        }
+
+        uint64_t getInputSize() const {
+            return inputSize.load(std::memory_order_relaxed);
+        }
+
+        uint64_t getOutputSize() const {
+            return outputSize.load(std::memory_order_relaxed);
+        }
+    };
+}
+
+#endif
@@ -17,24 +17,50 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <cctype>
+#include <unistd.h>
+
 #include "../builder/Builder.h"
 #include "../common/ConfigurationException.h"
+#include "../common/RuntimeException.h"
 #include "WriterKafka.h"
+#include "WriterKafkaPoller.h"
 
 namespace OpenLogReplicator {
     WriterKafka::WriterKafka(Ctx* newCtx, std::string newAlias, std::string& newDatabase, Builder* newBuilder, Metadata* newMetadata, const char* newBrokers,
-                             const char* newTopic, uint64_t newMaxMessages, bool newEnableIdempotence) :
+                             const char* newTopic, const char* newTableTopic, uint64_t newMaxMessages, bool newEnableIdempotence,
+                             std::map<std::string, std::string>& newProperties, uint64_t newMaxInflightMb, uint64_t newStatsIntervalS) :
         Writer(newCtx, newAlias, newDatabase, newBuilder, newMetadata),
         brokers(newBrokers),
         topic(newTopic),
+        tableTopic(newTableTopic),
         maxMessages(newMaxMessages),
         enableIdempotence(newEnableIdempotence),
         rk(nullptr),
         rkt(nullptr),
-        conf(nullptr) {
+        conf(nullptr),
+        properties(newProperties),
+        maxInflightBytes(newMaxInflightMb * 1024 * 1024),
+        statsIntervalS(newStatsIntervalS),
+        poller(nullptr),
+        inflightBytes(0),
+        statInflightBytesMax(0),
+        statDelivered(0),
+        statFailed(0),
+        statWaits(0),
+        statsTime(0),
+        failedErr(RD_KAFKA_RESP_ERR_NO_ERROR) {
+        memset((void*)statLatency, 0, sizeof(statLatency));
     }
 
     WriterKafka::~WriterKafka() {
+        if (poller != nullptr) {
+            poller->stop();
+            ctx->finishThread(poller);
+            delete poller;
+            poller = nullptr;
+        }
+
         if (conf != nullptr)
             rd_kafka_conf_destroy(conf);
 
@@ -66,6 +92,16 @@ namespace OpenLogReplicator {
             throw ConfigurationException(std::string("Kafka message: ") + errstr);
         }
 
+        // Retries of librdkafka may change order of messages unless idempotent producer is used
+        if (!enableIdempotence && rd_kafka_conf_set(conf, "max.in.flight.requests.per.connection", "1", errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK)
+            throw ConfigurationException(std::string("Kafka message: ") + errstr);
+
+        // Producer tuning from configuration overrides defaults
+        for (auto& property : properties) {
+            if (rd_kafka_conf_set(conf, property.first.c_str(), property.second.c_str(), errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK)
+                throw ConfigurationException("Kafka property: " + property.first + "=" + property.second + ", message: " + errstr);
+        }
+
         rd_kafka_conf_set_opaque(conf, this);
         rd_kafka_conf_set_dr_msg_cb(conf, dr_msg_cb);
         rd_kafka_conf_set_error_cb(conf, error_cb);
@@ -77,17 +113,46 @@ namespace OpenLogReplicator {
         conf = nullptr;
 
         rkt = rd_kafka_topic_new(rk, topic.c_str(), nullptr);
+        statsTime = time(nullptr);
+
+        poller = new WriterKafkaPoller(ctx, alias + "-poller", rk);
+        ctx->spawnThread(poller);
+    }
+
+    void WriterKafka::run() {
+        Writer::run();
+
+        if (poller != nullptr) {
+            poller->stop();
+            ctx->finishThread(poller);
+        }
+        logStats();
     }
 
-    void WriterKafka::dr_msg_cb(rd_kafka_t* rkCb __attribute__((unused)), const rd_kafka_message_t* rkmessage, void* opaque __attribute__((unused))) {
+    // Called on poller thread, messages are confirmed by the writer thread
+    void WriterKafka::dr_msg_cb(rd_kafka_t* rkCb __attribute__((unused)), const rd_kafka_message_t* rkmessage, void* opaque) {
         auto* msg = (BuilderMsg*) rkmessage->_private;
-        auto writer = (Writer*)opaque;
-        Ctx* ctx = writer->ctx;
+        auto writer = (WriterKafka*)opaque;
+
+        int64_t latencyUs = rd_kafka_message_latency(rkmessage);
+        uint64_t bucket = 0;
+        for (int64_t latencyMs = latencyUs / 1000; latencyMs > 0 && bucket < KAFKA_LATENCY_BUCKETS - 1; latencyMs >>= 1)
+            ++bucket;
+
+        std::unique_lock<std::mutex> lck(writer->mtxDelivery);
+        writer->inflightBytes -= rkmessage->len;
         if (rkmessage->err) {
-            WARNING("Kafka: " << msg->id << " delivery failed: " << rd_kafka_err2str(rkmessage->err))
+            writer->failed.push_back(msg);
+            ++writer->statFailed;
+            if (writer->failedErr == RD_KAFKA_RESP_ERR_NO_ERROR)
+                writer->failedErr = rkmessage->err;
         } else {
-            writer->confirmMessage(msg);
+            writer->delivered.push_back(msg);
+            ++writer->statDelivered;
+            if (latencyUs >= 0)
+                ++writer->statLatency[bucket];
         }
+        writer->condDelivery.notify_all();
     }
 
     void WriterKafka::error_cb(rd_kafka_t* rkCb, int err, const char* reason, void* opaque) {
@@ -112,29 +177,117 @@ namespace OpenLogReplicator {
         TRACE(TRACE2_WRITER, "WRITER: " << std::dec << level << ", rk: " << (rkCb ? rd_kafka_name(rkCb) : nullptr) << ", fac: " << fac << ", err: " << buf)
     }
 
+    // Topic of table messages: %o is replaced by owner, %t by table, characters not allowed in topic name by '_'
+    const char* WriterKafka::getTopic(BuilderMsg* msg) {
+        if (tableTopic.empty() || msg->tableLength == 0)
+            return topic.c_str();
+
+        topicBuffer.clear();
+        for (uint64_t i = 0; i < tableTopic.length(); ++i) {
+            const uint8_t* name = nullptr;
+            uint64_t length = 0;
+            if (tableTopic[i] == '%' && i + 1 < tableTopic.length() && tableTopic[i + 1] == 'o') {
+                name = msg->tag;
+                length = msg->ownerLength;
+            } else if (tableTopic[i] == '%' && i + 1 < tableTopic.length() && tableTopic[i + 1] == 't') {
+                name = msg->tag + msg->ownerLength;
+                length = msg->tableLength;
+            } else {
+                topicBuffer.push_back(tableTopic[i]);
+                continue;
+            }
+
+            for (uint64_t j = 0; j < length; ++j) {
+                if (isalnum(name[j]) || name[j] == '.' || name[j] == '_' || name[j] == '-')
+                    topicBuffer.push_back((char)name[j]);
+                else
+                    topicBuffer.push_back('_');
+            }
+            ++i;
+        }
+        return topicBuffer.c_str();
+    }
+
     void WriterKafka::sendMessage(BuilderMsg* msg) {
         msg->ptr = (void*)this;
-        for(;;) {
-            rd_kafka_resp_err_t err = rd_kafka_producev(rk, RD_KAFKA_V_TOPIC(topic.c_str()), RD_KAFKA_V_VALUE(msg->data, msg->length),
-                    RD_KAFKA_V_OPAQUE(msg), RD_KAFKA_V_END);
-            // rd_kafka_resp_err_t err = (rd_kafka_resp_err_t)rd_kafka_produce(rkt, RD_KAFKA_PARTITION_UA, 0, msg->decoder, msg->length, nullptr, 0, msg);
-
-            if (err) {
-                WARNING("Failed to produce to topic " << topic.c_str() << ", message: " << rd_kafka_err2str(err))
-
-                if (err == RD_KAFKA_RESP_ERR__QUEUE_FULL) {
-                    WARNING("Queue, full, sleeping " << (ctx->pollIntervalUs / 1000) << "ms, then retrying")
-                    rd_kafka_poll(rk, (int)(ctx->pollIntervalUs / 1000));
-                    continue;
-                } else {
-                    WARNING("OTHER ERROR?")
+        produce(msg);
+    }
+
+    // Producer is throttled by delivery reports: in-flight bytes limit and full producer queue wait for deliveries
+    void WriterKafka::produce(BuilderMsg* msg) {
+        const char* msgTopic = getTopic(msg);
+        // Key of the row keeps its changes in one partition
+        const uint8_t* key = (msg->keyLength > 0) ? msg->tag + msg->ownerLength + msg->tableLength : nullptr;
+
+        {
+            std::unique_lock<std::mutex> lck(mtxDelivery);
+            while (maxInflightBytes > 0 && inflightBytes > 0 && inflightBytes + msg->length > maxInflightBytes && !ctx->hardShutdown &&
+                    reader->state == BUILDER_READER_ACTIVE) {
+                ++statWaits;
+                condDelivery.wait_for(lck, std::chrono::microseconds(ctx->pollIntervalUs));
+            }
+            inflightBytes += msg->length;
+            if (inflightBytes > statInflightBytesMax)
+                statInflightBytesMax = inflightBytes;
+        }
+
+        while (!ctx->hardShutdown) {
+            rd_kafka_resp_err_t err = rd_kafka_producev(rk, RD_KAFKA_V_TOPIC(msgTopic), RD_KAFKA_V_VALUE(msg->data, msg->length),
+                    RD_KAFKA_V_KEY(key, msg->keyLength), RD_KAFKA_V_OPAQUE(msg), RD_KAFKA_V_END);
+            if (!err)
+                return;
+
+            if (err == RD_KAFKA_RESP_ERR__QUEUE_FULL) {
+                // Lagging writer doesn't wait for the stalled target, the message is dropped when detaching
+                if (reader->state != BUILDER_READER_ACTIVE)
                     break;
-                }
-            } else
-                break;
+                TRACE(TRACE2_WRITER, "WRITER: Kafka queue full, waiting for delivery reports")
+                std::unique_lock<std::mutex> lck(mtxDelivery);
+                ++statWaits;
+                condDelivery.wait_for(lck, std::chrono::microseconds(ctx->pollIntervalUs));
+                continue;
+            }
+
+            {
+                std::unique_lock<std::mutex> lck(mtxDelivery);
+                inflightBytes -= msg->length;
+            }
+            // Message would never be confirmed, replication stops and continues from checkpoint after restart
+            throw RuntimeException("Kafka: failed to produce message " + std::to_string(msg->id) + " to topic " + msgTopic + ", message: " +
+                                   rd_kafka_err2str(err));
         }
 
-        rd_kafka_poll(rk, 0);
+        std::unique_lock<std::mutex> lck(mtxDelivery);
+        inflightBytes -= msg->length;
+    }
+
+    // Queued and in-flight messages reference the buffers until their delivery reports, purged messages are reported as failed
+    void WriterKafka::purgeQueue() {
+        rd_kafka_purge(rk, RD_KAFKA_PURGE_F_QUEUE | RD_KAFKA_PURGE_F_INFLIGHT);
+        while (rd_kafka_outq_len(rk) > 0 && !ctx->hardShutdown)
+            usleep(ctx->pollIntervalUs);
+
+        std::unique_lock<std::mutex> lck(mtxDelivery);
+        delivered.clear();
+        failed.clear();
+        failedErr = RD_KAFKA_RESP_ERR_NO_ERROR;
+    }
+
+    void WriterKafka::logStats() {
+        std::stringstream ss;
+        {
+            std::unique_lock<std::mutex> lck(mtxDelivery);
+            ss << "Kafka " << topic << ": delivered: " << std::dec << statDelivered << ", failed: " << statFailed << ", waits: " << statWaits <<
+                  ", in-flight bytes: " << inflightBytes << " (max: " << statInflightBytesMax << "), latency ms: <1:" << statLatency[0];
+            for (uint64_t i = 1; i < KAFKA_LATENCY_BUCKETS; ++i) {
+                if (i < KAFKA_LATENCY_BUCKETS - 1)
+                    ss << " <" << (1 << i) << ":" << statLatency[i];
+                else
+                    ss << " >=" << (1 << (i - 1)) << ":" << statLatency[i];
+            }
+        }
+        INFO(ss.str())
+        statsTime = time(nullptr);
     }
 
     std::string WriterKafka::getName() const {
@@ -142,7 +295,27 @@ namespace OpenLogReplicator {
     }
 
     void WriterKafka::pollQueue() {
-        if (tmpQueueSize > 0)
-            rd_kafka_poll(rk, 0);
+        rd_kafka_resp_err_t err;
+        {
+            std::unique_lock<std::mutex> lck(mtxDelivery);
+            deliveredTmp.swap(delivered);
+            failedTmp.swap(failed);
+            err = failedErr;
+        }
+
+        for (BuilderMsg* msg : deliveredTmp)
+            confirmMessage(msg);
+        deliveredTmp.clear();
+
+        // Retries are done by librdkafka in order and limited by "message.timeout.ms", failed delivery is final. Producing the message
+        // again would place it after later messages, replication stops and continues from checkpoint after restart
+        if (!failedTmp.empty()) {
+            uint64_t id = failedTmp.front()->id;
+            failedTmp.clear();
+            throw RuntimeException("Kafka: delivery of message " + std::to_string(id) + " failed: " + rd_kafka_err2str(err));
+        }
+
+        if (statsIntervalS > 0 && (uint64_t)(time(nullptr) - statsTime) >= statsIntervalS)
+            logStats();
     }
 }
@@ -17,7 +17,10 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <condition_variable>
 #include <librdkafka/rdkafka.h>
+#include <map>
+#include <mutex>
 
 #include "Writer.h"
 
@@ -26,29 +29,60 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 
 #define MAX_KAFKA_MESSAGE_MB        953
 #define MAX_KAFKA_MAX_MESSAGES      10000000
+// Delivery latency buckets: below 1ms, then powers of 2 up to 1024ms and more
+#define KAFKA_LATENCY_BUCKETS       12
 
 namespace OpenLogReplicator {
+    class WriterKafkaPoller;
+
     class WriterKafka : public Writer {
     protected:
         std::string brokers;
         std::string topic;
+        std::string tableTopic;
+        std::string topicBuffer;
         uint64_t maxMessages;
         bool enableIdempotence;
         char errstr[512];
         rd_kafka_t* rk;
         rd_kafka_topic_t* rkt;
         rd_kafka_conf_t* conf;
+        std::map<std::string, std::string> properties;
+        uint64_t maxInflightBytes;
+        uint64_t statsIntervalS;
+        WriterKafkaPoller* poller;
+        // Filled by delivery reports on poller thread, consumed by writer
+        std::mutex mtxDelivery;
+        std::condition_variable condDelivery;
+        std::vector<BuilderMsg*> delivered;
+        std::vector<BuilderMsg*> failed;
+        std::vector<BuilderMsg*> deliveredTmp;
+        std::vector<BuilderMsg*> failedTmp;
+        uint64_t inflightBytes;
+        uint64_t statInflightBytesMax;
+        uint64_t statDelivered;
+        uint64_t statLatency[KAFKA_LATENCY_BUCKETS];
+        uint64_t statFailed;
+        uint64_t statWaits;
+        time_t statsTime;
+        rd_kafka_resp_err_t failedErr;
         static void dr_msg_cb(rd_kafka_t* rkCb, const rd_kafka_message_t* rkmessage, void* opaque);
         static void error_cb(rd_kafka_t* rkCb, int err, const char* reason, void* opaque);
         static void logger_cb(const rd_kafka_t* rkCb, int level, const char* fac, const char* buf);
 
+        const char* getTopic(BuilderMsg* msg);
+        void produce(BuilderMsg* msg);
+        void logStats();
         void sendMessage(BuilderMsg* msg) override;
         std::string getName() const override;
         void pollQueue() override;
+        void purgeQueue() override;
+        void run() override;
 
     public:
         WriterKafka(Ctx* newCtx, std::string newAlias, std::string& newDatabase, Builder* newBuilder, Metadata* newMetadata, const char* newBrokers,
-                    const char* newTopic, uint64_t newMaxMessages, bool newEnableIdempotence);
+                    const char* newTopic, const char* newTableTopic, uint64_t newMaxMessages, bool newEnableIdempotence,
+                    std::map<std::string, std::string>& newProperties, uint64_t newMaxInflightMb, uint64_t newStatsIntervalS);
         ~WriterKafka() override;
 
         void initialize() override;
@@ -0,0 +1,47 @@
+/* Thread serving Kafka producer callbacks
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <thread>
+
+#include "../common/Ctx.h"
+#include "WriterKafkaPoller.h"
+
+namespace OpenLogReplicator {
+    WriterKafkaPoller::WriterKafkaPoller(Ctx* newCtx, std::string newAlias, rd_kafka_t* newRk) :
+            Thread(newCtx, newAlias),
+            rk(newRk),
+            stopping(false) {
+    }
+
+    WriterKafkaPoller::~WriterKafkaPoller() = default;
+
+    void WriterKafkaPoller::stop() {
+        stopping = true;
+    }
+
+    // Delivery reports are served here so that the writer never blocks in poll
+    void WriterKafkaPoller::run() {
+        TRACE(TRACE2_THREADS, "THREADS: KAFKA POLLER (" << std::hex << std::this_thread::get_id() << ") START")
+
+        while (!stopping && !ctx->hardShutdown)
+            rd_kafka_poll(rk, KAFKA_POLL_TIMEOUT_MS);
+
+        TRACE(TRACE2_THREADS, "THREADS: KAFKA POLLER (" << std::hex << std::this_thread::get_id() << ") STOP")
+    }
+}
@@ -0,0 +1,46 @@
+/* Header for WriterKafkaPoller class
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <atomic>
+#include <librdkafka/rdkafka.h>
+
+#include "../common/Thread.h"
+
+#ifndef WRITER_KAFKA_POLLER_H_
+#define WRITER_KAFKA_POLLER_H_
+
+#define KAFKA_POLL_TIMEOUT_MS       100
+
+namespace OpenLogReplicator {
+    class WriterKafkaPoller : public Thread {
+    protected:
+        rd_kafka_t* rk;
+        std::atomic<bool> stopping;
+
+        void run() override;
+
+    public:
+        WriterKafkaPoller(Ctx* newCtx, std::string newAlias, rd_kafka_t* newRk);
+        ~WriterKafkaPoller() override;
+
+        void stop();
+    };
+}
+
+#endif
@@ -139,8 +139,8 @@ namespace OpenLogReplicator {
 
     void WriterStream::processConfirm() {
         if (request.database_name() == database) {
-            while (tmpQueueSize > 0 && queue[0]->scn <= request.scn())
-                confirmMessage(queue[0]);
+            while (tmpQueueSize > 0 && queue[queueFirst].scn <= request.scn())
+                confirmMessage(nullptr);
         }
     }
 
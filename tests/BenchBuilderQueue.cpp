@@ -0,0 +1,170 @@
+/* Benchmark of builder to writer hand-off of output messages
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "../src/builder/BuilderJson.h"
+#include "../src/common/Ctx.h"
+#include "../src/common/Timer.h"
+
+#define BENCH_MESSAGE_LENGTH                    200
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+class TestBuilder : public BuilderJson {
+public:
+    explicit TestBuilder(Ctx* newCtx) :
+            BuilderJson(newCtx, nullptr, nullptr, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0) {
+    }
+
+    void send(const char* data, uint64_t length) {
+        builderBegin(0);
+        builderAppend(data, length);
+        builderCommit(false);
+    }
+};
+
+static uint64_t nanoTime() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Message: sequence number, time of commit and filler
+static void produce(TestBuilder* builder, uint64_t count, uint64_t pauseUs) {
+    char data[BENCH_MESSAGE_LENGTH];
+    memset((void*)data, 'x', sizeof(data));
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t now = nanoTime();
+        memcpy((void*)data, (void*)&i, sizeof(i));
+        memcpy((void*)(data + sizeof(i)), (void*)&now, sizeof(now));
+        builder->send(data, sizeof(data));
+        if (pauseUs > 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(pauseUs));
+    }
+}
+
+// Same protocol as Writer::mainLoop, messages crossing a buffer boundary are read as segments
+static bool consume(TestBuilder* builder, BuilderReader* reader, uint64_t count, uint64_t& latencySum, uint64_t& latencyMax) {
+    char data[BENCH_MESSAGE_LENGTH];
+    BuilderQueue* curBuffer = builder->getFirstBuffer();
+    uint64_t curLength = 0;
+    uint64_t received = 0;
+
+    while (received < count) {
+        uint64_t flushSeq = builder->getFlushSeq();
+
+        if (curBuffer->next.load(std::memory_order_acquire) != nullptr && curBuffer->length.load(std::memory_order_acquire) == curLength) {
+            curBuffer = curBuffer->next;
+            curLength = 0;
+            builder->releaseBuffers(reader, curBuffer->id);
+        }
+
+        auto* msg = (BuilderMsg*)(curBuffer->data + curLength);
+        uint64_t tmpLength = curBuffer->length.load(std::memory_order_acquire);
+        if (tmpLength <= curLength + sizeof(struct BuilderMsg) || __atomic_load_n(&msg->length, __ATOMIC_ACQUIRE) == 0) {
+            builder->sleepForWriterWork(flushSeq, 0, 0);
+            continue;
+        }
+        tmpLength = curBuffer->length.load(std::memory_order_acquire);
+
+        uint64_t remaining = msg->length;
+        if (remaining != BENCH_MESSAGE_LENGTH) {
+            std::cerr << "builder queue: message " << received << " has length " << remaining << std::endl;
+            return false;
+        }
+        curLength += sizeof(struct BuilderMsg) + ((msg->ownerLength + msg->tableLength + msg->keyLength + 7) & 0xFFFFFFFFFFFFFFF8);
+        uint64_t copied = 0;
+        while (remaining > 0) {
+            uint64_t part = tmpLength - curLength;
+            if (part > remaining)
+                part = remaining;
+            memcpy((void*)(data + copied), (void*)(curBuffer->data + curLength), part);
+            copied += part;
+            remaining -= part;
+
+            if (remaining > 0) {
+                curBuffer = curBuffer->next.load(std::memory_order_acquire);
+                tmpLength = curBuffer->length.load(std::memory_order_acquire);
+                curLength = 0;
+            } else
+                curLength += (part + 7) & 0xFFFFFFFFFFFFFFF8;
+        }
+
+        uint64_t now = nanoTime();
+        uint64_t num;
+        uint64_t sent;
+        memcpy((void*)&num, (void*)data, sizeof(num));
+        memcpy((void*)&sent, (void*)(data + sizeof(num)), sizeof(sent));
+        if (num != received) {
+            std::cerr << "builder queue: message " << num << " received, expected: " << received << std::endl;
+            return false;
+        }
+        latencySum += now - sent;
+        if (now - sent > latencyMax)
+            latencyMax = now - sent;
+        ++received;
+    }
+    return true;
+}
+
+static bool run(Ctx* ctx, uint64_t count, uint64_t pauseUs, uint64_t& latencySum, uint64_t& latencyMax, time_t& duration) {
+    auto* builder = new TestBuilder(ctx);
+    builder->initialize();
+    BuilderReader* reader = builder->addReader(0);
+
+    time_t start = Timer::getTime();
+    std::thread producer(produce, builder, count, pauseUs);
+    bool ok = consume(builder, reader, count, latencySum, latencyMax);
+    producer.join();
+    duration = Timer::getTime() - start;
+
+    delete builder;
+    return ok;
+}
+
+// Usage: BenchBuilderQueue [messages under load] [messages at idle]
+int main(int argc, char** argv) {
+    uint64_t countLoad = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 2000000;
+    uint64_t countIdle = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 1000;
+
+    Ctx ctx;
+    ctx.initialize(32, 1024, 0);
+
+    // Producer never waits, the writer finds new messages without parking
+    uint64_t latencySumLoad = 0;
+    uint64_t latencyMaxLoad = 0;
+    time_t durationLoad = 0;
+    bool ok = run(&ctx, countLoad, 0, latencySumLoad, latencyMaxLoad, durationLoad);
+
+    // Producer pauses longer than the writer spins, every message wakes up a parked writer
+    uint64_t latencySumIdle = 0;
+    uint64_t latencyMaxIdle = 0;
+    time_t durationIdle = 0;
+    ok &= run(&ctx, countIdle, 1000, latencySumIdle, latencyMaxIdle, durationIdle);
+
+    std::cout << "builder queue: " << countLoad << " messages of " << BENCH_MESSAGE_LENGTH << " bytes under load in " << durationLoad << " us, " <<
+            ((durationLoad > 0) ? (countLoad * 1000 / durationLoad) : 0) << " messages/ms, " << countIdle << " messages at idle, latency avg: " <<
+            (latencySumIdle / (countIdle > 0 ? countIdle : 1) / 1000) << " us, max: " << (latencyMaxIdle / 1000) << " us" << std::endl;
+
+    return ok ? 0 : 1;
+}
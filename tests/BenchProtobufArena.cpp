@@ -0,0 +1,113 @@
+/* Benchmark of protobuf messages built in arena and serialized in place
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <cstring>
+#include <iostream>
+
+#include "../src/builder/BuilderProtobuf.h"
+#include "../src/common/OraProtoBuf.pb.h"
+#include "../src/common/Timer.h"
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+// Update of one row, like the one created by BuilderProtobuf
+static void fillResponse(pb::RedoResponse* redoResponsePB, uint64_t columns) {
+    redoResponsePB->set_code(pb::ResponseCode::PAYLOAD);
+    redoResponsePB->set_scn(12345678901);
+    redoResponsePB->set_tm(1666180000);
+    redoResponsePB->set_xid("0x0002.00a.00001234");
+
+    pb::Payload* payloadPB = redoResponsePB->add_payload();
+    payloadPB->set_op(pb::UPDATE);
+    payloadPB->set_rid("AAAWDfAAEAAAAKVAAA");
+    pb::Schema* schemaPB = payloadPB->mutable_schema();
+    schemaPB->set_owner("USR1");
+    schemaPB->set_name("ADAM1");
+
+    for (uint64_t i = 0; i < columns; ++i) {
+        pb::Value* valuePB = payloadPB->add_before();
+        valuePB->set_name("COLUMN_" + std::to_string(i));
+        if (i % 2 == 0)
+            valuePB->set_value_int((int64_t)(i * 1000));
+        else
+            valuePB->set_value_string("value of column before update");
+
+        valuePB = payloadPB->add_after();
+        valuePB->set_name("COLUMN_" + std::to_string(i));
+        if (i % 2 == 0)
+            valuePB->set_value_int((int64_t)(i * 1000 + 1));
+        else
+            valuePB->set_value_string("value of column after update");
+    }
+}
+
+// Usage: BenchProtobufArena [messages] [columns]
+int main(int argc, char** argv) {
+    uint64_t messages = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 200000;
+    uint64_t columns = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 20;
+
+    std::string expected;
+    auto* buffer = new uint8_t[MEMORY_CHUNK_SIZE];
+
+    // Message per allocation, serialized to string and copied
+    uint64_t totalHeap = 0;
+    std::string output;
+    time_t start = Timer::getTime();
+    for (uint64_t i = 0; i < messages; ++i) {
+        auto* redoResponsePB = new pb::RedoResponse;
+        fillResponse(redoResponsePB, columns);
+        redoResponsePB->SerializeToString(&output);
+        memcpy(buffer, output.data(), output.length());
+        totalHeap += output.length();
+        delete redoResponsePB;
+    }
+    time_t middle = Timer::getTime();
+    expected = output;
+
+    // Messages in arena with kept first block, serialized in place
+    auto* arenaBlock = new char[PROTOBUF_ARENA_BLOCK_SIZE];
+    auto* arena = new google::protobuf::Arena(arenaBlock, PROTOBUF_ARENA_BLOCK_SIZE);
+    uint64_t totalArena = 0;
+    uint64_t size = 0;
+    for (uint64_t i = 0; i < messages; ++i) {
+        auto* redoResponsePB = google::protobuf::Arena::CreateMessage<pb::RedoResponse>(arena);
+        fillResponse(redoResponsePB, columns);
+        size = redoResponsePB->ByteSizeLong();
+        redoResponsePB->SerializeWithCachedSizesToArray(buffer);
+        totalArena += size;
+        arena->Reset();
+    }
+    time_t end = Timer::getTime();
+    bool ok = (totalHeap == totalArena && size == expected.length() && memcmp(buffer, expected.data(), size) == 0);
+
+    delete arena;
+    delete[] arenaBlock;
+    delete[] buffer;
+
+    std::cout << "protobuf: " << messages << " messages of " << columns << " columns, " << (totalArena / (messages > 0 ? messages : 1)) <<
+            " bytes/message, heap: " << (middle - start) << " us, arena: " << (end - middle) << " us" << std::endl;
+
+    if (!ok) {
+        std::cerr << "protobuf: arena output differs from heap output" << std::endl;
+        return 1;
+    }
+    return 0;
+}
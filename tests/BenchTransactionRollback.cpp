@@ -0,0 +1,90 @@
+/* Benchmark of rollback to savepoint in transaction buffer
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <cstring>
+#include <iostream>
+
+#include "../src/common/Ctx.h"
+#include "../src/common/RedoLogRecord.h"
+#include "../src/common/Timer.h"
+#include "../src/parser/Transaction.h"
+#include "../src/parser/TransactionBuffer.h"
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+// Usage: BenchTransactionRollback [rounds] [operations per savepoint]
+int main(int argc, char** argv) {
+    uint64_t rounds = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 200;
+    uint64_t operations = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 2000;
+
+    Ctx ctx;
+    ctx.initialize(32, 1024, 0);
+    TransactionBuffer transactionBuffer(&ctx);
+    Transaction transaction(typeXid((uint64_t)0x0001000200000003));
+
+    uint8_t data1[64];
+    uint8_t data2[192];
+    memset((void*)data1, 0, sizeof(data1));
+    memset((void*)data2, 0, sizeof(data2));
+
+    RedoLogRecord redoLogRecord1;
+    RedoLogRecord redoLogRecord2;
+    RedoLogRecord redoLogRecordUndo;
+    memset((void*)&redoLogRecord1, 0, sizeof(redoLogRecord1));
+    memset((void*)&redoLogRecord2, 0, sizeof(redoLogRecord2));
+    memset((void*)&redoLogRecordUndo, 0, sizeof(redoLogRecordUndo));
+    redoLogRecord1.opCode = 0x0501;
+    redoLogRecord1.data = data1;
+    redoLogRecord1.length = sizeof(data1);
+    redoLogRecord2.opCode = 0x0B02;
+    redoLogRecord2.data = data2;
+    redoLogRecord2.length = sizeof(data2);
+    // Delete row piece reverts insert row piece
+    redoLogRecordUndo.opCode = 0x0B03;
+
+    // One operation which stays in the transaction
+    transaction.add(&transactionBuffer, &redoLogRecord1, &redoLogRecord2);
+    uint64_t sizeStart = transaction.size;
+
+    time_t start = Timer::getTime();
+    for (uint64_t round = 0; round < rounds; ++round) {
+        for (uint64_t i = 0; i < operations; ++i)
+            transaction.add(&transactionBuffer, &redoLogRecord1, &redoLogRecord2);
+        for (uint64_t i = 0; i < operations; ++i)
+            transaction.rollbackLastOp(&transactionBuffer, &redoLogRecordUndo, &redoLogRecord2);
+    }
+    time_t end = Timer::getTime();
+
+    uint64_t sizeEnd = transaction.size;
+    bool ok = (sizeEnd == sizeStart && transaction.firstTc == transaction.lastTc);
+    uint64_t maxChunks = ctx.getMaxUsedMemory();
+    transaction.purge(&transactionBuffer);
+
+    uint64_t total = rounds * operations * 2;
+    std::cout << "rollback: " << rounds << " savepoints of " << operations << " operations, " << (end - start) << " us, " <<
+            ((end > start) ? (total * 1000 / (end - start)) : 0) << " operations/ms, max memory: " << maxChunks << " MB" << std::endl;
+
+    if (!ok) {
+        std::cerr << "rollback: transaction not restored, size: " << sizeEnd << ", expected: " << sizeStart << std::endl;
+        return 1;
+    }
+    return 0;
+}
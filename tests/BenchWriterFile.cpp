@@ -0,0 +1,231 @@
+/* Benchmark of file writer batches written with writev
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <iostream>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "../src/builder/BuilderJson.h"
+#include "../src/common/Ctx.h"
+#include "../src/common/Timer.h"
+#include "../src/metadata/Metadata.h"
+#include "../src/writer/WriterFile.h"
+#include "../src/writer/WriterFileCompressor.h"
+
+#define BENCH_MESSAGE_LENGTH                    200
+#define BENCH_FILE_SIZE                         (64 * 1024 * 1024)
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+class TestBuilder : public BuilderJson {
+public:
+    explicit TestBuilder(Ctx* newCtx) :
+            BuilderJson(newCtx, nullptr, nullptr, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0) {
+    }
+
+    void send(const char* data, uint64_t length) {
+        builderBegin(0);
+        builderAppend(data, length);
+        builderCommit(false);
+    }
+};
+
+class TestWriterFile : public WriterFile {
+public:
+    TestWriterFile(Ctx* newCtx, std::string& newDatabase, Builder* newBuilder, Metadata* newMetadata, const char* newOutput) :
+            WriterFile(newCtx, "bench", newDatabase, newBuilder, newMetadata, newOutput, "", BENCH_FILE_SIZE, 1, 1, 0, 0,
+                       WRITER_FILE_COMPRESSION_NONE, 0, 0, 0) {
+    }
+
+    // Same steps as Writer::mainLoop for a message read from the builder
+    void send(BuilderMsg* msg, std::vector<struct iovec>& msgSegments) {
+        msg = queueMessage(msg);
+        if (msgSegments.size() > 1) {
+            segments = msgSegments;
+            msg->flags |= OUTPUT_BUFFER_SEGMENTED;
+        }
+        createMessage();
+        sendMessage(msg);
+    }
+
+    void finish() {
+        flush();
+        closeFile();
+    }
+
+    [[nodiscard]] uint64_t getConfirmedMessages() const {
+        return confirmedMessages;
+    }
+
+    [[nodiscard]] uint64_t getOutputFileNum() const {
+        return outputFileNum;
+    }
+};
+
+// All committed messages, segments of a message may be in many buffers
+static void forEachMessage(Builder* builder, const std::function<void(BuilderMsg*, std::vector<struct iovec>&)>& callback) {
+    std::vector<struct iovec> msgSegments;
+    BuilderQueue* curBuffer = builder->getFirstBuffer();
+    uint64_t curLength = 0;
+
+    while (true) {
+        if (curBuffer->next != nullptr && curBuffer->length == curLength) {
+            curBuffer = curBuffer->next;
+            curLength = 0;
+        }
+
+        auto* msg = (BuilderMsg*)(curBuffer->data + curLength);
+        uint64_t tmpLength = curBuffer->length;
+        if (tmpLength <= curLength + sizeof(struct BuilderMsg) || msg->length == 0)
+            return;
+
+        curLength += sizeof(struct BuilderMsg) + ((msg->ownerLength + msg->tableLength + msg->keyLength + 7) & 0xFFFFFFFFFFFFFFF8);
+        msgSegments.clear();
+        uint64_t remaining = msg->length;
+        while (remaining > 0) {
+            uint64_t part = tmpLength - curLength;
+            if (part > remaining)
+                part = remaining;
+            if (part > 0)
+                msgSegments.push_back({(void*)(curBuffer->data + curLength), part});
+            remaining -= part;
+
+            if (remaining > 0) {
+                curBuffer = curBuffer->next;
+                tmpLength = curBuffer->length;
+                curLength = 0;
+            } else
+                curLength += (part + 7) & 0xFFFFFFFFFFFFFFF8;
+        }
+
+        callback(msg, msgSegments);
+    }
+}
+
+// Output of the writer must be the same as the reference file
+static bool compareFiles(const std::string& reference, uint64_t files) {
+    int referenceDes = open(reference.c_str(), O_RDONLY);
+    if (referenceDes == -1)
+        return false;
+
+    bool ok = true;
+    char buffer[65536];
+    char bufferReference[65536];
+    for (uint64_t i = 0; i <= files && ok; ++i) {
+        std::string fileName("bench-" + std::to_string(i) + ".json");
+        int fileDes = open(fileName.c_str(), O_RDONLY);
+        if (fileDes == -1) {
+            ok = false;
+            break;
+        }
+
+        int64_t bytesRead;
+        while ((bytesRead = read(fileDes, buffer, sizeof(buffer))) > 0) {
+            if (read(referenceDes, bufferReference, bytesRead) != bytesRead || memcmp(buffer, bufferReference, bytesRead) != 0) {
+                ok = false;
+                break;
+            }
+        }
+        close(fileDes);
+        unlink(fileName.c_str());
+    }
+
+    if (ok && read(referenceDes, bufferReference, 1) != 0)
+        ok = false;
+    close(referenceDes);
+    return ok;
+}
+
+// Usage: BenchWriterFile [messages]
+int main(int argc, char** argv) {
+    uint64_t count = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 500000;
+
+    // Output files are created in a new directory, the file name mask has no path
+    char dirTemplate[] = "BenchWriterFile.XXXXXX";
+    if (mkdtemp(dirTemplate) == nullptr || chdir(dirTemplate) != 0) {
+        std::cerr << "writer file: can't create directory: " << strerror(errno) << std::endl;
+        return 1;
+    }
+    std::string reference("reference.json");
+    std::string output("bench-%i.json");
+    std::string database("BENCH");
+
+    Ctx ctx;
+    ctx.initialize(32, 1024, 0);
+    auto* metadata = new Metadata(&ctx, nullptr, database.c_str(), 0, ZERO_SCN, ZERO_SEQ, "", 0);
+    auto* builder = new TestBuilder(&ctx);
+    builder->initialize();
+    auto* writer = new TestWriterFile(&ctx, database, builder, metadata, output.c_str());
+    writer->initialize();
+
+    char data[BENCH_MESSAGE_LENGTH];
+    memset((void*)data, 'x', sizeof(data));
+    for (uint64_t i = 0; i < count; ++i) {
+        std::string num(std::to_string(i));
+        memcpy((void*)data, (void*)num.c_str(), num.length());
+        builder->send(data, sizeof(data));
+    }
+
+    // Reference: one write for the message and one for the new line
+    bool ok = true;
+    int referenceDes = open(reference.c_str(), O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
+    time_t start = Timer::getTime();
+    forEachMessage(builder, [&](BuilderMsg* msg __attribute__((unused)), std::vector<struct iovec>& msgSegments) {
+        for (struct iovec& segment : msgSegments)
+            ok &= (write(referenceDes, segment.iov_base, segment.iov_len) == (int64_t)segment.iov_len);
+        ok &= (write(referenceDes, "\n", 1) == 1);
+    });
+    close(referenceDes);
+    time_t middle = Timer::getTime();
+
+    // Writer: batches written with writev, buffers released when messages are confirmed
+    forEachMessage(builder, [&](BuilderMsg* msg, std::vector<struct iovec>& msgSegments) {
+        writer->send(msg, msgSegments);
+    });
+    writer->finish();
+    time_t end = Timer::getTime();
+
+    if (writer->getConfirmedMessages() != count) {
+        std::cerr << "writer file: " << writer->getConfirmedMessages() << " messages confirmed, expected: " << count << std::endl;
+        ok = false;
+    }
+    uint64_t files = writer->getOutputFileNum();
+    if (!compareFiles(reference, files)) {
+        std::cerr << "writer file: output differs from reference" << std::endl;
+        ok = false;
+    }
+    unlink(reference.c_str());
+    if (chdir("..") == 0)
+        rmdir(dirTemplate);
+
+    delete writer;
+    delete builder;
+    delete metadata;
+
+    std::cout << "writer file: " << count << " messages of " << BENCH_MESSAGE_LENGTH << " bytes, " << (files + 1) << " files, write per message: " <<
+            (middle - start) << " us, " << ((middle > start) ? (count * 1000000 / (middle - start)) : 0) << " messages/s, writev batches: " <<
+            (end - middle) << " us, " << ((end > middle) ? (count * 1000000 / (end - middle)) : 0) << " messages/s" << std::endl;
+
+    return ok ? 0 : 1;
+}
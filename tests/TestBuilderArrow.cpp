@@ -0,0 +1,197 @@
+/* Test of Arrow IPC output read back by Arrow stream reader
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <arrow/api.h>
+#include <arrow/io/memory.h>
+#include <arrow/ipc/reader.h>
+#include <iostream>
+#include <vector>
+
+#include "../src/builder/BuilderArrow.h"
+#include "../src/common/Ctx.h"
+#include "../src/common/OracleColumn.h"
+#include "../src/common/OracleObject.h"
+#include "../src/common/RuntimeException.h"
+#include "../src/common/SysCol.h"
+
+// 2022-01-01 00:00:00 in microseconds since epoch
+#define TEST_DATE_MICROS                        1640995200000000LL
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+class TestBuilder : public BuilderArrow {
+public:
+    explicit TestBuilder(Ctx* newCtx) :
+            BuilderArrow(newCtx, nullptr, nullptr, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 100, 1000000, 10) {
+    }
+
+    // Row of date, raw and number column, empty value is not set
+    void row(OracleObject* object, const std::string& date, const std::string& raw, const std::string& number, bool compressed) {
+        netRowValue(0, VALUE_AFTER, date);
+        if (!raw.empty())
+            netRowValue(1, VALUE_AFTER, raw);
+        netRowValue(2, VALUE_AFTER, number);
+        try {
+            appendRow(object, "c", VALUE_AFTER, compressed);
+        } catch (RuntimeException&) {
+            valuesRelease();
+            throw;
+        }
+        valuesRelease();
+    }
+
+    void send() {
+        flush();
+    }
+};
+
+// Payload of every message, each one is a complete IPC stream
+static std::vector<std::string> readMessages(Builder* builder) {
+    std::vector<std::string> messages;
+    BuilderQueue* curBuffer = builder->getFirstBuffer();
+    uint64_t curLength = 0;
+
+    while (true) {
+        if (curBuffer->next != nullptr && curBuffer->length == curLength) {
+            curBuffer = curBuffer->next;
+            curLength = 0;
+        }
+
+        auto* msg = (BuilderMsg*)(curBuffer->data + curLength);
+        if (curBuffer->length <= curLength + sizeof(struct BuilderMsg) || msg->length == 0)
+            return messages;
+        curLength += sizeof(struct BuilderMsg) + ((msg->ownerLength + msg->tableLength + msg->keyLength + 7) & 0xFFFFFFFFFFFFFFF8);
+        messages.emplace_back((const char*)curBuffer->data + curLength, msg->length);
+        curLength += (msg->length + 7) & 0xFFFFFFFFFFFFFFF8;
+    }
+}
+
+static std::shared_ptr<arrow::RecordBatch> readBatch(const std::string& message, std::shared_ptr<arrow::Schema>& schema) {
+    auto input = std::make_shared<arrow::io::BufferReader>(std::make_shared<arrow::Buffer>((const uint8_t*)message.data(), (int64_t)message.length()));
+    arrow::Result<std::shared_ptr<arrow::ipc::RecordBatchStreamReader>> reader = arrow::ipc::RecordBatchStreamReader::Open(input);
+    if (!reader.ok())
+        return nullptr;
+    schema = (*reader)->schema();
+    std::shared_ptr<arrow::RecordBatch> batch;
+    if (!(*reader)->ReadNext(&batch).ok())
+        return nullptr;
+    return batch;
+}
+
+int main() {
+    Ctx ctx;
+    ctx.initialize(32, 1024, 0);
+    auto* builder = new TestBuilder(&ctx);
+    builder->initialize();
+    bool ok = true;
+
+    std::string owner("OWNER");
+    std::string name("TAB");
+    std::string dateName("D");
+    std::string rawName("R");
+    std::string numberName("N");
+    auto* object = new OracleObject(1, 1, 1, 0, 0, owner, name);
+    object->addColumn(new OracleColumn(1, 0, 1, dateName, SYS_COL_TYPE_DATE, 7, -1, -1, 0, 0, true, false, false, false, false, false, false,
+                                       false));
+    object->addColumn(new OracleColumn(2, 0, 2, rawName, SYS_COL_TYPE_RAW, 10, -1, -1, 0, 0, true, false, false, false, false, false, false,
+                                       false));
+    object->addColumn(new OracleColumn(3, 0, 3, numberName, SYS_COL_TYPE_NUMBER, 22, 5, 2, 0, 0, true, false, false, false, false, false, false,
+                                       false));
+    std::string date("\x78\x7A\x01\x01\x01\x01\x01", 7);
+    std::string dateBroken("\x78\x7A\x01", 3);
+    std::string raw("\x01\x02", 2);
+    // 1.23 and -1.5
+    std::string number1("\xC1\x02\x18", 3);
+    std::string number2("\x3E\x64\x33\x66", 4);
+
+    // Two rows of one table are sent in one record batch, checkpoint after them in the control stream
+    typeXid xid((uint64_t)0x0001000200000003);
+    builder->processBegin(100, typeTime(0), 1, xid, false);
+    builder->row(object, date, raw, number1, false);
+    builder->row(object, date, "", number2, false);
+    builder->processCommit(false);
+    builder->send();
+    builder->processCheckpoint(200, typeTime(0), 1, 4096, false);
+
+    std::vector<std::string> messages = readMessages(builder);
+    if (messages.size() != 2) {
+        std::cerr << "arrow: " << std::dec << messages.size() << " messages, expected: 2" << std::endl;
+        ok = false;
+    } else {
+        std::shared_ptr<arrow::Schema> schema;
+        std::shared_ptr<arrow::RecordBatch> batch = readBatch(messages[0], schema);
+        std::vector<std::string> fieldNames = {"op", "scn", "tm", "xid", "unset", "D", "R", "N"};
+        if (batch == nullptr || schema->field_names() != fieldNames || batch->num_rows() != 2) {
+            std::cerr << "arrow: rows not read back: " << (batch == nullptr ? "no batch" : schema->ToString()) << std::endl;
+            ok = false;
+        } else {
+            auto ops = std::static_pointer_cast<arrow::DictionaryArray>(batch->column(0));
+            auto opNames = std::static_pointer_cast<arrow::StringArray>(ops->dictionary());
+            auto scns = std::static_pointer_cast<arrow::UInt64Array>(batch->column(1));
+            auto xids = std::static_pointer_cast<arrow::StringArray>(batch->column(3));
+            auto dates = std::static_pointer_cast<arrow::TimestampArray>(batch->column(5));
+            auto raws = std::static_pointer_cast<arrow::BinaryArray>(batch->column(6));
+            auto numbers = std::static_pointer_cast<arrow::Decimal128Array>(batch->column(7));
+
+            if (schema->metadata() == nullptr || schema->metadata()->Get("owner").ValueOr("") != owner ||
+                    schema->metadata()->Get("table").ValueOr("") != name) {
+                std::cerr << "arrow: schema metadata of table missing" << std::endl;
+                ok = false;
+            }
+            if (opNames->GetString(ops->GetValueIndex(1)) != "c" || scns->Value(0) != 100 || xids->GetString(0) != xid.toString()) {
+                std::cerr << "arrow: header fields differ: " << batch->ToString() << std::endl;
+                ok = false;
+            }
+            if (dates->Value(0) != TEST_DATE_MICROS || dates->Value(1) != TEST_DATE_MICROS || raws->GetString(0) != raw || !raws->IsNull(1) ||
+                    numbers->FormatValue(0) != "1.23" || numbers->FormatValue(1) != "-1.50") {
+                std::cerr << "arrow: column values differ: " << batch->ToString() << std::endl;
+                ok = false;
+            }
+        }
+
+        batch = readBatch(messages[1], schema);
+        if (batch == nullptr || batch->num_rows() != 1 || std::static_pointer_cast<arrow::StringArray>(batch->column(0))->GetString(0) != "chkpt" ||
+                std::static_pointer_cast<arrow::UInt64Array>(batch->column(4))->Value(0) != 4096) {
+            std::cerr << "arrow: checkpoint not read back" << std::endl;
+            ok = false;
+        }
+    }
+
+    // Row which can't be written completely is not written with nulls in place of values
+    for (int test = 0; test < 2; ++test) {
+        bool failed = false;
+        try {
+            builder->row(object, (test == 0) ? dateBroken : date, raw, number1, test == 1);
+        } catch (RuntimeException&) {
+            failed = true;
+        }
+
+        if (!failed) {
+            std::cerr << "arrow: row " << ((test == 0) ? "with broken date" : "compressed") << " written" << std::endl;
+            ok = false;
+        }
+    }
+    delete builder;
+    delete object;
+
+    std::cout << "arrow: " << (ok ? "IPC output is correct" : "IPC output failed") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+/* Test of Avro encoding of values and schema fingerprints
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <iostream>
+#include <vector>
+
+#include "../src/builder/BuilderAvro.h"
+#include "../src/common/Ctx.h"
+#include "../src/common/OracleColumn.h"
+#include "../src/common/OracleObject.h"
+#include "../src/common/RuntimeException.h"
+#include "../src/common/SysCol.h"
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+class TestBuilder : public BuilderAvro {
+public:
+    explicit TestBuilder(Ctx* newCtx) :
+            BuilderAvro(newCtx, nullptr, nullptr, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0) {
+    }
+
+    [[nodiscard]] uint64_t schemaFingerprint(const std::string& canonical) const {
+        return fingerprint(canonical);
+    }
+
+    std::string encodeLong(int64_t value) {
+        uint64_t start = lastBuffer->length;
+        appendLong(value);
+        return std::string((const char*)lastBuffer->data + start, lastBuffer->length - start);
+    }
+
+    // NUMBER value of decimal field, as written by processValue
+    std::string encodeDecimal(const std::string& number, uint64_t precision, uint64_t scale) {
+        uint64_t start = lastBuffer->length;
+        std::string columnName("N");
+        fieldType = AVRO_TYPE_DECIMAL;
+        fieldData = (const uint8_t*)number.data();
+        fieldLength = number.length();
+        valueLength = 0;
+        columnNumber(columnName, precision, scale);
+        return std::string((const char*)lastBuffer->data + start, lastBuffer->length - start);
+    }
+
+    // Row of date and raw column
+    void row(OracleObject* object, const std::string& date, const std::string& raw, bool compressed) {
+        netRowValue(0, VALUE_AFTER, date);
+        netRowValue(1, VALUE_AFTER, raw);
+        try {
+            appendRow(object, getSchema(object), VALUE_AFTER, compressed);
+        } catch (RuntimeException&) {
+            valuesRelease();
+            throw;
+        }
+        valuesRelease();
+    }
+};
+
+static std::string hex(const std::string& data) {
+    static const char digits[] = "0123456789abcdef";
+    std::string text;
+    for (char character : data) {
+        text += digits[(uint8_t)character >> 4];
+        text += digits[(uint8_t)character & 0x0F];
+    }
+    return text;
+}
+
+int main() {
+    Ctx ctx;
+    ctx.initialize(32, 1024, 0);
+    auto* builder = new TestBuilder(&ctx);
+    builder->initialize();
+    bool ok = true;
+
+    // Fingerprints of canonical forms from schema tests of Avro specification
+    std::vector<std::pair<std::string, uint64_t>> fingerprints = {
+            {R"("null")", 7195948357588979594ULL}, {R"("boolean")", (uint64_t)-6970731678124411036LL},
+            {R"("int")", 8247732601305521295ULL}, {R"("long")", (uint64_t)-3434872931120570953LL},
+            {R"("float")", 5583340709985441680ULL}, {R"("double")", (uint64_t)-8181574048448539266LL},
+            {R"("bytes")", 5746618253357095269ULL}, {R"("string")", (uint64_t)-8142146995180207161LL}};
+    for (auto& fingerprint : fingerprints) {
+        if (builder->schemaFingerprint(fingerprint.first) != fingerprint.second) {
+            std::cerr << "avro: fingerprint of " << fingerprint.first << ": " << std::dec << (int64_t)builder->schemaFingerprint(fingerprint.first) <<
+                    ", expected: " << (int64_t)fingerprint.second << std::endl;
+            ok = false;
+        }
+    }
+
+    // Zig-zag variable length encoding of long
+    std::vector<std::pair<int64_t, std::string>> longs = {
+            {0, "00"}, {-1, "01"}, {1, "02"}, {-2, "03"}, {63, "7e"}, {-64, "7f"}, {64, "8001"}, {-65, "8101"}, {8191, "fe7f"}, {8192, "808001"},
+            {INT64_MAX, "feffffffffffffffff01"}, {INT64_MIN, "ffffffffffffffffff01"}};
+    for (auto& longValue : longs) {
+        std::string text = hex(builder->encodeLong(longValue.first));
+        if (text != longValue.second) {
+            std::cerr << "avro: long " << std::dec << longValue.first << ": " << text << ", expected: " << longValue.second << std::endl;
+            ok = false;
+        }
+    }
+
+    // Oracle NUMBER to decimal: union branch, length and shortest two's complement big endian unscaled value
+    struct Decimal {
+        std::string number;
+        uint64_t precision;
+        uint64_t scale;
+        std::string expected;
+    };
+    std::vector<Decimal> decimals = {
+            {"\x80", 5, 0, "020200"},
+            {"\xC1\x02\x18", 5, 2, "02027b"},
+            {"\xC1\x02\x18", 6, 3, "020404ce"},
+            {"\x3E\x64\x33\x66", 5, 1, "0202f1"},
+            {"\xC2\x02\x1D", 3, 0, "02040080"},
+            {"\x3D\x64\x48\x66", 3, 0, "0204ff7f"},
+            {"\xCA\x0D\x23\x39\x4F\x5B\x0D\x23\x39\x4F\x5B", 20, 0, "021200ab54a98ceb1f0ad2"}};
+    for (const Decimal& decimal : decimals) {
+        std::string text = hex(builder->encodeDecimal(decimal.number, decimal.precision, decimal.scale));
+        if (text != decimal.expected) {
+            std::cerr << "avro: decimal " << hex(decimal.number) << " scale " << std::dec << decimal.scale << ": " << text << ", expected: " <<
+                    decimal.expected << std::endl;
+            ok = false;
+        }
+    }
+
+    // Value with more digits than the scale allows is not rounded
+    bool failed = false;
+    try {
+        builder->encodeDecimal("\xC1\x02\x18\x29", 5, 2);
+    } catch (RuntimeException&) {
+        failed = true;
+    }
+    if (!failed) {
+        std::cerr << "avro: decimal 1.234 written with scale 2" << std::endl;
+        ok = false;
+    }
+
+    // Row which can't be written completely is not written with nulls in place of values
+    std::string owner("OWNER");
+    std::string name("TAB");
+    std::string dateName("D");
+    std::string rawName("R");
+    auto* object = new OracleObject(1, 1, 1, 0, 0, owner, name);
+    object->addColumn(new OracleColumn(1, 0, 1, dateName, SYS_COL_TYPE_DATE, 7, -1, -1, 0, 0, true, false, false, false, false, false, false,
+                                       false));
+    object->addColumn(new OracleColumn(2, 0, 2, rawName, SYS_COL_TYPE_RAW, 10, -1, -1, 0, 0, true, false, false, false, false, false, false,
+                                       false));
+    std::string date("\x78\x7A\x01\x01\x01\x01\x01", 7);
+    std::string dateBroken("\x78\x7A\x01", 3);
+    std::string raw("\x01\x02", 2);
+
+    for (int test = 0; test < 3; ++test) {
+        failed = false;
+        try {
+            builder->row(object, (test == 1) ? dateBroken : date, raw, test == 2);
+        } catch (RuntimeException&) {
+            failed = true;
+        }
+
+        if (failed != (test != 0)) {
+            std::cerr << "avro: row " << ((test == 0) ? "with valid values" : (test == 1) ? "with broken date" : "compressed") <<
+                    (failed ? " not written" : " written") << std::endl;
+            ok = false;
+        }
+    }
+    delete builder;
+    delete object;
+
+    std::cout << "avro: " << (ok ? "encoding is correct" : "encoding failed") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+/* Test of owner, table and key tags of builder messages
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <iostream>
+#include <vector>
+
+#include "../src/builder/BuilderAvro.h"
+#include "../src/builder/BuilderJson.h"
+#include "../src/common/Ctx.h"
+#include "../src/common/OracleColumn.h"
+#include "../src/common/OracleObject.h"
+#include "../src/common/SysCol.h"
+
+#define TEST_BDBA                               0x01000100
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+// Row of table with number primary key column and raw column
+template<class BuilderBase> class TestBuilder : public BuilderBase {
+public:
+    explicit TestBuilder(Ctx* newCtx) :
+            BuilderBase(newCtx, nullptr, nullptr, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0) {
+    }
+
+    void row(uint64_t type, OracleObject* object, typeSlot slot, const std::string& pkValue, const std::string& raw) {
+        uint64_t image = (type == TRANSACTION_DELETE) ? VALUE_BEFORE : VALUE_AFTER;
+        this->netRowValue(0, image, pkValue);
+        this->netRowValue(1, image, raw);
+        this->processRow(type, object, object->dataObj, TEST_BDBA, slot, this->lastXid);
+        this->valuesRelease();
+    }
+
+    // Size reported for the open message of the row and bytes it takes in the buffer after commit
+    void rowSize(OracleObject* object, const std::string& data, uint64_t& reported, uint64_t& used) {
+        uint64_t start = this->lastBuffer->length;
+        this->builderBeginRow(object);
+        this->builderAppend(data.c_str(), data.length());
+        reported = this->builderSize();
+        this->builderCommit(false);
+        used = this->lastBuffer->length - start;
+    }
+};
+
+// Expected tag of message, empty when the message has no tag
+struct TestTag {
+    std::string owner;
+    std::string table;
+    std::string key;
+};
+
+static std::vector<BuilderMsg*> readMessages(Builder* builder) {
+    std::vector<BuilderMsg*> messages;
+    BuilderQueue* curBuffer = builder->getFirstBuffer();
+    uint64_t curLength = 0;
+
+    while (true) {
+        if (curBuffer->next != nullptr && curBuffer->length == curLength) {
+            curBuffer = curBuffer->next;
+            curLength = 0;
+        }
+
+        auto* msg = (BuilderMsg*)(curBuffer->data + curLength);
+        if (curBuffer->length <= curLength + sizeof(struct BuilderMsg) || msg->length == 0)
+            return messages;
+        messages.push_back(msg);
+        curLength += sizeof(struct BuilderMsg) + ((msg->ownerLength + msg->tableLength + msg->keyLength + 7) & 0xFFFFFFFFFFFFFFF8);
+        curLength += (msg->length + 7) & 0xFFFFFFFFFFFFFFF8;
+    }
+}
+
+static bool checkTags(const char* name, Builder* builder, const std::vector<TestTag>& expectedTags) {
+    std::vector<BuilderMsg*> messages = readMessages(builder);
+    if (messages.size() != expectedTags.size()) {
+        std::cerr << "builder tags: " << name << ": " << std::dec << messages.size() << " messages, expected: " << expectedTags.size() << std::endl;
+        return false;
+    }
+
+    bool ok = true;
+    for (uint64_t i = 0; i < messages.size(); ++i) {
+        BuilderMsg* msg = messages[i];
+        std::string owner((const char*)msg->tag, msg->ownerLength);
+        std::string table((const char*)msg->tag + msg->ownerLength, msg->tableLength);
+        std::string key((const char*)msg->tag + msg->ownerLength + msg->tableLength, msg->keyLength);
+        bool keyExpected = !expectedTags[i].key.empty();
+        if (owner != expectedTags[i].owner || table != expectedTags[i].table || key != expectedTags[i].key || (msg->key != 0) != keyExpected) {
+            std::cerr << "builder tags: " << name << ": message " << std::dec << i << " tag: " << owner << "." << table << " key: " << key <<
+                    ", expected: " << expectedTags[i].owner << "." << expectedTags[i].table << " key: " << expectedTags[i].key << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int main() {
+    Ctx ctx;
+    ctx.initialize(32, 1024, 0);
+    bool ok = true;
+
+    std::string owner("OWNER");
+    std::string namePk("TAB_PK");
+    std::string nameAvro("TAB_AVRO");
+    std::string idName("ID");
+    std::string rawName("R");
+    auto* objectPk = new OracleObject(101, 1001, 1, 0, 0, owner, namePk);
+    objectPk->addColumn(new OracleColumn(1, 0, 1, idName, SYS_COL_TYPE_NUMBER, 22, -1, -1, 1, 0, false, false, false, false, false, false, false,
+                                         false));
+    objectPk->addColumn(new OracleColumn(2, 0, 2, rawName, SYS_COL_TYPE_RAW, 10, -1, -1, 0, 0, true, false, false, false, false, false, false,
+                                         false));
+    auto* objectAvro = new OracleObject(102, 1002, 1, 0, 0, owner, nameAvro);
+    objectAvro->addColumn(new OracleColumn(1, 0, 1, idName, SYS_COL_TYPE_NUMBER, 22, -1, -1, 1, 0, false, false, false, false, false, false, false,
+                                           false));
+    objectAvro->addColumn(new OracleColumn(2, 0, 2, rawName, SYS_COL_TYPE_RAW, 10, -1, -1, 0, 0, true, false, false, false, false, false, false,
+                                           false));
+    std::string id1("\xC1\x02", 2);
+    std::string id2("\xC1\x03", 2);
+    typeXid xid((uint64_t)0x0001000200000003);
+
+    // Begin and commit don't take tag or key of the row sent before them
+    auto* builderJson = new TestBuilder<BuilderJson>(&ctx);
+    builderJson->initialize();
+    builderJson->setTableTags(true);
+    builderJson->setMessageKey(MESSAGE_KEY_PRIMARY_KEY);
+    builderJson->processBegin(100, typeTime(0), 1, xid, false);
+    builderJson->row(TRANSACTION_INSERT, objectPk, 1, id1, "\x01");
+    builderJson->row(TRANSACTION_DELETE, objectPk, 2, id2, "\x02");
+    builderJson->processCommit(false);
+    builderJson->processBegin(200, typeTime(0), 1, xid, false);
+    builderJson->row(TRANSACTION_INSERT, objectPk, 3, id2, "\x03");
+    builderJson->processCommit(false);
+    if (!checkTags("json", builderJson, {{}, {owner, namePk, "1"}, {owner, namePk, "2"}, {}, {}, {owner, namePk, "2"}, {}}))
+        ok = false;
+
+    // Tag is stored between header and data, reported size of the message includes it
+    for (bool tableTags : {false, true}) {
+        builderJson->setTableTags(tableTags);
+        uint64_t reported;
+        uint64_t used;
+        builderJson->rowSize(objectPk, "{\"op\":\"c\"}", reported, used);
+        if (reported != used) {
+            std::cerr << "builder tags: json: size of message " << (tableTags ? "with" : "without") << " tag: " << std::dec << reported <<
+                    ", in buffer: " << used << std::endl;
+            ok = false;
+        }
+    }
+    delete builderJson;
+
+    // Control schema and begin are sent while the key of the first row is already known, they take no tag, table schema is tagged
+    // with the table of the row which needs it, but not with the row key
+    auto* builderAvro = new TestBuilder<BuilderAvro>(&ctx);
+    builderAvro->initialize();
+    builderAvro->setTableTags(true);
+    builderAvro->setMessageKey(MESSAGE_KEY_ROWID);
+    builderAvro->processBegin(100, typeTime(0), 1, xid, false);
+    builderAvro->row(TRANSACTION_INSERT, objectAvro, 1, id1, "\x01");
+    builderAvro->row(TRANSACTION_INSERT, objectAvro, 2, id2, "\x02");
+    builderAvro->processCommit(false);
+    char rowId1[19];
+    char rowId2[19];
+    typeRowId(1002, TEST_BDBA, 1).toString(rowId1);
+    typeRowId(1002, TEST_BDBA, 2).toString(rowId2);
+    if (!checkTags("avro", builderAvro, {{}, {}, {owner, nameAvro, ""}, {owner, nameAvro, std::string(rowId1, 18)},
+                                         {owner, nameAvro, std::string(rowId2, 18)}, {}}))
+        ok = false;
+    delete builderAvro;
+
+    delete objectPk;
+    delete objectAvro;
+
+    std::cout << "builder tags: " << (ok ? "only rows are tagged" : "tags failed") << std::endl;
+    return ok ? 0 : 1;
+}
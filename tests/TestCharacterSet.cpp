@@ -0,0 +1,197 @@
+/* Test of conversion of whole string values to UTF-8
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../src/builder/BuilderJson.h"
+#include "../src/common/Ctx.h"
+#include "../src/common/RuntimeException.h"
+#include "../src/locales/CharacterSet.h"
+#include "../src/locales/Locales.h"
+
+#define CHARSET_US7ASCII                        1
+#define CHARSET_WE8HP                           3
+#define CHARSET_WE8ISO8859P1                    31
+#define CHARSET_WE8MSWIN1252                    178
+#define CHARSET_JA16SJIS                        832
+#define CHARSET_AL32UTF8                        873
+#define CHARSET_AL16UTF16                       2000
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+class TestBuilder : public BuilderJson {
+public:
+    TestBuilder(Ctx* newCtx, Locales* newLocales) :
+            BuilderJson(newCtx, newLocales, nullptr, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0) {
+    }
+
+    std::string parse(const std::string& value, uint64_t charsetId) {
+        parseString((const uint8_t*)value.data(), value.length(), charsetId);
+        return std::string(valueBuffer, valueLength);
+    }
+};
+
+// Conversion of one character at a time, as before whole values were converted
+static std::string referenceDecode(const CharacterSet* characterSet, const std::string& value) {
+    std::string text;
+    auto* data = (const uint8_t*)value.data();
+    uint64_t length = value.length();
+    while (length > 0) {
+        typeUnicode character = characterSet->decode(data, length);
+        if (character <= 0x7F) {
+            text += (char)character;
+        } else if (character <= 0x7FF) {
+            text += (char)(0xC0 | (character >> 6));
+            text += (char)(0x80 | (character & 0x3F));
+        } else if (character <= 0xFFFF) {
+            text += (char)(0xE0 | (character >> 12));
+            text += (char)(0x80 | ((character >> 6) & 0x3F));
+            text += (char)(0x80 | (character & 0x3F));
+        } else {
+            text += (char)(0xF0 | (character >> 18));
+            text += (char)(0x80 | ((character >> 12) & 0x3F));
+            text += (char)(0x80 | ((character >> 6) & 0x3F));
+            text += (char)(0x80 | (character & 0x3F));
+        }
+    }
+    return text;
+}
+
+// Text of random pieces, long enough for plain runs over 16 byte blocks
+static std::string randomText(std::mt19937_64& random, const std::vector<std::string>& pieces) {
+    std::string text;
+    uint64_t count = random() % 60;
+    for (uint64_t i = 0; i < count; ++i)
+        text += pieces[random() % pieces.size()];
+    return text;
+}
+
+int main() {
+    Ctx ctx;
+    ctx.initialize(32, 1024, 0);
+    Locales locales;
+    locales.initialize();
+    auto* builder = new TestBuilder(&ctx, &locales);
+    builder->initialize();
+    std::mt19937_64 random(1);
+    bool ok = true;
+    uint64_t checked = 0;
+
+    std::string all8bit;
+    for (uint64_t i = 0; i < 256; ++i)
+        all8bit += (char)i;
+    std::vector<std::string> ascii = {"a", "plain text of some length ", "0123456789abcdef", "\"", "\n"};
+    std::vector<std::string> bytes8bit = {"a", "plain text of some length ", "\xE9", "\x80\x9F", "\xFF", "\x01"};
+    std::vector<std::string> sjis = {"a", "plain text of some length ", "\xB1", "\x82\xA0", "\x88\x9F"};
+    // Shortest forms of every length with the edge values, surrogates in 3 bytes are copied like decode() does
+    std::vector<std::string> utf8 = {"a", "plain text of some length ", "\xC2\x80", "\xDF\xBF", "\xC3\xA9", "\xE0\xA0\x80", "\xE2\x82\xAC",
+                                     "\xED\xA0\x80", "\xEF\xBF\xBF", "\xF0\x90\x80\x80", "\xF4\x8F\xBF\xBF", "\xF0\x9F\x98\x80"};
+    std::vector<std::string> utf16 = {std::string("\0a", 2), std::string("\0 \0b", 4), std::string("\0\xE9", 2), "\x20\xAC",
+                                      std::string("\xD8\x3D\xDE\0", 4)};
+    // Overlong, out of range, truncated and lone continuation bytes are decoded and replaced
+    std::vector<std::string> utf8Broken = {"\xC0\x80", "\xC1\xBF", "\xE0\x80\x80", "\xE0\x9F\xBF", "\xF0\x80\x80\x80", "\xF0\x8F\xBF\xBF",
+                                           "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\x80", "\xBF", "\xC3", "\xE2\x82", "\xF0\x9F\x98",
+                                           "\xFE", "\xC3\x28"};
+
+    struct TestCase {
+        uint64_t charsetId;
+        const std::vector<std::string>* pieces;
+    };
+    std::vector<TestCase> testCases = {{CHARSET_US7ASCII, &bytes8bit}, {CHARSET_WE8HP, &bytes8bit}, {CHARSET_WE8ISO8859P1, &bytes8bit},
+                                       {CHARSET_WE8MSWIN1252, &bytes8bit}, {CHARSET_JA16SJIS, &sjis},
+                                       {CHARSET_AL32UTF8, &utf8}, {CHARSET_AL32UTF8, &ascii}, {CHARSET_AL16UTF16, &utf16}};
+
+    for (const TestCase& testCase : testCases) {
+        CharacterSet* characterSet = locales.characterMap[testCase.charsetId];
+        std::vector<std::string> values;
+        if (testCase.pieces == &bytes8bit)
+            values.push_back(all8bit);
+        for (uint64_t i = 0; i < 200; ++i)
+            values.push_back(randomText(random, *testCase.pieces));
+
+        for (const std::string& value : values) {
+            std::string text = builder->parse(value, testCase.charsetId);
+            if (text != referenceDecode(characterSet, value)) {
+                std::cerr << "character set: " << characterSet->name << " value of " << std::dec << value.length() <<
+                        " bytes converted differently than one character at a time" << std::endl;
+                ok = false;
+            }
+            ++checked;
+        }
+    }
+
+    // Invalid sequences of AL32UTF8 between valid text give the same replacement characters
+    CharacterSet* characterSetAL32UTF8 = locales.characterMap[CHARSET_AL32UTF8];
+    for (const std::string& broken : utf8Broken) {
+        std::string value = "valid text \xC3\xA9 before " + broken + " and \xE2\x82\xAC after";
+        std::string text = builder->parse(value, CHARSET_AL32UTF8);
+        if (text != referenceDecode(characterSetAL32UTF8, value)) {
+            std::cerr << "character set: AL32UTF8 broken sequence of " << std::dec << broken.length() <<
+                    " bytes converted differently than one character at a time" << std::endl;
+            ok = false;
+        }
+        ++checked;
+    }
+
+    // Limit is checked on the converted value, long plain text fits up to the size of the value buffer
+    std::string longAscii(MAX_FIELD_LENGTH, 'a');
+    std::string longUtf8;
+    for (uint64_t i = 0; i < MAX_FIELD_LENGTH / 2; ++i)
+        longUtf8 += "\xC3\xA9";
+    for (uint64_t charsetId : {CHARSET_AL32UTF8, CHARSET_WE8ISO8859P1, CHARSET_US7ASCII}) {
+        if (builder->parse(longAscii, charsetId) != longAscii) {
+            std::cerr << "character set: " << locales.characterMap[charsetId]->name << " value of " << std::dec << longAscii.length() <<
+                    " bytes not converted" << std::endl;
+            ok = false;
+        }
+    }
+    if (builder->parse(longUtf8, CHARSET_AL32UTF8) != longUtf8) {
+        std::cerr << "character set: AL32UTF8 value of " << std::dec << longUtf8.length() << " bytes not converted" << std::endl;
+        ok = false;
+    }
+
+    // Value which doesn't fit, also when only the last character is too long
+    std::string tooLongAscii = longAscii + "a";
+    std::string tooLongUtf8 = std::string(MAX_FIELD_LENGTH - 1, 'a') + "\xC3\xA9";
+    std::string tooLong8bit = std::string(MAX_FIELD_LENGTH - 1, 'a') + "\xE9";
+    std::vector<std::pair<uint64_t, const std::string*>> tooLongValues = {{CHARSET_AL32UTF8, &tooLongAscii}, {CHARSET_AL32UTF8, &tooLongUtf8},
+                                                                           {CHARSET_WE8ISO8859P1, &tooLong8bit}, {CHARSET_US7ASCII, &tooLongAscii},
+                                                                           {CHARSET_JA16SJIS, &tooLong8bit}};
+    for (auto& tooLongValue : tooLongValues) {
+        bool failed = false;
+        try {
+            builder->parse(*tooLongValue.second, tooLongValue.first);
+        } catch (RuntimeException&) {
+            failed = true;
+        }
+        if (!failed) {
+            std::cerr << "character set: " << locales.characterMap[tooLongValue.first]->name << " value of " << std::dec <<
+                    tooLongValue.second->length() << " bytes exceeding the limit accepted" << std::endl;
+            ok = false;
+        }
+    }
+    delete builder;
+
+    std::cout << "character set: " << std::dec << checked << " values checked" << (ok ? "" : ", FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
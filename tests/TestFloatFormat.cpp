@@ -0,0 +1,113 @@
+/* Test and benchmark of BINARY_FLOAT and BINARY_DOUBLE text form
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#include "../src/builder/BuilderJson.h"
+#include "../src/common/Timer.h"
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+// Text must read back to the same bits
+template<class T, class B>
+bool roundTrip(B bits, uint64_t& checked) {
+    T value;
+    memcpy((void*)&value, (void*)&bits, sizeof(value));
+    if (!std::isfinite(value))
+        return true;
+
+    char buffer[FLOAT_BUFFER_LENGTH + 1];
+    uint64_t length = BuilderJson::formatFloat(buffer, value);
+    buffer[length] = 0;
+
+    T valueRead;
+    if (sizeof(T) == sizeof(float))
+        valueRead = strtof(buffer, nullptr);
+    else
+        valueRead = strtod(buffer, nullptr);
+    B bitsRead;
+    memcpy((void*)&bitsRead, (void*)&valueRead, sizeof(bitsRead));
+    ++checked;
+
+    if (bitsRead != bits) {
+        std::cerr << "float format: " << std::hex << (uint64_t)bits << " written as " << buffer << " reads back as " << (uint64_t)bitsRead << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template<class T>
+uint64_t bench(const T* values, uint64_t count) {
+    char buffer[FLOAT_BUFFER_LENGTH];
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < count; ++i)
+        total += BuilderJson::formatFloat(buffer, values[i]);
+    return total;
+}
+
+// Usage: TestFloatFormat [values]
+int main(int argc, char** argv) {
+    uint64_t count = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 1000000;
+    std::mt19937_64 random(20221019);
+    uint64_t checked = 0;
+    bool ok = true;
+
+    // Edge values: zeros, denormals, limits, powers of ten
+    const uint32_t floatEdges[] = {0x00000000, 0x80000000, 0x00000001, 0x007FFFFF, 0x00800000, 0x7F7FFFFF, 0xFF7FFFFF, 0x3F800000, 0x3DCCCCCD,
+                                   0x4B189680};
+    const uint64_t doubleEdges[] = {0x0000000000000000, 0x8000000000000000, 0x0000000000000001, 0x000FFFFFFFFFFFFF, 0x0010000000000000,
+                                    0x7FEFFFFFFFFFFFFF, 0xFFEFFFFFFFFFFFFF, 0x3FF0000000000000, 0x3FB999999999999A, 0x4415AF1D78B58C40};
+    for (uint32_t bits : floatEdges)
+        ok &= roundTrip<float>(bits, checked);
+    for (uint64_t bits : doubleEdges)
+        ok &= roundTrip<double>(bits, checked);
+
+    auto* floats = new float[count];
+    auto* doubles = new double[count];
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t bits = random();
+        auto bits32 = (uint32_t)bits;
+        ok &= roundTrip<float>(bits32, checked);
+        ok &= roundTrip<double>(bits, checked);
+        memcpy((void*)(floats + i), (void*)&bits32, sizeof(float));
+        memcpy((void*)(doubles + i), (void*)&bits, sizeof(double));
+    }
+
+    time_t start = Timer::getTime();
+    uint64_t floatLength = bench(floats, count);
+    time_t middle = Timer::getTime();
+    uint64_t doubleLength = bench(doubles, count);
+    time_t end = Timer::getTime();
+    delete[] floats;
+    delete[] doubles;
+
+#ifdef HAS_FLOAT_TO_CHARS
+    std::cout << "float format (to_chars): ";
+#else
+    std::cout << "float format (snprintf): ";
+#endif
+    std::cout << checked << " values read back, float: " << (middle - start) << " us, " << (floatLength / (count > 0 ? count : 1)) <<
+            " chars/value, double: " << (end - middle) << " us, " << (doubleLength / (count > 0 ? count : 1)) << " chars/value" << std::endl;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+/* Test of JSON value encoding at output buffer boundaries
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../src/builder/BuilderJson.h"
+#include "../src/common/Ctx.h"
+
+// Distances of value start from the end of output buffer
+#define TEST_BOUNDARY_MAX                       40
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+class TestBuilder : public BuilderJson {
+public:
+    explicit TestBuilder(Ctx* newCtx) :
+            BuilderJson(newCtx, nullptr, nullptr, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0) {
+    }
+
+    // Output starts the given number of bytes before the end of the first buffer
+    void fill(uint64_t boundary) {
+        std::string filler(OUTPUT_BUFFER_DATA_SIZE - boundary, 'x');
+        builderAppend(filler);
+    }
+
+    void escape(const std::string& value) {
+        appendEscape(value.c_str(), value.length());
+    }
+
+    void rawHex(const std::string& value) {
+        appendRawHex((const uint8_t*)value.data(), value.length());
+    }
+
+    void rawBase64(const std::string& value) {
+        appendRawBase64((const uint8_t*)value.data(), value.length());
+    }
+
+    // Written bytes after the filler, the message continues in next buffers
+    [[nodiscard]] std::string output(uint64_t boundary) const {
+        std::string text;
+        uint64_t start = OUTPUT_BUFFER_DATA_SIZE - boundary;
+        for (BuilderQueue* curBuffer = firstBuffer; curBuffer != nullptr; curBuffer = curBuffer->next) {
+            text.append((const char*)curBuffer->data + start, curBuffer->length - start);
+            start = 0;
+        }
+        return text;
+    }
+};
+
+// Escaping of one character at a time, as before runs of plain characters were copied at once
+static std::string referenceEscape(const std::string& value) {
+    std::string text;
+    for (char character : value) {
+        if (character == '\t')
+            text += "\\t";
+        else if (character == '\r')
+            text += "\\r";
+        else if (character == '\n')
+            text += "\\n";
+        else if (character == '\f')
+            text += "\\f";
+        else if (character == '\b')
+            text += "\\b";
+        else if (character == 0)
+            text += "\\u0000";
+        else {
+            if (character == '"' || character == '\\' || character == '/')
+                text += '\\';
+            text += character;
+        }
+    }
+    return text;
+}
+
+static std::string referenceHex(const std::string& value) {
+    static const char digits[] = "0123456789abcdef";
+    std::string text;
+    for (char character : value) {
+        text += digits[(uint8_t)character >> 4];
+        text += digits[(uint8_t)character & 0x0F];
+    }
+    return text;
+}
+
+// Base64 with padding, RFC 4648
+static std::string referenceBase64(const std::string& value) {
+    static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string text;
+    for (uint64_t i = 0; i < value.length(); i += 3) {
+        uint64_t group = ((uint64_t)(uint8_t)value[i]) << 16;
+        if (i + 1 < value.length())
+            group |= ((uint64_t)(uint8_t)value[i + 1]) << 8;
+        if (i + 2 < value.length())
+            group |= (uint8_t)value[i + 2];
+        text += digits[(group >> 18) & 0x3F];
+        text += digits[(group >> 12) & 0x3F];
+        text += (i + 1 < value.length()) ? digits[(group >> 6) & 0x3F] : '=';
+        text += (i + 2 < value.length()) ? digits[group & 0x3F] : '=';
+    }
+    return text;
+}
+
+int main() {
+    Ctx ctx;
+    ctx.initialize(32, 1024, 0);
+    std::mt19937_64 random(1);
+    bool ok = true;
+
+    // Plain runs around the 16 byte scan step with a character to escape at the edges, and random bytes of every value
+    std::vector<std::string> values = {"", "\"", "a\\b/c\td\re\nf\fg\bh"};
+    for (uint64_t length : {15, 16, 17, 31, 32, 33, 70}) {
+        values.emplace_back(length, 'p');
+        for (uint64_t pos : {(uint64_t)0, length / 2, length - 1}) {
+            std::string value(length, 'p');
+            value[pos] = (pos % 2 == 0) ? '"' : '\n';
+            values.push_back(value);
+        }
+    }
+    values.emplace_back(std::string("\0\0", 2));
+    for (uint64_t i = 0; i < 8; ++i) {
+        std::string value(1 + random() % 100, ' ');
+        for (char& character : value)
+            character = (char)random();
+        values.push_back(value);
+    }
+
+    // Known vectors of RFC 4648 and lengths around the 16 byte hex step and 3 byte base64 group
+    std::vector<std::string> rawValues = {"", "f", "fo", "foo", "foob", "fooba", "foobar", std::string("\0\xFF\x10\xEF", 4)};
+    for (uint64_t length : {15, 16, 17, 31, 32, 33, 47, 48, 49, 100}) {
+        std::string value(length, ' ');
+        for (char& character : value)
+            character = (char)random();
+        rawValues.push_back(value);
+    }
+
+    uint64_t checked = 0;
+    for (const char* encoding : {"escape", "hex", "base64"}) {
+        bool escape = (encoding[0] == 'e');
+        for (uint64_t boundary = 0; boundary <= TEST_BOUNDARY_MAX && ok; ++boundary) {
+            for (const std::string& value : escape ? values : rawValues) {
+                auto* builder = new TestBuilder(&ctx);
+                builder->initialize();
+                builder->fill(boundary);
+                std::string expected;
+                if (escape) {
+                    builder->escape(value);
+                    expected = referenceEscape(value);
+                } else if (encoding[0] == 'h') {
+                    builder->rawHex(value);
+                    expected = referenceHex(value);
+                } else {
+                    builder->rawBase64(value);
+                    expected = referenceBase64(value);
+                }
+                std::string text = builder->output(boundary);
+                delete builder;
+
+                if (text != expected) {
+                    std::cerr << "json append: " << encoding << " of " << std::dec << value.length() << " bytes at " << boundary <<
+                            " bytes before buffer end: \"" << text << "\", expected: \"" << expected << "\"" << std::endl;
+                    ok = false;
+                    break;
+                }
+                ++checked;
+            }
+        }
+    }
+
+    // Output of known vectors
+    if (referenceBase64("foobar") != "Zm9vYmFy" || referenceBase64("fooba") != "Zm9vYmE=" || referenceBase64("foob") != "Zm9vYg==" ||
+            referenceHex(std::string("\0\xFF\x10\xEF", 4)) != "00ff10ef") {
+        std::cerr << "json append: reference encoding differs from known vectors" << std::endl;
+        ok = false;
+    }
+
+    std::cout << "json append: " << std::dec << checked << " values checked" << (ok ? "" : ", FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
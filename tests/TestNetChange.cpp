@@ -0,0 +1,146 @@
+/* Test of net-change compaction of row changes
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "../src/builder/BuilderJson.h"
+#include "../src/common/Ctx.h"
+
+#define TEST_DATA_OBJ                           1000
+#define TEST_BDBA                               0x01000100
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+class TestBuilder : public BuilderJson {
+public:
+    explicit TestBuilder(Ctx* newCtx) :
+            BuilderJson(newCtx, nullptr, nullptr, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0) {
+    }
+
+    // Same as a row of processDml, one column in schemaless form, rows without rowid are not merged
+    void row(uint64_t type, typeDba bdba, typeSlot slot, const std::string& before, const std::string& after) {
+        if (type != TRANSACTION_INSERT)
+            netRowValue(0, VALUE_BEFORE, before);
+        if (type != TRANSACTION_DELETE)
+            netRowValue(0, VALUE_AFTER, after);
+        processRow(type, nullptr, TEST_DATA_OBJ, bdba, slot, lastXid);
+        valuesRelease();
+    }
+};
+
+// Operation and column values of every message: "c:A1", "u:C0>C2", "d:D0", markers as "begin" or "commit"
+static std::vector<std::string> readMessages(Builder* builder) {
+    std::vector<std::string> messages;
+    BuilderQueue* curBuffer = builder->getFirstBuffer();
+    uint64_t curLength = 0;
+
+    while (true) {
+        if (curBuffer->next != nullptr && curBuffer->length == curLength) {
+            curBuffer = curBuffer->next;
+            curLength = 0;
+        }
+
+        auto* msg = (BuilderMsg*)(curBuffer->data + curLength);
+        if (curBuffer->length <= curLength + sizeof(struct BuilderMsg) || msg->length == 0)
+            return messages;
+        curLength += sizeof(struct BuilderMsg) + ((msg->ownerLength + msg->tableLength + msg->keyLength + 7) & 0xFFFFFFFFFFFFFFF8);
+        std::string text((const char*)curBuffer->data + curLength, msg->length);
+        curLength += (msg->length + 7) & 0xFFFFFFFFFFFFFFF8;
+
+        uint64_t pos = text.find(R"("op":")");
+        std::string op = text.substr(pos + 6, text.find('"', pos + 6) - pos - 6);
+        std::string values;
+        for (const char* image : {R"("before":{"COL_0":")", R"("after":{"COL_0":")"}) {
+            uint64_t valuePos = text.find(image);
+            if (valuePos == std::string::npos)
+                continue;
+            valuePos += strlen(image);
+            if (!values.empty())
+                values += ">";
+            // Columns of schemaless rows are written in hex
+            std::string hex = text.substr(valuePos, text.find('"', valuePos) - valuePos);
+            for (uint64_t i = 0; i + 1 < hex.length(); i += 2)
+                values.push_back((char)std::stoi(hex.substr(i, 2), nullptr, 16));
+        }
+        messages.push_back(values.empty() ? op : op + ":" + values);
+    }
+}
+
+int main() {
+    Ctx ctx;
+    ctx.initialize(32, 1024, 0);
+    auto* builder = new TestBuilder(&ctx);
+    builder->initialize();
+    builder->setNetChange(true);
+    bool ok = true;
+
+    builder->processBegin(100, typeTime(0), 1, typeXid((uint64_t)0x0001000200000003), false);
+    // Insert + update = insert with the newest values
+    builder->row(TRANSACTION_INSERT, TEST_BDBA, 1, "", "A1");
+    // Insert + delete = nothing
+    builder->row(TRANSACTION_INSERT, TEST_BDBA, 2, "", "B1");
+    // Update + update = update from the oldest to the newest values
+    builder->row(TRANSACTION_UPDATE, TEST_BDBA, 3, "C0", "C1");
+    builder->row(TRANSACTION_UPDATE, TEST_BDBA, 1, "A1", "A2");
+    builder->row(TRANSACTION_DELETE, TEST_BDBA, 2, "B1", "");
+    // Update + delete = delete of the oldest values
+    builder->row(TRANSACTION_UPDATE, TEST_BDBA, 4, "D0", "D1");
+    builder->row(TRANSACTION_UPDATE, TEST_BDBA, 3, "C1", "C2");
+    builder->row(TRANSACTION_DELETE, TEST_BDBA, 4, "D1", "");
+    // Delete + insert is not merged
+    builder->row(TRANSACTION_DELETE, TEST_BDBA, 5, "E0", "");
+    builder->row(TRANSACTION_INSERT, TEST_BDBA, 5, "", "E1");
+    // Rows without rowid are not merged
+    builder->row(TRANSACTION_INSERT, 0, 0, "", "F1");
+    builder->row(TRANSACTION_UPDATE, 0, 0, "F1", "F2");
+
+    // Nothing is sent before commit, collected rows are counted in the size of the message
+    if (!readMessages(builder).empty() || builder->getNetSize() == 0 || builder->builderSize() < builder->getNetSize()) {
+        std::cerr << "net change: rows sent before commit or not counted, collected: " << builder->getNetSize() << " bytes, builder size: " <<
+                builder->builderSize() << std::endl;
+        ok = false;
+    }
+
+    builder->processCommit(false);
+    std::vector<std::string> messages = readMessages(builder);
+    std::vector<std::string> expected = {"begin", "c:A2", "u:C0>C2", "d:D0", "d:E0", "c:E1", "c:F1", "u:F1>F2", "commit"};
+    if (messages != expected) {
+        std::cerr << "net change: messages:";
+        for (const std::string& message : messages)
+            std::cerr << " " << message;
+        std::cerr << ", expected:";
+        for (const std::string& message : expected)
+            std::cerr << " " << message;
+        std::cerr << std::endl;
+        ok = false;
+    }
+
+    if (builder->getNetSize() != 0) {
+        std::cerr << "net change: " << builder->getNetSize() << " bytes left after commit" << std::endl;
+        ok = false;
+    }
+    delete builder;
+
+    std::cout << "net change: " << (ok ? "rows merged correctly" : "rows merged incorrectly") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+/* Test and benchmark of NUMBER decoding to text
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../src/builder/BuilderJson.h"
+#include "../src/common/Ctx.h"
+#include "../src/common/Timer.h"
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+class TestBuilder : public BuilderJson {
+public:
+    explicit TestBuilder(Ctx* newCtx) :
+            BuilderJson(newCtx, nullptr, nullptr, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0) {
+    }
+
+    uint64_t number(const uint8_t* data, uint64_t length) {
+        parseNumber(data, length);
+        return valueLength;
+    }
+
+    [[nodiscard]] std::string value() const {
+        return std::string(valueBuffer, valueLength);
+    }
+};
+
+// Oracle NUMBER: exponent byte and base 100 digits, negative numbers are complemented and end with 0x66
+static uint64_t encodeNumber(const std::string& text, uint8_t* data) {
+    if (text == "0") {
+        data[0] = 0x80;
+        return 1;
+    }
+
+    bool negative = (text[0] == '-');
+    std::string digits = text.substr(negative ? 1 : 0);
+    std::string integer = digits.substr(0, digits.find('.'));
+    std::string fraction = (digits.find('.') != std::string::npos) ? digits.substr(digits.find('.') + 1) : "";
+    if (integer == "0")
+        integer.clear();
+    if (integer.length() % 2 == 1)
+        integer = "0" + integer;
+    if (fraction.length() % 2 == 1)
+        fraction += "0";
+
+    std::vector<uint64_t> pairs;
+    for (uint64_t i = 0; i < integer.length(); i += 2)
+        pairs.push_back((integer[i] - '0') * 10 + (integer[i + 1] - '0'));
+    int64_t exponent = (int64_t)pairs.size();
+    for (uint64_t i = 0; i < fraction.length(); i += 2)
+        pairs.push_back((fraction[i] - '0') * 10 + (fraction[i + 1] - '0'));
+
+    // Leading zero pairs of fraction are moved to the exponent, trailing zero pairs are not stored
+    uint64_t first = 0;
+    while (exponent == 0 && first < pairs.size() && pairs[first] == 0)
+        ++first;
+    exponent -= (int64_t)first;
+    while (pairs.size() > first && pairs.back() == 0)
+        pairs.pop_back();
+
+    uint64_t length = 0;
+    data[length++] = negative ? (uint8_t)(0x3F - exponent) : (uint8_t)(0xC0 + exponent);
+    for (uint64_t i = first; i < pairs.size(); ++i)
+        data[length++] = negative ? (uint8_t)(101 - pairs[i]) : (uint8_t)(pairs[i] + 1);
+    if (negative && length < 21)
+        data[length++] = 0x66;
+    return length;
+}
+
+// Text in the form written by the builder: no leading zeros, no trailing zeros of fraction
+static std::string randomNumber(std::mt19937_64& random) {
+    std::string text;
+    if (random() % 2 == 0)
+        text.push_back('-');
+    uint64_t integerLength = random() % 21;
+    uint64_t fractionLength = random() % (39 - integerLength);
+    if (integerLength + fractionLength == 0)
+        return "0";
+
+    if (integerLength == 0)
+        text.push_back('0');
+    for (uint64_t i = 0; i < integerLength; ++i)
+        text += (char)('0' + (i == 0 ? 1 + random() % 9 : random() % 10));
+    if (fractionLength > 0) {
+        text.push_back('.');
+        for (uint64_t i = 0; i < fractionLength; ++i)
+            text += (char)('0' + (i == fractionLength - 1 ? 1 + random() % 9 : random() % 10));
+    }
+    return text;
+}
+
+// Usage: TestNumberFormat [values] [rounds]
+int main(int argc, char** argv) {
+    uint64_t count = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 200000;
+    uint64_t rounds = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 20;
+    std::mt19937_64 random(20221019);
+
+    Ctx ctx;
+    auto* builder = new TestBuilder(&ctx);
+    bool ok = true;
+
+    std::vector<std::string> texts = {"0", "1", "-1", "100", "-100", "0.01", "-0.01", "0.1", "0.000001", "-0.000001", "123456789012345678901234567890",
+                                      "99999999999999999999999999999999999999", "-99999999999999999999999999999999999999", "0.00000000000000000000000000000000000001"};
+    for (uint64_t i = 0; i < count; ++i)
+        texts.push_back(randomNumber(random));
+
+    std::vector<uint8_t> data(texts.size() * 22);
+    std::vector<uint64_t> lengths(texts.size());
+    for (uint64_t i = 0; i < texts.size(); ++i) {
+        lengths[i] = encodeNumber(texts[i], data.data() + i * 22);
+        builder->number(data.data() + i * 22, lengths[i]);
+        if (builder->value() != texts[i]) {
+            std::cerr << "number format: " << texts[i] << " decoded as " << builder->value() << std::endl;
+            ok = false;
+        }
+    }
+
+    uint64_t total = 0;
+    time_t start = Timer::getTime();
+    for (uint64_t round = 0; round < rounds; ++round)
+        for (uint64_t i = 0; i < texts.size(); ++i)
+            total += builder->number(data.data() + i * 22, lengths[i]);
+    time_t end = Timer::getTime();
+    delete builder;
+
+    uint64_t numbers = rounds * texts.size();
+    std::cout << "number format: " << texts.size() << " values checked, " << numbers << " decoded in " << (end - start) << " us, " <<
+            ((end > start) ? (numbers * 1000 / (end - start)) : 0) << " values/ms, " << (total / (numbers > 0 ? numbers : 1)) << " chars/value" << std::endl;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+/* Test and benchmark of timestamp conversion to epoch and ISO 8601 text
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include "../src/builder/BuilderJson.h"
+#include "../src/common/Ctx.h"
+#include "../src/common/Timer.h"
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+class TestBuilder : public BuilderJson {
+public:
+    explicit TestBuilder(Ctx* newCtx) :
+            BuilderJson(newCtx, nullptr, nullptr, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0) {
+    }
+
+    using Builder::daysFromCivil;
+
+    uint64_t timestamp(struct tm& epochTime, uint64_t fraction) {
+        valueBufferTimestamp(epochTime, fraction, nullptr);
+        return valueLength;
+    }
+
+    [[nodiscard]] std::string value() const {
+        return std::string(valueBuffer, valueLength);
+    }
+};
+
+// Usage: TestTimestampFormat [rounds]
+int main(int argc, char** argv) {
+    uint64_t rounds = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 2;
+
+    Ctx ctx;
+    auto* builder = new TestBuilder(&ctx);
+    bool ok = true;
+
+    // Every day from 1900 to 9999, month of struct tm is 1..12 and year is not reduced by 1900
+    std::vector<struct tm> days;
+    struct tm day = {};
+    day.tm_year = 0;
+    day.tm_mday = 1;
+    day.tm_hour = 13;
+    day.tm_min = 5;
+    day.tm_sec = 7;
+    for (time_t epoch = -2208988800; ; epoch += 86400) {
+        struct tm dayGm = {};
+        gmtime_r(&epoch, &dayGm);
+        if (dayGm.tm_year + 1900 > 9999)
+            break;
+        day.tm_year = dayGm.tm_year + 1900;
+        day.tm_mon = dayGm.tm_mon + 1;
+        day.tm_mday = dayGm.tm_mday;
+        days.push_back(day);
+
+        if (TestBuilder::daysFromCivil(day.tm_year, day.tm_mon, day.tm_mday) * 86400 != epoch) {
+            std::cerr << "timestamp format: " << day.tm_year << "-" << day.tm_mon << "-" << day.tm_mday << " gives " <<
+                    TestBuilder::daysFromCivil(day.tm_year, day.tm_mon, day.tm_mday) << " days, expected: " << (epoch / 86400) << std::endl;
+            ok = false;
+        }
+
+        char expected[64];
+        snprintf(expected, sizeof(expected), "%04d-%02d-%02dT13:05:07.000012345", day.tm_year, day.tm_mon, day.tm_mday);
+        builder->timestamp(day, 12345);
+        if (builder->value() != expected) {
+            std::cerr << "timestamp format: " << expected << " written as " << builder->value() << std::endl;
+            ok = false;
+        }
+    }
+
+    // Library conversion as reference
+    int64_t sumLibrary = 0;
+    time_t start = Timer::getTime();
+    for (uint64_t round = 0; round < rounds; ++round) {
+        for (struct tm& dayLibrary : days) {
+            struct tm dayGm = dayLibrary;
+            dayGm.tm_year -= 1900;
+            dayGm.tm_mon -= 1;
+            sumLibrary += timegm(&dayGm);
+        }
+    }
+    time_t middle = Timer::getTime();
+
+    int64_t sum = 0;
+    for (uint64_t round = 0; round < rounds; ++round)
+        for (struct tm& dayCivil : days)
+            sum += ((TestBuilder::daysFromCivil(dayCivil.tm_year, dayCivil.tm_mon, dayCivil.tm_mday) * 24 + dayCivil.tm_hour) * 60 +
+                    dayCivil.tm_min) * 60 + dayCivil.tm_sec;
+    time_t end = Timer::getTime();
+
+    uint64_t length = 0;
+    for (uint64_t round = 0; round < rounds; ++round)
+        for (struct tm& dayText : days)
+            length += builder->timestamp(dayText, 511000000);
+    time_t endText = Timer::getTime();
+    delete builder;
+
+    if (sum != sumLibrary) {
+        std::cerr << "timestamp format: sum of epochs: " << sum << ", expected: " << sumLibrary << std::endl;
+        ok = false;
+    }
+
+    uint64_t values = rounds * days.size();
+    std::cout << "timestamp format: " << days.size() << " days checked, " << values << " values, epoch: " << (end - middle) << " us (timegm: " <<
+            (middle - start) << " us), ISO 8601: " << (endText - end) << " us, " << (length / (values > 0 ? values : 1)) << " chars/value" << std::endl;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+/* Test of rollback compensation of streamed transactions
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "../src/builder/BuilderJson.h"
+#include "../src/common/Ctx.h"
+#include "../src/common/RedoLogRecord.h"
+#include "../src/metadata/Metadata.h"
+#include "../src/parser/Transaction.h"
+#include "../src/parser/TransactionBuffer.h"
+
+#define TEST_DATA_OBJ                           1000
+#define TEST_BDBA                               0x01000100
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+class TestBuilder : public BuilderJson {
+public:
+    TestBuilder(Ctx* newCtx, Metadata* newMetadata) :
+            BuilderJson(newCtx, nullptr, newMetadata, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0) {
+    }
+
+    // Same as a row of processDml, one column in schemaless form, ops is the number of row pieces
+    void row(uint64_t type, typeSlot slot, uint64_t ops, const std::string& before, const std::string& after, typeXid xid) {
+        if (type != TRANSACTION_INSERT)
+            netRowValue(0, VALUE_BEFORE, before);
+        if (type != TRANSACTION_DELETE)
+            netRowValue(0, VALUE_AFTER, after);
+        rowOps = ops;
+        processRow(type, nullptr, TEST_DATA_OBJ, TEST_BDBA, slot, xid);
+        valuesRelease();
+    }
+};
+
+// Operation and column values of every message: "c:AA", "u:B0>B1", "d:CC", markers as "begin", "commit" or "rollback"
+static std::vector<std::string> readMessages(Builder* builder) {
+    std::vector<std::string> messages;
+    BuilderQueue* curBuffer = builder->getFirstBuffer();
+    uint64_t curLength = 0;
+
+    while (true) {
+        if (curBuffer->next != nullptr && curBuffer->length == curLength) {
+            curBuffer = curBuffer->next;
+            curLength = 0;
+        }
+
+        auto* msg = (BuilderMsg*)(curBuffer->data + curLength);
+        if (curBuffer->length <= curLength + sizeof(struct BuilderMsg) || msg->length == 0)
+            return messages;
+        curLength += sizeof(struct BuilderMsg) + ((msg->ownerLength + msg->tableLength + msg->keyLength + 7) & 0xFFFFFFFFFFFFFFF8);
+        std::string text((const char*)curBuffer->data + curLength, msg->length);
+        curLength += (msg->length + 7) & 0xFFFFFFFFFFFFFFF8;
+
+        uint64_t pos = text.find(R"("op":")");
+        std::string op = text.substr(pos + 6, text.find('"', pos + 6) - pos - 6);
+        std::string values;
+        for (const char* image : {R"("before":{"COL_0":")", R"("after":{"COL_0":")"}) {
+            uint64_t valuePos = text.find(image);
+            if (valuePos == std::string::npos)
+                continue;
+            valuePos += strlen(image);
+            if (!values.empty())
+                values += ">";
+            // Columns of schemaless rows are written in hex
+            std::string hex = text.substr(valuePos, text.find('"', valuePos) - valuePos);
+            for (uint64_t i = 0; i + 1 < hex.length(); i += 2)
+                values.push_back((char)std::stoi(hex.substr(i, 2), nullptr, 16));
+        }
+        messages.push_back(values.empty() ? op : op + ":" + values);
+    }
+}
+
+static bool check(const char* name, const std::vector<std::string>& messages, const std::vector<std::string>& expected) {
+    if (messages == expected)
+        return true;
+
+    std::cerr << "transaction stream: " << name << ", messages:";
+    for (const std::string& message : messages)
+        std::cerr << " " << message;
+    std::cerr << ", expected:";
+    for (const std::string& message : expected)
+        std::cerr << " " << message;
+    std::cerr << std::endl;
+    return false;
+}
+
+// Rollback operation of a row piece as found in redo
+static void rollbackOp(Transaction& transaction, Metadata* metadata, Builder* builder, uint16_t opCode, typeDba bdba, typeSlot slot) {
+    RedoLogRecord redoLogRecord;
+    memset((void*)&redoLogRecord, 0, sizeof(redoLogRecord));
+    redoLogRecord.opCode = opCode;
+    redoLogRecord.dataObj = TEST_DATA_OBJ;
+    redoLogRecord.bdba = bdba;
+    redoLogRecord.slot = slot;
+    transaction.rollbackStreamedOp(metadata, builder, &redoLogRecord, 200, typeTime(0), 1);
+}
+
+// Part of the transaction sent like by Transaction::stream
+static void streamPart(Transaction& transaction, TestBuilder* builder, bool first) {
+    if (first)
+        builder->processBegin(100, typeTime(0), 1, transaction.xid, false);
+    else
+        builder->processContinue(100, typeTime(0), 1, transaction.xid);
+    transaction.streamed = true;
+    builder->setSentRows(&transaction.sentRows, &transaction.sentSize, false);
+}
+
+int main() {
+    Ctx ctx;
+    ctx.initialize(32, 1024, 0);
+    std::string database("TEST");
+    auto* metadata = new Metadata(&ctx, nullptr, database.c_str(), 0, ZERO_SCN, ZERO_SEQ, "", 0);
+    metadata->firstDataScn = 0;
+    TransactionBuffer transactionBuffer(&ctx);
+    bool ok = true;
+
+    // Stream, rollback to savepoint, commit
+    auto* builder = new TestBuilder(&ctx, metadata);
+    builder->initialize();
+    Transaction transaction(typeXid((uint64_t)0x0001000200000003));
+    streamPart(transaction, builder, true);
+    builder->row(TRANSACTION_INSERT, 1, 1, "", "AA", transaction.xid);
+    builder->row(TRANSACTION_UPDATE, 2, 2, "B0", "B1", transaction.xid);
+    builder->row(TRANSACTION_INSERT, 3, 1, "", "CC", transaction.xid);
+    builder->setSentRows(nullptr, nullptr, false);
+    builder->processPartial(false);
+    uint64_t sentSizeAll = transaction.sentSize;
+    if (transaction.sentRows.size() != 3 || sentSizeAll < 3 * sizeof(BuilderNetRow)) {
+        std::cerr << "transaction stream: " << transaction.sentRows.size() << " rows kept of size: " << sentSizeAll << std::endl;
+        ok = false;
+    }
+
+    // Insert of row 3 is reverted by delete, update of chained row 2 by 2 row pieces starting with the one in other block
+    rollbackOp(transaction, metadata, builder, 0x0B03, TEST_BDBA, 3);
+    rollbackOp(transaction, metadata, builder, 0x0B05, TEST_BDBA + 1, 7);
+    rollbackOp(transaction, metadata, builder, 0x0B05, TEST_BDBA, 2);
+    // Row which doesn't match the last sent one is not reverted, the kept rows stay in place
+    rollbackOp(transaction, metadata, builder, 0x0B03, TEST_BDBA, 9);
+    if (transaction.sentRows.size() != 1 || transaction.sentSize >= sentSizeAll || transaction.sentSize < sizeof(BuilderNetRow)) {
+        std::cerr << "transaction stream: after rollback " << transaction.sentRows.size() << " rows kept of size: " << transaction.sentSize << std::endl;
+        ok = false;
+    }
+
+    transaction.commitScn = 300;
+    transaction.flush(metadata, &transactionBuffer, builder);
+    ok &= check("commit", readMessages(builder), {"begin", "c:AA", "u:B0>B1", "c:CC", "d:CC", "u:B1>B0", "commit"});
+    transaction.purge(&transactionBuffer);
+    if (transaction.sentSize != 0 || !transaction.sentRows.empty()) {
+        std::cerr << "transaction stream: rows kept after purge: " << transaction.sentRows.size() << std::endl;
+        ok = false;
+    }
+    delete builder;
+
+    // Stream in two parts, rollback to savepoint in the first part, rollback of whole transaction
+    builder = new TestBuilder(&ctx, metadata);
+    builder->initialize();
+    Transaction transaction2(typeXid((uint64_t)0x0001000200000004));
+    streamPart(transaction2, builder, true);
+    builder->row(TRANSACTION_UPDATE, 4, 1, "D0", "D1", transaction2.xid);
+    builder->setSentRows(nullptr, nullptr, false);
+    builder->processPartial(false);
+    streamPart(transaction2, builder, false);
+    builder->row(TRANSACTION_DELETE, 5, 1, "EE", "", transaction2.xid);
+    builder->setSentRows(nullptr, nullptr, false);
+    builder->processPartial(false);
+
+    rollbackOp(transaction2, metadata, builder, 0x0B02, TEST_BDBA, 5);
+    rollbackOp(transaction2, metadata, builder, 0x0B05, TEST_BDBA, 4);
+    if (!transaction2.sentRows.empty() || transaction2.sentSize != 0) {
+        std::cerr << "transaction stream: after full rollback " << transaction2.sentRows.size() << " rows kept of size: " << transaction2.sentSize <<
+                std::endl;
+        ok = false;
+    }
+
+    transaction2.rollback = true;
+    transaction2.flush(metadata, &transactionBuffer, builder);
+    ok &= check("rollback", readMessages(builder), {"begin", "u:D0>D1", "d:EE", "c:EE", "u:D1>D0", "rollback"});
+    transaction2.purge(&transactionBuffer);
+    delete builder;
+    delete metadata;
+
+    std::cout << "transaction stream: " << (ok ? "compensation of rollback is correct" : "compensation of rollback failed") << std::endl;
+    return ok ? 0 : 1;
+}
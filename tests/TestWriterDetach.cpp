@@ -0,0 +1,196 @@
+/* Test of detaching of lagging writer from shared output buffers
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <cstring>
+#include <functional>
+#include <iostream>
+
+#include "../src/builder/BuilderJson.h"
+#include "../src/common/Ctx.h"
+#include "../src/metadata/Metadata.h"
+#include "../src/writer/Writer.h"
+
+#define TEST_MESSAGE_LENGTH                     1000
+#define TEST_MAX_LAG_MB                         2
+#define TEST_STALLED_MESSAGES                   10
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+class TestBuilder : public BuilderJson {
+public:
+    explicit TestBuilder(Ctx* newCtx) :
+            BuilderJson(newCtx, nullptr, nullptr, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0) {
+    }
+
+    void send(const char* data, uint64_t length) {
+        builderBegin(0);
+        builderAppend(data, length);
+        builderCommit(false);
+    }
+
+    [[nodiscard]] uint64_t getBuffersAllocated() const {
+        return buffersAllocated;
+    }
+};
+
+// Target which accepts messages, confirmations are given by the test
+class TestWriter : public Writer {
+protected:
+    void sendMessage(BuilderMsg* msg __attribute__((unused))) override {
+    }
+
+    [[nodiscard]] std::string getName() const override {
+        return "test:" + alias;
+    }
+
+    void pollQueue() override {
+    }
+
+public:
+    TestWriter(Ctx* newCtx, std::string newAlias, std::string& newDatabase, Builder* newBuilder, Metadata* newMetadata) :
+            Writer(newCtx, newAlias, newDatabase, newBuilder, newMetadata) {
+    }
+
+    // Same steps as Writer::mainLoop for a message read from the builder
+    BuilderMsg* send(BuilderMsg* msg) {
+        msg = queueMessage(msg);
+        createMessage();
+        sendMessage(msg);
+        return msg;
+    }
+
+    bool tryDetach() {
+        return detach();
+    }
+
+    [[nodiscard]] uint64_t getQueueSize() const {
+        return tmpQueueSize;
+    }
+
+    [[nodiscard]] uint64_t getState() const {
+        return reader->state;
+    }
+};
+
+// All committed messages after the given one, messages may continue in next buffers
+static void forEachMessage(BuilderQueue* curBuffer, uint64_t curLength, const std::function<void(BuilderMsg*)>& callback) {
+    while (true) {
+        if (curBuffer->next != nullptr && curBuffer->length == curLength) {
+            curBuffer = curBuffer->next;
+            curLength = 0;
+        }
+
+        auto* msg = (BuilderMsg*)(curBuffer->data + curLength);
+        if (curBuffer->length <= curLength + sizeof(struct BuilderMsg) || msg->length == 0)
+            return;
+
+        curLength += sizeof(struct BuilderMsg) + ((msg->ownerLength + msg->tableLength + msg->keyLength + 7) & 0xFFFFFFFFFFFFFFF8);
+        uint64_t remaining = msg->length;
+        while (remaining > 0) {
+            uint64_t part = curBuffer->length - curLength;
+            if (part > remaining)
+                part = remaining;
+            remaining -= part;
+
+            if (remaining > 0) {
+                curBuffer = curBuffer->next;
+                curLength = 0;
+            } else
+                curLength += (part + 7) & 0xFFFFFFFFFFFFFFF8;
+        }
+
+        // Confirmation releases buffers before the one where the message ends
+        callback(msg);
+    }
+}
+
+int main() {
+    Ctx ctx;
+    ctx.initialize(32, 1024, 0);
+    std::string database("TEST");
+    auto* metadata = new Metadata(&ctx, nullptr, database.c_str(), 0, ZERO_SCN, ZERO_SEQ, "", 0);
+    auto* builder = new TestBuilder(&ctx);
+    builder->initialize();
+    auto* live = new TestWriter(&ctx, "live", database, builder, metadata);
+    live->initialize();
+    auto* stalled = new TestWriter(&ctx, "stalled", database, builder, metadata);
+    stalled->setMaxLagMb(TEST_MAX_LAG_MB);
+    stalled->initialize();
+    bool ok = true;
+
+    char data[TEST_MESSAGE_LENGTH];
+    memset((void*)data, 'x', sizeof(data));
+    uint64_t count = (TEST_MAX_LAG_MB + 3) * MEMORY_CHUNK_SIZE / TEST_MESSAGE_LENGTH;
+    for (uint64_t i = 0; i < count; ++i)
+        builder->send(data, sizeof(data));
+    uint64_t buffersAll = builder->getBuffersAllocated();
+
+    // Stalled target accepts first messages and never confirms them, live target confirms everything
+    uint64_t sent = 0;
+    forEachMessage(builder->getFirstBuffer(), 0, [&](BuilderMsg* msg) {
+        if (sent++ < TEST_STALLED_MESSAGES)
+            stalled->send(msg);
+    });
+    forEachMessage(builder->getFirstBuffer(), 0, [&](BuilderMsg* msg) {
+        live->confirmMessage(live->send(msg));
+    });
+
+    // Lagging writer still holds the buffers referenced by its unconfirmed messages
+    if (stalled->getState() != BUILDER_READER_LAGGING || builder->getBuffersAllocated() != buffersAll) {
+        std::cerr << "writer detach: lagging writer state: " << std::dec << stalled->getState() << ", buffers: " << builder->getBuffersAllocated() <<
+                " of " << buffersAll << std::endl;
+        ok = false;
+    }
+
+    // Detach doesn't wait for confirmations, buffers confirmed by the live writer are released at once
+    if (!stalled->tryDetach() || stalled->getState() != BUILDER_READER_DETACHED || stalled->getQueueSize() != 0 ||
+            builder->getBuffersAllocated() > 2) {
+        std::cerr << "writer detach: detached writer state: " << std::dec << stalled->getState() << ", unconfirmed messages: " <<
+                stalled->getQueueSize() << ", buffers: " << builder->getBuffersAllocated() << std::endl;
+        ok = false;
+    }
+
+    // Buffers are released by the live writer alone
+    BuilderQueue* lastBuffer = builder->getFirstBuffer();
+    uint64_t lastLength = lastBuffer->length;
+    while (lastBuffer->next != nullptr) {
+        lastBuffer = lastBuffer->next;
+        lastLength = lastBuffer->length;
+    }
+    for (uint64_t i = 0; i < count; ++i)
+        builder->send(data, sizeof(data));
+    forEachMessage(lastBuffer, lastLength, [&](BuilderMsg* msg) {
+        live->confirmMessage(live->send(msg));
+    });
+    if (builder->getBuffersAllocated() > 2 || live->getState() != BUILDER_READER_ACTIVE) {
+        std::cerr << "writer detach: buffers not released after detach: " << std::dec << builder->getBuffersAllocated() << std::endl;
+        ok = false;
+    }
+
+    delete live;
+    delete stalled;
+    delete builder;
+    delete metadata;
+
+    std::cout << "writer detach: " << std::dec << count * 2 << " messages, lagging writer " << (ok ? "detached correctly" : "detach failed") <<
+            std::endl;
+    return ok ? 0 : 1;
+}
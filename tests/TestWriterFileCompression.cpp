@@ -0,0 +1,268 @@
+/* Test of compressed file output read back across file rotation
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+#ifdef LINK_LIBRARY_ZLIB
+#include <zlib.h>
+#endif /* LINK_LIBRARY_ZLIB */
+#ifdef LINK_LIBRARY_ZSTD
+#include <zstd.h>
+#endif /* LINK_LIBRARY_ZSTD */
+
+#include "../src/builder/BuilderJson.h"
+#include "../src/common/Ctx.h"
+#include "../src/metadata/Metadata.h"
+#include "../src/writer/WriterFile.h"
+#include "../src/writer/WriterFileCompressor.h"
+
+#define TEST_MESSAGES                           1000
+#define TEST_MAX_SIZE                           (32 * 1024)
+// Batches shorter than the file, every file is made of many flushed blocks of one frame
+#define TEST_BATCH_MESSAGES                     50
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+class TestBuilder : public BuilderJson {
+public:
+    explicit TestBuilder(Ctx* newCtx) :
+            BuilderJson(newCtx, nullptr, nullptr, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0) {
+    }
+
+    void send(const std::string& data) {
+        builderBegin(0);
+        builderAppend(data.c_str(), data.length());
+        builderCommit(false);
+    }
+};
+
+class TestWriterFile : public WriterFile {
+public:
+    TestWriterFile(Ctx* newCtx, std::string& newDatabase, Builder* newBuilder, Metadata* newMetadata, const char* newOutput, uint64_t newCompression) :
+            WriterFile(newCtx, "test", newDatabase, newBuilder, newMetadata, newOutput, "", TEST_MAX_SIZE, 1, 0, 0, 0, newCompression, 0, 0, 0) {
+    }
+
+    // Same steps as Writer::mainLoop for a message read from the builder, messages of the test fit in one buffer
+    void send(BuilderMsg* msg, uint64_t num) {
+        msg = queueMessage(msg);
+        createMessage();
+        sendMessage(msg);
+        if ((num + 1) % TEST_BATCH_MESSAGES == 0)
+            writeBatch();
+    }
+
+    // Same steps as WriterFile::run at shutdown
+    void finish() {
+        flush();
+        closeFile();
+        compressor->stop();
+        ctx->finishThread(compressor);
+    }
+
+    [[nodiscard]] uint64_t getConfirmedMessages() const {
+        return confirmedMessages;
+    }
+};
+
+static bool readFile(const std::string& fileName, std::string& data) {
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    std::ostringstream content;
+    content << file.rdbuf();
+    data = content.str();
+    return true;
+}
+
+// Content of file of one complete frame, frames are counted
+static bool decompress(uint64_t compression, const std::string& input, std::string& output, uint64_t& frames) {
+    std::vector<char> buffer(64 * 1024);
+    output.clear();
+    frames = 0;
+
+#ifdef LINK_LIBRARY_ZLIB
+    if (compression == WRITER_FILE_COMPRESSION_GZIP) {
+        z_stream zStream;
+        memset((void*)&zStream, 0, sizeof(zStream));
+        if (inflateInit2(&zStream, 15 + 16) != Z_OK)
+            return false;
+        zStream.next_in = (Bytef*)input.data();
+        zStream.avail_in = input.length();
+        int ret = Z_OK;
+        while (zStream.avail_in > 0) {
+            zStream.next_out = (Bytef*)buffer.data();
+            zStream.avail_out = buffer.size();
+            ret = inflate(&zStream, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END)
+                break;
+            output.append(buffer.data(), buffer.size() - zStream.avail_out);
+            if (ret == Z_STREAM_END) {
+                ++frames;
+                inflateReset(&zStream);
+            }
+        }
+        inflateEnd(&zStream);
+        return ret == Z_STREAM_END;
+    }
+#endif /* LINK_LIBRARY_ZLIB */
+
+#ifdef LINK_LIBRARY_ZSTD
+    if (compression == WRITER_FILE_COMPRESSION_ZSTD) {
+        ZSTD_DCtx* zstdCtx = ZSTD_createDCtx();
+        ZSTD_inBuffer in = {input.data(), input.length(), 0};
+        size_t ret = 1;
+        while (in.pos < in.size) {
+            ZSTD_outBuffer out = {buffer.data(), buffer.size(), 0};
+            ret = ZSTD_decompressStream(zstdCtx, &out, &in);
+            if (ZSTD_isError(ret))
+                break;
+            output.append(buffer.data(), out.pos);
+            if (ret == 0)
+                ++frames;
+        }
+        ZSTD_freeDCtx(zstdCtx);
+        return ret == 0;
+    }
+#endif /* LINK_LIBRARY_ZSTD */
+
+    return false;
+}
+
+static bool testCompression(Ctx& ctx, uint64_t compression, const std::string& output, const std::vector<std::string>& messages) {
+    std::string database("TEST");
+    auto* metadata = new Metadata(&ctx, nullptr, database.c_str(), 0, ZERO_SCN, ZERO_SEQ, "", 0);
+    auto* builder = new TestBuilder(&ctx);
+    builder->initialize();
+    auto* writer = new TestWriterFile(&ctx, database, builder, metadata, output.c_str(), compression);
+    writer->initialize();
+    bool ok = true;
+
+    for (const std::string& message : messages)
+        builder->send(message);
+
+    BuilderQueue* curBuffer = builder->getFirstBuffer();
+    uint64_t curLength = 0;
+    for (uint64_t i = 0; i < messages.size(); ++i) {
+        auto* msg = (BuilderMsg*)(curBuffer->data + curLength);
+        curLength += sizeof(struct BuilderMsg) + ((msg->ownerLength + msg->tableLength + msg->keyLength + 7) & 0xFFFFFFFFFFFFFFF8) +
+                ((msg->length + 7) & 0xFFFFFFFFFFFFFFF8);
+        writer->send(msg, i);
+    }
+    writer->finish();
+
+    if (writer->getConfirmedMessages() != messages.size()) {
+        std::cerr << "writer file compression: " << std::dec << writer->getConfirmedMessages() << " messages confirmed of " << messages.size() <<
+                std::endl;
+        ok = false;
+    }
+    delete writer;
+    delete builder;
+    delete metadata;
+
+    // Files are rotated by size of uncompressed output, same as without compression
+    std::vector<std::string> expectedFiles(1);
+    for (const std::string& message : messages) {
+        if (expectedFiles.back().length() + message.length() + 1 > TEST_MAX_SIZE)
+            expectedFiles.emplace_back();
+        expectedFiles.back() += message + "\n";
+    }
+    if (expectedFiles.size() < 2) {
+        std::cerr << "writer file compression: output doesn't cross file rotation" << std::endl;
+        ok = false;
+    }
+
+    // Every file is one complete frame which can be decompressed alone
+    for (uint64_t i = 0; i < expectedFiles.size(); ++i) {
+        std::string fileName(output);
+        fileName.replace(fileName.find("%i"), 2, std::to_string(i));
+        std::string compressed;
+        std::string decompressed;
+        uint64_t frames;
+        if (!readFile(fileName, compressed)) {
+            std::cerr << "writer file compression: file " << fileName << " not written" << std::endl;
+            ok = false;
+            continue;
+        }
+        unlink(fileName.c_str());
+
+        if (!decompress(compression, compressed, decompressed, frames) || frames != 1) {
+            std::cerr << "writer file compression: file " << fileName << " is not one complete frame, frames: " << std::dec << frames << std::endl;
+            ok = false;
+        } else if (decompressed != expectedFiles[i]) {
+            std::cerr << "writer file compression: file " << fileName << " content differs, " << std::dec << decompressed.length() <<
+                    " bytes, expected: " << expectedFiles[i].length() << std::endl;
+            ok = false;
+        }
+    }
+
+    std::string nextFile(output);
+    nextFile.replace(nextFile.find("%i"), 2, std::to_string(expectedFiles.size()));
+    if (access(nextFile.c_str(), F_OK) == 0) {
+        std::cerr << "writer file compression: unexpected file " << nextFile << std::endl;
+        unlink(nextFile.c_str());
+        ok = false;
+    }
+
+    std::cout << "writer file compression: " << output << ": " << std::dec << messages.size() << " messages in " << expectedFiles.size() << " files, " <<
+            (ok ? "read back correctly" : "read back failed") << std::endl;
+    return ok;
+}
+
+int main() {
+    // Output files are created in a new directory, the file name mask has no path
+    char dirTemplate[] = "TestWriterFileCompression.XXXXXX";
+    if (mkdtemp(dirTemplate) == nullptr || chdir(dirTemplate) != 0) {
+        std::cerr << "writer file compression: can't create directory: " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    Ctx ctx;
+    ctx.initialize(32, 1024, 0);
+    bool ok = true;
+
+    // Messages of different length and content
+    std::vector<std::string> messages;
+    for (uint64_t i = 0; i < TEST_MESSAGES; ++i) {
+        std::string value;
+        for (uint64_t j = 0; j < (i * 7) % 97 + 50; ++j)
+            value.push_back((char)('a' + (i + j * j) % 26));
+        messages.push_back(R"({"n":)" + std::to_string(i) + R"(,"v":")" + value + R"("})");
+    }
+
+#ifdef LINK_LIBRARY_ZLIB
+    if (!testCompression(ctx, WRITER_FILE_COMPRESSION_GZIP, "test-%i.json.gz", messages))
+        ok = false;
+#endif /* LINK_LIBRARY_ZLIB */
+#ifdef LINK_LIBRARY_ZSTD
+    if (!testCompression(ctx, WRITER_FILE_COMPRESSION_ZSTD, "test-%i.json.zst", messages))
+        ok = false;
+#endif /* LINK_LIBRARY_ZSTD */
+
+    if (chdir("..") == 0)
+        rmdir(dirTemplate);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+/* Test of confirmation of file output after fdatasync
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/builder/BuilderJson.h"
+#include "../src/common/Ctx.h"
+#include "../src/metadata/Metadata.h"
+#include "../src/writer/WriterFile.h"
+#include "../src/writer/WriterFileCompressor.h"
+
+#define TEST_MESSAGE_LENGTH                     200
+#define TEST_FILE_MESSAGES                      10
+#define TEST_MESSAGES                           25
+// Interval of group commit longer than the test, messages are confirmed by rotation and final flush only
+#define TEST_FSYNC_INTERVAL_MS                  3600000
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+class TestBuilder : public BuilderJson {
+public:
+    explicit TestBuilder(Ctx* newCtx) :
+            BuilderJson(newCtx, nullptr, nullptr, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0) {
+    }
+
+    void send(const char* data, uint64_t length) {
+        builderBegin(0);
+        builderAppend(data, length);
+        builderCommit(false);
+    }
+};
+
+class TestWriterFile : public WriterFile {
+public:
+    TestWriterFile(Ctx* newCtx, std::string& newDatabase, Builder* newBuilder, Metadata* newMetadata, const char* newOutput) :
+            WriterFile(newCtx, "test", newDatabase, newBuilder, newMetadata, newOutput, "", TEST_FILE_MESSAGES * (TEST_MESSAGE_LENGTH + 1), 1, 1, 1,
+                       TEST_FSYNC_INTERVAL_MS, WRITER_FILE_COMPRESSION_NONE, 0, 0, 0) {
+    }
+
+    // Same steps as Writer::mainLoop for a message read from the builder, messages of the test fit in one buffer
+    void send(BuilderMsg* msg) {
+        msg = queueMessage(msg);
+        createMessage();
+        sendMessage(msg);
+    }
+
+    void finish() {
+        flush();
+        closeFile();
+    }
+
+    [[nodiscard]] uint64_t getConfirmedMessages() const {
+        return confirmedMessages;
+    }
+};
+
+// Every fdatasync of the writer: file, its size and messages confirmed before
+struct TestSync {
+    std::string file;
+    uint64_t size;
+    uint64_t confirmed;
+};
+
+static TestWriterFile* syncWriter = nullptr;
+static std::vector<TestSync> syncs;
+
+// Replaces the library call for the writer linked into the test
+extern "C" int fdatasync(int fd) {
+    char path[PATH_MAX];
+    std::string link("/proc/self/fd/" + std::to_string(fd));
+    int64_t length = readlink(link.c_str(), path, sizeof(path) - 1);
+    struct stat fileStat;
+    if (length < 0 || fstat(fd, &fileStat) != 0)
+        return -1;
+    path[length] = 0;
+
+    const char* name = strrchr(path, '/');
+    syncs.push_back({(name != nullptr) ? name + 1 : path, (uint64_t)fileStat.st_size, (syncWriter != nullptr) ? syncWriter->getConfirmedMessages() : 0});
+    return (int)syscall(SYS_fdatasync, fd);
+}
+
+int main() {
+    // Output files are created in a new directory, the file name mask has no path
+    char dirTemplate[] = "TestWriterFileSync.XXXXXX";
+    if (mkdtemp(dirTemplate) == nullptr || chdir(dirTemplate) != 0) {
+        std::cerr << "writer file sync: can't create directory: " << strerror(errno) << std::endl;
+        return 1;
+    }
+    std::string output("test-%i.json");
+    std::string database("TEST");
+
+    Ctx ctx;
+    ctx.initialize(32, 1024, 0);
+    auto* metadata = new Metadata(&ctx, nullptr, database.c_str(), 0, ZERO_SCN, ZERO_SEQ, "", 0);
+    auto* builder = new TestBuilder(&ctx);
+    builder->initialize();
+    auto* writer = new TestWriterFile(&ctx, database, builder, metadata, output.c_str());
+    writer->initialize();
+    syncWriter = writer;
+    bool ok = true;
+
+    char data[TEST_MESSAGE_LENGTH];
+    memset((void*)data, 'x', sizeof(data));
+    for (uint64_t i = 0; i < TEST_MESSAGES; ++i)
+        builder->send(data, sizeof(data));
+
+    BuilderQueue* curBuffer = builder->getFirstBuffer();
+    uint64_t curLength = 0;
+    uint64_t fileSize = TEST_FILE_MESSAGES * (TEST_MESSAGE_LENGTH + 1);
+    for (uint64_t i = 0; i < TEST_MESSAGES; ++i) {
+        auto* msg = (BuilderMsg*)(curBuffer->data + curLength);
+        curLength += sizeof(struct BuilderMsg) + ((msg->ownerLength + msg->tableLength + msg->keyLength + 7) & 0xFFFFFFFFFFFFFFF8) +
+                ((msg->length + 7) & 0xFFFFFFFFFFFFFFF8);
+        writer->send(msg);
+
+        // Messages of a file are confirmed when the next file is opened, after the sync of the whole file
+        uint64_t expected = (i / TEST_FILE_MESSAGES) * TEST_FILE_MESSAGES;
+        if (writer->getConfirmedMessages() != expected || syncs.size() != i / TEST_FILE_MESSAGES) {
+            std::cerr << "writer file sync: after message " << std::dec << i << " confirmed: " << writer->getConfirmedMessages() << ", expected: " <<
+                    expected << ", syncs: " << syncs.size() << std::endl;
+            ok = false;
+            break;
+        }
+    }
+    writer->finish();
+
+    // Rotation syncs the full file before any of its messages is confirmed, last file is synced by flush
+    std::vector<TestSync> expectedSyncs = {{"test-0.json", fileSize, 0}, {"test-1.json", fileSize, TEST_FILE_MESSAGES},
+                                           {"test-2.json", (TEST_MESSAGES - 2 * TEST_FILE_MESSAGES) * (TEST_MESSAGE_LENGTH + 1), 2 * TEST_FILE_MESSAGES}};
+    if (syncs.size() != expectedSyncs.size()) {
+        std::cerr << "writer file sync: " << std::dec << syncs.size() << " syncs, expected: " << expectedSyncs.size() << std::endl;
+        ok = false;
+    } else {
+        for (uint64_t i = 0; i < syncs.size(); ++i) {
+            if (syncs[i].file != expectedSyncs[i].file || syncs[i].size != expectedSyncs[i].size || syncs[i].confirmed != expectedSyncs[i].confirmed) {
+                std::cerr << "writer file sync: sync of " << syncs[i].file << " at " << std::dec << syncs[i].size << " bytes with " <<
+                        syncs[i].confirmed << " messages confirmed, expected: " << expectedSyncs[i].file << " at " << expectedSyncs[i].size <<
+                        " bytes with " << expectedSyncs[i].confirmed << std::endl;
+                ok = false;
+            }
+        }
+    }
+    if (writer->getConfirmedMessages() != TEST_MESSAGES) {
+        std::cerr << "writer file sync: " << std::dec << writer->getConfirmedMessages() << " messages confirmed after flush" << std::endl;
+        ok = false;
+    }
+    syncWriter = nullptr;
+
+    for (uint64_t i = 0; i < expectedSyncs.size(); ++i)
+        unlink(expectedSyncs[i].file.c_str());
+    if (chdir("..") == 0)
+        rmdir(dirTemplate);
+
+    delete writer;
+    delete builder;
+    delete metadata;
+
+    std::cout << "writer file sync: " << std::dec << TEST_MESSAGES << " messages, " << syncs.size() << " syncs, " <<
+            (ok ? "confirmed after sync" : "confirmed before sync") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+/* Test of stop of Kafka writer on failed delivery
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/builder/BuilderJson.h"
+#include "../src/common/Ctx.h"
+#include "../src/common/RuntimeException.h"
+#include "../src/metadata/Metadata.h"
+#include "../src/writer/WriterKafka.h"
+
+// No broker listens there, messages time out in librdkafka
+#define TEST_BROKERS                            "127.0.0.1:1"
+#define TEST_MESSAGE_TIMEOUT_MS                 "200"
+#define TEST_MESSAGE_MAX_BYTES                  "1000"
+#define TEST_MESSAGES                           3
+#define TEST_WAIT_MS                            10000
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+class TestBuilder : public BuilderJson {
+public:
+    explicit TestBuilder(Ctx* newCtx) :
+            BuilderJson(newCtx, nullptr, nullptr, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0) {
+    }
+
+    void send(const char* data, uint64_t length) {
+        builderBegin(0);
+        builderAppend(data, length);
+        builderCommit(false);
+    }
+};
+
+class TestWriterKafka : public WriterKafka {
+public:
+    TestWriterKafka(Ctx* newCtx, std::string& newDatabase, Builder* newBuilder, Metadata* newMetadata, std::map<std::string, std::string>& newProperties) :
+            WriterKafka(newCtx, "test", newDatabase, newBuilder, newMetadata, TEST_BROKERS, "test", "", 100000, false, newProperties, 0, 0) {
+    }
+
+    // Same steps as Writer::mainLoop for a message read from the builder
+    void send(BuilderMsg* msg) {
+        msg = queueMessage(msg);
+        createMessage();
+        sendMessage(msg);
+    }
+
+    // Delivery reports are served by the poller thread, the writer stops on the first failed one
+    bool waitForFailure(std::string& error) {
+        for (uint64_t i = 0; i < TEST_WAIT_MS / 10; ++i) {
+            try {
+                pollQueue();
+            } catch (RuntimeException& ex) {
+                error = ex.msg;
+                return true;
+            }
+            usleep(10000);
+        }
+        return false;
+    }
+
+    [[nodiscard]] uint64_t getConfirmedMessages() const {
+        return confirmedMessages;
+    }
+
+    [[nodiscard]] uint64_t getQueued() const {
+        return rd_kafka_outq_len(rk);
+    }
+};
+
+int main() {
+    Ctx ctx;
+    ctx.initialize(32, 1024, 0);
+    std::string database("TEST");
+    auto* metadata = new Metadata(&ctx, nullptr, database.c_str(), 0, ZERO_SCN, ZERO_SEQ, "", 0);
+    auto* builder = new TestBuilder(&ctx);
+    builder->initialize();
+    builder->setMaxMessageMb(1);
+    std::map<std::string, std::string> properties = {{"message.timeout.ms", TEST_MESSAGE_TIMEOUT_MS}, {"message.max.bytes", TEST_MESSAGE_MAX_BYTES}};
+    auto* writer = new TestWriterKafka(&ctx, database, builder, metadata, properties);
+    writer->initialize();
+    bool ok = true;
+
+    char data[2000];
+    memset((void*)data, 'x', sizeof(data));
+    for (uint64_t i = 0; i < TEST_MESSAGES; ++i)
+        builder->send(data, 100);
+    builder->send(data, sizeof(data));
+
+    BuilderQueue* curBuffer = builder->getFirstBuffer();
+    uint64_t curLength = 0;
+    std::vector<BuilderMsg*> messages;
+    for (uint64_t i = 0; i <= TEST_MESSAGES; ++i) {
+        auto* msg = (BuilderMsg*)(curBuffer->data + curLength);
+        curLength += sizeof(struct BuilderMsg) + ((msg->ownerLength + msg->tableLength + msg->keyLength + 7) & 0xFFFFFFFFFFFFFFF8) +
+                ((msg->length + 7) & 0xFFFFFFFFFFFFFFF8);
+        messages.push_back(msg);
+    }
+
+    // Failed delivery is final: replication stops, the message is not produced again after later messages
+    for (uint64_t i = 0; i < TEST_MESSAGES; ++i)
+        writer->send(messages[i]);
+    std::string error;
+    if (!writer->waitForFailure(error)) {
+        std::cerr << "kafka: failed delivery didn't stop the writer" << std::endl;
+        ok = false;
+    } else if (error.find("delivery of message") == std::string::npos) {
+        std::cerr << "kafka: unexpected error: " << error << std::endl;
+        ok = false;
+    }
+
+    for (uint64_t i = 0; i < TEST_WAIT_MS / 10 && writer->getQueued() > 0; ++i)
+        usleep(10000);
+    if (writer->getConfirmedMessages() != 0 || writer->getQueued() != 0) {
+        std::cerr << "kafka: after failed delivery confirmed: " << std::dec << writer->getConfirmedMessages() << ", queued in producer: " <<
+                writer->getQueued() << std::endl;
+        ok = false;
+    }
+
+    // Message which can't be produced stops replication instead of staying unconfirmed
+    bool failed = false;
+    try {
+        writer->send(messages[TEST_MESSAGES]);
+    } catch (RuntimeException& ex) {
+        failed = ex.msg.find("failed to produce message") != std::string::npos;
+    }
+    if (!failed) {
+        std::cerr << "kafka: message larger than message.max.bytes didn't stop the writer" << std::endl;
+        ok = false;
+    }
+
+    delete writer;
+    delete builder;
+    delete metadata;
+
+    std::cout << "kafka: " << (ok ? "failed delivery stops the writer" : "failed delivery not handled") << std::endl;
+    return ok ? 0 : 1;
+}
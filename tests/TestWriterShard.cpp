@@ -0,0 +1,213 @@
+/* Test of routing of messages to writer shards
+   Copyright (C) 2018-2022 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <iostream>
+#include <vector>
+
+#include "../src/builder/BuilderJson.h"
+#include "../src/common/Ctx.h"
+#include "../src/common/OracleColumn.h"
+#include "../src/common/OracleObject.h"
+#include "../src/common/SysCol.h"
+#include "../src/writer/Writer.h"
+
+#define TEST_SHARDS                             4
+#define TEST_BDBA                               0x01000100
+
+using namespace OpenLogReplicator;
+
+uint64_t OLR_LOCALES = OLR_LOCALES_TIMESTAMP;
+
+class TestBuilder : public BuilderJson {
+public:
+    explicit TestBuilder(Ctx* newCtx) :
+            BuilderJson(newCtx, nullptr, nullptr, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0) {
+    }
+
+    // Row of table with number primary key column and raw column
+    void row(uint64_t type, OracleObject* object, typeSlot slot, const std::string& pkValue, const std::string& raw) {
+        uint64_t image = (type == TRANSACTION_DELETE) ? VALUE_BEFORE : VALUE_AFTER;
+        netRowValue(0, image, pkValue);
+        netRowValue(1, image, raw);
+        processRow(type, object, object->dataObj, TEST_BDBA, slot, lastXid);
+        valuesRelease();
+    }
+};
+
+class TestWriter : public Writer {
+protected:
+    void sendMessage(BuilderMsg* msg __attribute__((unused))) override {
+    }
+
+    [[nodiscard]] std::string getName() const override {
+        return "test:" + alias;
+    }
+
+    void pollQueue() override {
+    }
+
+public:
+    TestWriter(Ctx* newCtx, std::string newAlias, std::string& newDatabase) :
+            Writer(newCtx, newAlias, newDatabase, nullptr, nullptr) {
+    }
+
+    [[nodiscard]] bool match(BuilderMsg* msg) const {
+        return shardMatch(msg);
+    }
+};
+
+static uint64_t fnv1a(const std::string& data) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (char character : data) {
+        hash ^= (uint8_t)character;
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+// Key of row of table without primary key: bytes of data object, block and slot, lowest first
+static uint64_t rowIdKey(typeDataObj dataObj, typeDba bdba, typeSlot slot) {
+    std::string data;
+    for (uint64_t value : {(uint64_t)dataObj, (uint64_t)bdba, (uint64_t)slot})
+        for (uint64_t i = 0; i < 64; i += 8)
+            data.push_back((char)((value >> i) & 0xFF));
+    return fnv1a(data);
+}
+
+static std::vector<BuilderMsg*> readMessages(Builder* builder) {
+    std::vector<BuilderMsg*> messages;
+    BuilderQueue* curBuffer = builder->getFirstBuffer();
+    uint64_t curLength = 0;
+
+    while (true) {
+        if (curBuffer->next != nullptr && curBuffer->length == curLength) {
+            curBuffer = curBuffer->next;
+            curLength = 0;
+        }
+
+        auto* msg = (BuilderMsg*)(curBuffer->data + curLength);
+        if (curBuffer->length <= curLength + sizeof(struct BuilderMsg) || msg->length == 0)
+            return messages;
+        messages.push_back(msg);
+        curLength += sizeof(struct BuilderMsg) + ((msg->ownerLength + msg->tableLength + msg->keyLength + 7) & 0xFFFFFFFFFFFFFFF8);
+        curLength += (msg->length + 7) & 0xFFFFFFFFFFFFFFF8;
+    }
+}
+
+int main() {
+    Ctx ctx;
+    ctx.initialize(32, 1024, 0);
+    auto* builder = new TestBuilder(&ctx);
+    builder->initialize();
+    builder->setRowKeys(true);
+    bool ok = true;
+
+    // Known vectors of FNV-1a 64
+    if (fnv1a("") != 0xCBF29CE484222325ULL || fnv1a("a") != 0xAF63DC4C8601EC8CULL || fnv1a("foobar") != 0x85944171F73967E8ULL) {
+        std::cerr << "writer shard: reference hash differs from known vectors" << std::endl;
+        ok = false;
+    }
+
+    std::string owner("OWNER");
+    std::string namePk("TAB_PK");
+    std::string nameNoPk("TAB");
+    std::string idName("ID");
+    std::string rawName("R");
+    auto* objectPk = new OracleObject(101, 1001, 1, 0, 0, owner, namePk);
+    objectPk->addColumn(new OracleColumn(1, 0, 1, idName, SYS_COL_TYPE_NUMBER, 22, -1, -1, 1, 0, false, false, false, false, false, false, false,
+                                         false));
+    objectPk->addColumn(new OracleColumn(2, 0, 2, rawName, SYS_COL_TYPE_RAW, 10, -1, -1, 0, 0, true, false, false, false, false, false, false,
+                                         false));
+    auto* objectNoPk = new OracleObject(102, 1002, 1, 0, 0, owner, nameNoPk);
+    objectNoPk->addColumn(new OracleColumn(1, 0, 1, idName, SYS_COL_TYPE_NUMBER, 22, -1, -1, 0, 0, true, false, false, false, false, false, false,
+                                           false));
+    objectNoPk->addColumn(new OracleColumn(2, 0, 2, rawName, SYS_COL_TYPE_RAW, 10, -1, -1, 0, 0, true, false, false, false, false, false, false,
+                                           false));
+
+    // Rows of one primary key have the same key also when the row moves, rows without primary key are keyed by rowid
+    std::string id1("\xC1\x02", 2);
+    std::string id2("\xC1\x03", 2);
+    builder->processBegin(100, typeTime(0), 1, typeXid((uint64_t)0x0001000200000003), false);
+    builder->row(TRANSACTION_INSERT, objectPk, 1, id1, "\x01");
+    builder->row(TRANSACTION_UPDATE, objectPk, 2, id1, "\x02");
+    builder->row(TRANSACTION_INSERT, objectPk, 3, id2, "\x03");
+    builder->row(TRANSACTION_DELETE, objectPk, 3, id2, "\x03");
+    builder->row(TRANSACTION_INSERT, objectNoPk, 4, id1, "\x04");
+    builder->row(TRANSACTION_INSERT, objectNoPk, 5, id1, "\x05");
+    builder->processCommit(false);
+
+    std::vector<uint64_t> expectedKeys = {0, fnv1a(id1 + "\xFF"), fnv1a(id1 + "\xFF"), fnv1a(id2 + "\xFF"), fnv1a(id2 + "\xFF"),
+                                          rowIdKey(1002, TEST_BDBA, 4), rowIdKey(1002, TEST_BDBA, 5), 0};
+    std::vector<typeObj> expectedObjs = {0, 101, 101, 101, 101, 102, 102, 0};
+    std::vector<BuilderMsg*> messages = readMessages(builder);
+    if (messages.size() != expectedKeys.size()) {
+        std::cerr << "writer shard: " << std::dec << messages.size() << " messages, expected: " << expectedKeys.size() << std::endl;
+        ok = false;
+    } else {
+        for (uint64_t i = 0; i < messages.size(); ++i) {
+            if (messages[i]->key != expectedKeys[i] || messages[i]->obj != expectedObjs[i]) {
+                std::cerr << "writer shard: message " << std::dec << i << " key: " << std::hex << messages[i]->key << " obj: " << std::dec <<
+                        messages[i]->obj << ", expected key: " << std::hex << expectedKeys[i] << " obj: " << std::dec << expectedObjs[i] << std::endl;
+                ok = false;
+            }
+        }
+    }
+
+    // Every message is sent by one shard: row by key or object, begin and commit by the first shard
+    std::string database("TEST");
+    for (uint64_t shardKey : {WRITER_SHARD_KEY_TABLE, WRITER_SHARD_KEY_PRIMARY_KEY}) {
+        std::vector<TestWriter*> writers;
+        for (uint64_t shard = 0; shard < TEST_SHARDS; ++shard) {
+            writers.push_back(new TestWriter(&ctx, "shard-" + std::to_string(shard), database));
+            writers.back()->setShard(shard, TEST_SHARDS, shardKey);
+        }
+
+        for (BuilderMsg* msg : messages) {
+            uint64_t expected = 0;
+            if (msg->obj != 0)
+                expected = (shardKey == WRITER_SHARD_KEY_PRIMARY_KEY) ? msg->key % TEST_SHARDS : msg->obj % TEST_SHARDS;
+            for (uint64_t shard = 0; shard < TEST_SHARDS; ++shard) {
+                if (writers[shard]->match(msg) != (shard == expected)) {
+                    std::cerr << "writer shard: message of obj " << std::dec << msg->obj << " key " << std::hex << msg->key << std::dec <<
+                            (writers[shard]->match(msg) ? " sent" : " not sent") << " by shard " << shard << " with shard key " << shardKey << std::endl;
+                    ok = false;
+                }
+            }
+        }
+
+        for (TestWriter* writer : writers)
+            delete writer;
+    }
+
+    // Single writer sends everything
+    TestWriter single(&ctx, "single", database);
+    for (BuilderMsg* msg : messages) {
+        if (!single.match(msg)) {
+            std::cerr << "writer shard: message of obj " << std::dec << msg->obj << " not sent by single writer" << std::endl;
+            ok = false;
+        }
+    }
+
+    delete builder;
+    delete objectPk;
+    delete objectNoPk;
+
+    std::cout << "writer shard: " << std::dec << messages.size() << " messages, " << (ok ? "routed correctly" : "routed incorrectly") << std::endl;
+    return ok ? 0 : 1;
+}